@@ -81,6 +81,24 @@ namespace VCX::Engine {
             static constexpr float _dec { 1. / 255. };
         };
 
+        struct RGB32F {
+            using Decoded = glm::vec3;
+            using Encoded = glm::vec3;
+
+            static Decoded Decode(Encoded const & o) { return o; }
+
+            static Encoded Encode(Decoded const & o) { return o; }
+        };
+
+        struct RGBA32F {
+            using Decoded = glm::vec4;
+            using Encoded = glm::vec4;
+
+            static Decoded Decode(Encoded const & o) { return o; }
+
+            static Encoded Encode(Decoded const & o) { return o; }
+        };
+
         struct R16 {
             using Decoded = float;
             using Encoded = unsigned short;
@@ -8,6 +8,8 @@ namespace VCX::Engine::GL {
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::R8>    = GL_R8;
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::RGB8>  = GL_RGB8;
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::RGBA8> = GL_RGBA8;
+    template<> inline constexpr GLenum InternalFormatEnumOf<Formats::RGB32F>  = GL_RGB32F;
+    template<> inline constexpr GLenum InternalFormatEnumOf<Formats::RGBA32F> = GL_RGBA32F;
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::R16>   = GL_R16;
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::D32>   = GL_DEPTH_COMPONENT32;
     template<> inline constexpr GLenum InternalFormatEnumOf<Formats::D24S8> = GL_DEPTH24_STENCIL8;
@@ -17,6 +19,8 @@ namespace VCX::Engine::GL {
     template<> inline constexpr GLenum FormatEnumOf<Formats::R8>    = GL_RED;
     template<> inline constexpr GLenum FormatEnumOf<Formats::RGB8>  = GL_RGB;
     template<> inline constexpr GLenum FormatEnumOf<Formats::RGBA8> = GL_RGBA;
+    template<> inline constexpr GLenum FormatEnumOf<Formats::RGB32F>  = GL_RGB;
+    template<> inline constexpr GLenum FormatEnumOf<Formats::RGBA32F> = GL_RGBA;
     template<> inline constexpr GLenum FormatEnumOf<Formats::R16>   = GL_RED;
     template<> inline constexpr GLenum FormatEnumOf<Formats::D32>   = GL_DEPTH_COMPONENT;
     template<> inline constexpr GLenum FormatEnumOf<Formats::D24S8> = GL_DEPTH_STENCIL;
@@ -25,6 +29,8 @@ namespace VCX::Engine::GL {
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::R8>    = GL_UNSIGNED_BYTE;
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::RGB8>  = GL_UNSIGNED_BYTE;
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::RGBA8> = GL_UNSIGNED_BYTE;
+    template<> inline constexpr GLenum PixelTypeEnumOf<Formats::RGB32F>  = GL_FLOAT;
+    template<> inline constexpr GLenum PixelTypeEnumOf<Formats::RGBA32F> = GL_FLOAT;
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::R16>   = GL_UNSIGNED_SHORT;
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::D32>   = GL_UNSIGNED_INT;
     template<> inline constexpr GLenum PixelTypeEnumOf<Formats::D24S8> = GL_UNSIGNED_INT_24_8;
@@ -0,0 +1,61 @@
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "Engine/MappedFile.h"
+
+namespace VCX::Engine {
+    MappedFile::MappedFile(std::filesystem::path const & fileName) {
+#ifdef _WIN32
+        HANDLE const file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER size {};
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            // the view keeps the mapping alive, so both handles can be closed right away.
+            if (HANDLE const mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+                if (void const * const view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) {
+                    _data = static_cast<std::byte const *>(view);
+                    _size = std::size_t(size.QuadPart);
+                }
+                CloseHandle(mapping);
+            }
+            if (! _data)
+                spdlog::warn("VCX::Engine::MappedFile(\"{}\"): cannot map file.", fileName.filename().string());
+        }
+        CloseHandle(file);
+#else
+        int const fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void * const view = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                _data = static_cast<std::byte const *>(view);
+                _size = std::size_t(st.st_size);
+            } else
+                spdlog::warn("VCX::Engine::MappedFile(\"{}\"): cannot map file.", fileName.filename().string());
+        }
+        close(fd);
+#endif
+    }
+
+    void MappedFile::Close() {
+        if (! _data) return;
+#ifdef _WIN32
+        UnmapViewOfFile(_data);
+#else
+        munmap(const_cast<std::byte *>(_data), _size);
+#endif
+        _data = nullptr;
+        _size = 0;
+    }
+}
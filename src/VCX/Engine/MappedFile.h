@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace VCX::Engine {
+    // a read-only memory mapping of a whole file.
+    // If the file does not exist or is empty, the mapping is left closed
+    // and GetBytes() returns an empty span.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(std::filesystem::path const & fileName);
+        ~MappedFile() { Close(); }
+
+        MappedFile(MappedFile const &)             = delete;
+        MappedFile & operator=(MappedFile const &) = delete;
+
+        MappedFile(MappedFile && rhs) noexcept { Swap(rhs); }
+        MappedFile & operator=(MappedFile && rhs) noexcept {
+            Close();
+            Swap(rhs);
+            return *this;
+        }
+
+        bool                       IsOpen()   const { return _data != nullptr; }
+        std::span<std::byte const> GetBytes() const { return { _data, _size }; }
+
+        void Close();
+
+    private:
+        void Swap(MappedFile & rhs) noexcept {
+            std::swap(_data, rhs._data);
+            std::swap(_size, rhs._size);
+        }
+
+        std::byte const * _data = nullptr;
+        std::size_t       _size = 0;
+    };
+}
@@ -5,10 +5,40 @@ namespace VCX::Engine {
         glm::vec3 minAABB(std::numeric_limits<float>::max());
         glm::vec3 maxAABB(std::numeric_limits<float>::min());
         for (const auto & model : Models) {
+            if (model.MeshIndex != Model::c_NoMesh && model.Mesh.Positions.empty()) {
+                // bound the eight transformed corners of the shared mesh's box
+                const auto meshAABB = Meshes[model.MeshIndex].GetAxisAlignedBoundingBox();
+                for (int corner = 0; corner < 8; ++corner) {
+                    const glm::vec3 local(
+                        corner & 1 ? meshAABB.second.x : meshAABB.first.x,
+                        corner & 2 ? meshAABB.second.y : meshAABB.first.y,
+                        corner & 4 ? meshAABB.second.z : meshAABB.first.z);
+                    const glm::vec3 world(model.Transform * glm::vec4(local, 1));
+                    maxAABB = glm::max(maxAABB, world);
+                    minAABB = glm::min(minAABB, world);
+                }
+                continue;
+            }
             const auto modelAABB = model.Mesh.GetAxisAlignedBoundingBox();
             maxAABB = glm::max(maxAABB, modelAABB.second);
             minAABB = glm::min(minAABB, modelAABB.first);
         }
         return { minAABB, maxAABB };
     }
+
+    void Scene::BakeWorldSpaceMeshes() {
+        // T * R * S with the inverse transpose for normals
+        for (auto & model : Models) {
+            if (model.MeshIndex == Model::c_NoMesh) continue;
+            glm::mat3 const linear(model.Transform);
+            glm::mat3 const normalMatrix = glm::transpose(glm::inverse(linear));
+            model.Mesh = Meshes[model.MeshIndex];
+            for (auto & pos : model.Mesh.Positions) {
+              pos = glm::vec3(model.Transform[3]) + linear * pos;
+            }
+            for (auto & norm : model.Mesh.Normals) {
+              norm = glm::normalize(normalMatrix * norm);
+            }
+        }
+    }
 }
\ No newline at end of file
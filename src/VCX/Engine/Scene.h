@@ -58,8 +58,14 @@ namespace VCX::Engine {
     };
 
     struct Model {
+        static constexpr std::uint32_t c_NoMesh = ~std::uint32_t(0);
+
         SurfaceMesh   Mesh          { };
         std::uint32_t MaterialIndex { 0 };
+        // models loaded from a mesh file reference the shared object-space mesh Scene::Meshes[MeshIndex], which Transform
+        // places in world space; their Mesh stays empty until Scene::BakeWorldSpaceMeshes. c_NoMesh for models built in world space
+        std::uint32_t MeshIndex     { c_NoMesh };
+        glm::mat4     Transform     { 1 };
     };
 
     enum class ReflectionType {
@@ -76,7 +82,12 @@ namespace VCX::Engine {
         std::vector<Light>    Lights;
         std::vector<Material> Materials;
         std::vector<Model>    Models;
+        std::vector<SurfaceMesh> Meshes; // object-space meshes shared by the Models instancing them, one per file
 
         std::pair<glm::vec3, glm::vec3> GetAxisAlignedBoundingBox() const;
+
+        // fill Model::Mesh of instancing models with a world-space copy of their shared mesh, for consumers that draw or
+        // intersect Model::Mesh directly; the copies are not updated when a Transform changes later
+        void BakeWorldSpaceMeshes();
     };
 } // namespace VCX::Engine
@@ -62,6 +62,10 @@ namespace VCX::Engine {
         TextureND(std::size_t const sizeX, std::size_t const sizeY, std::size_t const sizeZ) requires (Dim == 3) :
             _size({ sizeX, sizeY, sizeZ }), _data(sizeX * sizeY * sizeZ) { }
 
+        // copies a tightly packed, row-major array of encoded texels without clearing the storage first.
+        TextureND(std::array<std::size_t, Dim> const & o, std::span<typename Format::Encoded const> const data):
+            _size(o), _data(data.begin(), data.end()) { }
+
         template<TextureFormat NewFormat>
             requires requires (typename Format::Encoded a) { { Format::template Cast<NewFormat>(a) } -> std::same_as<typename NewFormat::Encoded>; }
         TextureND<Dim, NewFormat> Cast() {
@@ -1,5 +1,13 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <limits>
+#include <span>
+#include <thread>
 
 #include <spdlog/spdlog.h>
 #include <stb_image.h>
@@ -7,16 +15,7 @@
 #include <yaml-cpp/yaml.h>
 
 #include "Engine/loader.h"
-
-namespace std {
-    template<>
-    struct hash<tuple<int, int, int>> {
-        size_t operator()(tuple<int, int, int> const & val) const {
-            auto [i1, i2, i3] = val;
-            return ((i1 ^ (i2 << 1)) >> 1) ^ (i3 << 1);
-        }
-    };
-}
+#include "Engine/MappedFile.h"
 
 namespace YAML {
     template<>
@@ -105,93 +104,239 @@ namespace VCX::Engine {
         }
     }
 
-    Texture2D<Formats::R8> LoadImageGray(std::filesystem::path const & fileName, bool const flipped) {
-        auto const buf { LoadBytes(fileName) };
-        int        width {}, height {}, channels {};
-        stbi_set_flip_vertically_on_load(flipped);
+    bool SaveBytes(std::filesystem::path const & fileName, std::initializer_list<std::span<std::byte const>> const parts) {
+        auto tempPath = fileName;
+        tempPath += fmt::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream file(tempPath, std::ios::binary);
+            for (auto const part : parts) file.write(reinterpret_cast<char const *>(part.data()), part.size());
+            if (! file) {
+                file.close();
+                std::error_code ec;
+                std::filesystem::remove(tempPath, ec);
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tempPath, fileName, ec);
+        if (ec) std::filesystem::remove(tempPath, ec);
+        return ! ec;
+    }
+
+    // decodes an image file mapped into memory with stb, converting it to the channel count of Format.
+    template<TextureFormat Format>
+    static Texture2D<Format> LoadImage(std::filesystem::path const & fileName, bool const flipped) {
+        if (! std::filesystem::exists(fileName)) {
+            spdlog::error("VCX::Engine::LoadImage(\"{}\"): not found.", fileName.filename().string());
+            return Texture2D<Format>(0, 0);
+        }
+        MappedFile const file(fileName);
+        auto const       buf { file.GetBytes() };
+        int              width {}, height {}, channels {};
+        int constexpr    desired = int(sizeof(typename Format::Encoded));
+        stbi_set_flip_vertically_on_load_thread(flipped);
         auto const image {
             stbi_load_from_memory(
                 reinterpret_cast<const stbi_uc *>(buf.data()),
-                buf.size(),
+                int(buf.size()),
                 &width,
                 &height,
                 &channels,
-                1)
+                desired)
         };
-        Texture2D<Formats::R8> texture(width, height);
-        std::memcpy(
-            reinterpret_cast<void *>(const_cast<std::byte *>(texture.GetBytes().data())),
-            image,
-            texture.GetBytes().size());
+        if (! image) {
+            spdlog::error("VCX::Engine::LoadImage(\"{}\"): {}.", fileName.filename().string(), stbi_failure_reason());
+            return Texture2D<Format>(0, 0);
+        }
+        Texture2D<Format> texture(
+            { std::size_t(width), std::size_t(height) },
+            std::span(reinterpret_cast<typename Format::Encoded const *>(image), std::size_t(width) * std::size_t(height)));
         stbi_image_free(image);
         return texture;
     }
 
+    Texture2D<Formats::R8> LoadImageGray(std::filesystem::path const & fileName, bool const flipped) {
+        return LoadImage<Formats::R8>(fileName, flipped);
+    }
+
     Texture2D<Formats::RGB8> LoadImageRGB(std::filesystem::path const & fileName, bool const flipped) {
-        auto const buf { LoadBytes(fileName) };
-        int        width {}, height {}, channels {};
-        stbi_set_flip_vertically_on_load(flipped);
-        auto const image {
-            stbi_load_from_memory(
-                reinterpret_cast<const stbi_uc *>(buf.data()),
-                buf.size(),
-                &width,
-                &height,
-                &channels,
-                3)
-        };
-        Texture2D<Formats::RGB8> texture(width, height);
-        std::memcpy(
-            reinterpret_cast<void *>(const_cast<std::byte *>(texture.GetBytes().data())),
-            image,
-            texture.GetBytes().size());
-        stbi_image_free(image);
-        return texture;
+        return LoadImage<Formats::RGB8>(fileName, flipped);
     }
 
     Texture2D<Formats::RGBA8> LoadImageRGBA(std::filesystem::path const & fileName, bool const flipped) {
-        auto const buf { LoadBytes(fileName) };
-        int        width {}, height {}, channels {};
-        stbi_set_flip_vertically_on_load(flipped);
-        auto const image {
-            stbi_load_from_memory(
-                reinterpret_cast<const stbi_uc *>(buf.data()),
-                buf.size(),
-                &width,
-                &height,
-                &channels,
-                4)
+        return LoadImage<Formats::RGBA8>(fileName, flipped);
+    }
+
+    // run independent jobs on up to hardware_concurrency() threads, returns when all of them are done.
+    static void RunParallel(std::vector<std::function<void()>> const & jobs) {
+        std::atomic_size_t next { 0 };
+        auto const         worker = [&]() {
+            for (std::size_t i = next++; i < jobs.size(); i = next++) jobs[i]();
         };
-        Texture2D<Formats::RGBA8> texture(width, height);
-        std::memcpy(
-            reinterpret_cast<void *>(const_cast<std::byte *>(texture.GetBytes().data())),
-            image,
-            texture.GetBytes().size());
-        stbi_image_free(image);
-        return texture;
+        std::size_t const        numThreads = std::min<std::size_t>(jobs.size(), std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < numThreads; ++i) threads.emplace_back(worker);
+        worker();
+        for (auto & thread : threads) thread.join();
     }
 
+    // collects the texture maps of a scene so that every distinct (file, format) pair is decoded once.
+    // Requesting the same slot again replaces the earlier request; AppendJobs adds one decode job per
+    // distinct file, and Resolve hands the decoded images to their slots after the jobs have run.
+    class ImageLoadBatch {
+    public:
+        template<TextureFormat Format>
+        void Request(Texture2D<Format> & slot, std::filesystem::path const & fileName) {
+            GetRequests<Format>().Slots[&slot] = fileName.lexically_normal();
+        }
+
+        void AppendJobs(std::vector<std::function<void()>> & jobs) {
+            _gray.AppendJobs(jobs);
+            _rgb .AppendJobs(jobs);
+            _rgba.AppendJobs(jobs);
+        }
+
+        void Resolve() {
+            _gray.Resolve();
+            _rgb .Resolve();
+            _rgba.Resolve();
+        }
+
+    private:
+        template<TextureFormat Format>
+        struct Requests {
+            std::unordered_map<Texture2D<Format> *, std::filesystem::path> Slots;
+            std::unordered_map<std::string, Texture2D<Format>>             Images;
+            std::unordered_map<std::string, std::size_t>                   Users;
+
+            void AppendJobs(std::vector<std::function<void()>> & jobs) {
+                for (auto const & [slot, fileName] : Slots) {
+                    auto const key = fileName.string();
+                    if (Users[key]++ > 0) continue;
+                    jobs.push_back([&image = Images[key], fileName]() { image = LoadImage<Format>(fileName, false); });
+                }
+            }
+
+            void Resolve() {
+                // the last slot sharing an image takes it over, the others get a copy
+                for (auto const & [slot, fileName] : Slots) {
+                    auto const key = fileName.string();
+                    if (--Users[key] > 0) *slot = Images[key];
+                    else *slot = std::move(Images[key]);
+                }
+                Slots.clear();
+                Images.clear();
+                Users.clear();
+            }
+        };
+
+        template<TextureFormat Format>
+        Requests<Format> & GetRequests() {
+            if constexpr (std::is_same_v<Format, Formats::R8>) return _gray;
+            else if constexpr (std::is_same_v<Format, Formats::RGB8>) return _rgb;
+            else return _rgba;
+        }
+
+        Requests<Formats::R8>    _gray;
+        Requests<Formats::RGB8>  _rgb;
+        Requests<Formats::RGBA8> _rgba;
+    };
+
+    // open-addressing hash table from OBJ index triples to deduplicated vertex indices.
+    // Slots are laid out by position index, with a small window per position for its normal/texcoord
+    // variants, so the mostly coherent index streams of real meshes keep hitting the same cache lines.
+    // Meshes with more variants per position than the windows hold (e.g. flat-shaded ones) show up as
+    // long probe sequences, after which the table falls back to scattering all keys uniformly.
+    class VertexHashTable {
+    public:
+        VertexHashTable(std::size_t const numPositions, std::size_t const expectedSize) :
+            _numPositions(std::max<std::size_t>(1, numPositions)) {
+            Rehash(std::bit_ceil(std::max<std::size_t>(16, expectedSize * 2)));
+        }
+
+        // returns the index stored for the triple, or stores and returns `next` if the triple is new.
+        std::uint32_t FindOrInsert(int const v, int const n, int const t, std::uint32_t const next) {
+            std::size_t probes = 0;
+            for (std::size_t i = Hash(v, n, t) & _mask;; i = (i + 1) & _mask, ++probes) {
+                Slot & slot = _slots[i];
+                if (slot.V == v && slot.N == n && slot.T == t) return slot.Index;
+                if (slot.V == c_Empty) {
+                    slot = { v, n, t, next };
+                    if (probes > c_MaxProbes && ! _scatter) {
+                        _scatter = true;
+                        Rehash(_slots.size());
+                    }
+                    if (++_size * 2 > _slots.size()) Rehash(_slots.size() * 2);
+                    return next;
+                }
+            }
+        }
+
+    private:
+        struct Slot {
+            int           V, N, T;
+            std::uint32_t Index;
+        };
+
+        static constexpr int         c_Empty     = std::numeric_limits<int>::min();
+        static constexpr std::size_t c_MaxProbes = 64;
+
+        std::size_t Hash(int const v, int const n, int const t) const {
+            std::uint32_t const variant = (std::uint32_t(n) * 0x9e3779b1u) ^ (std::uint32_t(t) * 0x85ebca6bu);
+            if (! _scatter)
+                return (std::size_t(std::uint32_t(v)) << _shift) + ((variant >> 16) & ((std::size_t(1) << _shift) - 1));
+            std::uint64_t h = (std::uint64_t(std::uint32_t(v)) << 32 | variant) * 0xff51afd7ed558ccdull;
+            return std::size_t(h ^ (h >> 32));
+        }
+
+        void Rehash(std::size_t const capacity) {
+            std::vector<Slot> old(capacity, Slot { c_Empty, 0, 0, 0 });
+            old.swap(_slots);
+            _mask  = capacity - 1;
+            _shift = std::countr_zero(std::bit_ceil((capacity + _numPositions - 1) / _numPositions));
+            for (auto const & slot : old)
+                if (slot.V != c_Empty) {
+                    std::size_t i = Hash(slot.V, slot.N, slot.T) & _mask;
+                    while (_slots[i].V != c_Empty) i = (i + 1) & _mask;
+                    _slots[i] = slot;
+                }
+        }
+
+        std::vector<Slot> _slots;
+        std::size_t       _numPositions;
+        std::size_t       _mask    = 0;
+        std::size_t       _size    = 0;
+        int               _shift   = 0;
+        bool              _scatter = false;
+    };
+
     static void AddUniqueVertices(
-        tinyobj::attrib_t                                            const & attrib,
-        std::vector<tinyobj::index_t>                                const & indices,
-        std::unordered_map<std::tuple<int, int, int>, std::uint32_t>         vtxHashList,
-        SurfaceMesh                                                        & mesh,
-        bool                                                         const   simplified     = false) {
+        tinyobj::attrib_t                 const & attrib,
+        std::span<tinyobj::index_t const> const   indices,
+        VertexHashTable                         & vtxHashList,
+        SurfaceMesh                             & mesh,
+        bool                              const   simplified     = false) {
+        // first pass only assigns indices, so that the vertex arrays can be reserved once.
+        std::vector<tinyobj::index_t> newVertices;
+        mesh.Indices.reserve(mesh.Indices.size() + indices.size());
         for (auto const & index : indices) {
-            auto const vertex = simplified
-                ? std::tuple(index.vertex_index, -1, -1)
-                : std::tuple(index.vertex_index, index.normal_index, index.texcoord_index);
-            if (auto const iter = vtxHashList.find(vertex); iter != vtxHashList.end()) {
-                mesh.Indices.push_back(iter->second);
-            } else {
-                mesh.Indices.push_back(vtxHashList[vertex] = std::uint32_t(mesh.Positions.size()));
-
-                mesh.Positions.emplace_back(attrib.vertices[index.vertex_index * 3 + 0], attrib.vertices[index.vertex_index * 3 + 1], attrib.vertices[index.vertex_index * 3 + 2]);
-                if (index.normal_index >= 0)
-                    mesh.Normals.emplace_back(attrib.normals[index.normal_index * 3 + 0], attrib.normals[index.normal_index * 3 + 1], attrib.normals[index.normal_index * 3 + 2]);
-                if (index.texcoord_index >= 0)
-                    mesh.TexCoords.emplace_back(attrib.texcoords[index.texcoord_index * 2 + 0], 1 - attrib.texcoords[index.texcoord_index * 2 + 1]);
-            }
+            auto const next = std::uint32_t(mesh.Positions.size() + newVertices.size());
+            auto const idx  = simplified
+                ? vtxHashList.FindOrInsert(index.vertex_index, -1, -1, next)
+                : vtxHashList.FindOrInsert(index.vertex_index, index.normal_index, index.texcoord_index, next);
+            if (idx == next) newVertices.push_back(index);
+            mesh.Indices.push_back(idx);
+        }
+
+        mesh.Positions.reserve(mesh.Positions.size() + newVertices.size());
+        mesh.Normals  .reserve(mesh.Normals  .size() + newVertices.size());
+        mesh.TexCoords.reserve(mesh.TexCoords.size() + newVertices.size());
+        for (auto const & index : newVertices) {
+            mesh.Positions.emplace_back(attrib.vertices[index.vertex_index * 3 + 0], attrib.vertices[index.vertex_index * 3 + 1], attrib.vertices[index.vertex_index * 3 + 2]);
+            if (index.normal_index >= 0)
+                mesh.Normals.emplace_back(attrib.normals[index.normal_index * 3 + 0], attrib.normals[index.normal_index * 3 + 1], attrib.normals[index.normal_index * 3 + 2]);
+            if (index.texcoord_index >= 0)
+                mesh.TexCoords.emplace_back(attrib.texcoords[index.texcoord_index * 2 + 0], 1 - attrib.texcoords[index.texcoord_index * 2 + 1]);
         }
     }
 
@@ -219,8 +364,9 @@ namespace VCX::Engine {
 
         spdlog::trace("VCX::Engine::LoadSurfaceMeshOBJ(\"{}\")", fileName.filename().string());
 
-        std::unordered_map<std::tuple<int, int, int>, std::uint32_t> vtxHashList;
-        SurfaceMesh                                                  mesh;
+        // one table for all shapes, so that vertices on shape boundaries are shared as well
+        VertexHashTable vtxHashList(attrib.vertices.size() / 3, attrib.vertices.size() / 3);
+        SurfaceMesh     mesh;
 
         for (auto const & shape : shapes)
             AddUniqueVertices(attrib, shape.mesh.indices, vtxHashList, mesh, simplified);
@@ -228,10 +374,113 @@ namespace VCX::Engine {
         return mesh;
     }
 
+    // binary cache of a parsed mesh, stored next to the source file:
+    // header, then Positions, Normals, TexCoords and Indices as raw arrays.
+    struct MeshCacheHeader {
+        char          Magic[8];
+        std::uint32_t Version;
+        std::uint32_t Simplified;
+        std::uint64_t SourceSize;
+        std::int64_t  SourceTime;
+        std::uint64_t NumPositions;
+        std::uint64_t NumNormals;
+        std::uint64_t NumTexCoords;
+        std::uint64_t NumIndices;
+        std::uint64_t ContentHash;
+    };
+
+    static constexpr char          c_MeshCacheMagic[8] = "VCXMESH";
+    static constexpr std::uint32_t c_MeshCacheVersion  = 2; // 2: vertices are shared across shapes
+
+    static std::filesystem::path GetMeshCachePath(std::filesystem::path const & fileName, bool const simplified) {
+        auto path = fileName;
+        path += simplified ? ".simplified.mesh" : ".mesh";
+        return path;
+    }
+
+    static bool GetSourceStamp(std::filesystem::path const & fileName, std::uint64_t & size, std::int64_t & time) {
+        std::error_code ec;
+        size = std::filesystem::file_size(fileName, ec);
+        if (ec) return false;
+        time = std::filesystem::last_write_time(fileName, ec).time_since_epoch().count();
+        return ! ec;
+    }
+
+    static bool LoadMeshCache(std::filesystem::path const & fileName, bool const simplified, SurfaceMesh & mesh) {
+        auto const cachePath = GetMeshCachePath(fileName, simplified);
+        if (! std::filesystem::exists(cachePath)) return false;
+
+        std::uint64_t sourceSize;
+        std::int64_t  sourceTime;
+        if (! GetSourceStamp(fileName, sourceSize, sourceTime)) return false;
+
+        MappedFile const file(cachePath);
+        auto const       bytes = file.GetBytes();
+        if (bytes.size() < sizeof(MeshCacheHeader)) return false;
+
+        MeshCacheHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        auto const payload = bytes.subspan(sizeof(header));
+        if (std::memcmp(header.Magic, c_MeshCacheMagic, sizeof(header.Magic)) != 0
+            || header.Version != c_MeshCacheVersion
+            || header.Simplified != std::uint32_t(simplified)
+            || header.SourceSize != sourceSize
+            || header.SourceTime != sourceTime
+            || payload.size() != header.NumPositions * sizeof(glm::vec3) + header.NumNormals * sizeof(glm::vec3) + header.NumTexCoords * sizeof(glm::vec2) + header.NumIndices * sizeof(std::uint32_t)
+            || header.ContentHash != hash_bytes(payload)) {
+            spdlog::warn("VCX::Engine::LoadSurfaceMesh(\"{}\"): stale or corrupted mesh cache, reloading.", fileName.filename().string());
+            return false;
+        }
+
+        // every array is a tightly packed run of floats/uint32s in the mapping, copied over in one go.
+        std::byte const * ptr    = payload.data();
+        auto const        Assign = [&ptr]<typename T>(std::vector<T> & vec, std::uint64_t const count) {
+            vec.resize(count);
+            std::memcpy(vec.data(), ptr, count * sizeof(T));
+            ptr += count * sizeof(T);
+        };
+        Assign(mesh.Positions, header.NumPositions);
+        Assign(mesh.Normals  , header.NumNormals  );
+        Assign(mesh.TexCoords, header.NumTexCoords);
+        Assign(mesh.Indices  , header.NumIndices  );
+        spdlog::trace("VCX::Engine::LoadSurfaceMesh(\"{}\"): loaded from mesh cache.", fileName.filename().string());
+        return true;
+    }
+
+    static void SaveMeshCache(std::filesystem::path const & fileName, bool const simplified, SurfaceMesh const & mesh) {
+        MeshCacheHeader header {};
+        std::memcpy(header.Magic, c_MeshCacheMagic, sizeof(header.Magic));
+        header.Version      = c_MeshCacheVersion;
+        header.Simplified   = std::uint32_t(simplified);
+        header.NumPositions = mesh.Positions.size();
+        header.NumNormals   = mesh.Normals.size();
+        header.NumTexCoords = mesh.TexCoords.size();
+        header.NumIndices   = mesh.Indices.size();
+        if (! GetSourceStamp(fileName, header.SourceSize, header.SourceTime)) return;
+
+        std::vector<std::byte> payload;
+        auto const             Append = [&payload]<typename T>(std::vector<T> const & vec) {
+            auto const bytes = make_span_bytes<T>(vec);
+            payload.insert(payload.end(), bytes.begin(), bytes.end());
+        };
+        Append(mesh.Positions);
+        Append(mesh.Normals  );
+        Append(mesh.TexCoords);
+        Append(mesh.Indices  );
+        header.ContentHash = hash_bytes(payload);
+
+        if (! SaveBytes(GetMeshCachePath(fileName, simplified), { std::as_bytes(std::span(&header, 1)), payload }))
+            spdlog::warn("VCX::Engine::LoadSurfaceMesh(\"{}\"): cannot write mesh cache.", fileName.filename().string());
+    }
+
     SurfaceMesh LoadSurfaceMesh(std::filesystem::path const & fileName, bool const simplified) {
         auto const ext = fileName.extension();
         if (ext == ".obj") {
-            return LoadSurfaceMeshOBJ(fileName, simplified);
+            SurfaceMesh mesh;
+            if (LoadMeshCache(fileName, simplified, mesh)) return mesh;
+            mesh = LoadSurfaceMeshOBJ(fileName, simplified);
+            if (mesh.GetVertexCount() > 0) SaveMeshCache(fileName, simplified, mesh);
+            return mesh;
         } else {
             spdlog::error("VCX::Engine::LoadSurfaceMesh(\"{}\"): undertermined file format.", fileName.filename().string());
             return {};
@@ -258,7 +507,14 @@ namespace VCX::Engine {
 
         spdlog::trace("VCX::Engine::LoadModelsOBJ(\"{}\")", fileName.filename().string());
 
+        std::vector<std::size_t> perMatCount(mats.size(), 0);
+        for (auto const & shape : shapes)
+            for (auto const mat : shape.mesh.material_ids)
+                if (mat >= 0) perMatCount[mat] += 3;
+
         std::vector<std::vector<tinyobj::index_t>> perMatFaces(mats.size());
+        for (std::size_t i = 0; i < mats.size(); i++)
+            perMatFaces[i].reserve(perMatCount[i]);
 
         for (auto const & shape : shapes) {
             for (std::size_t i = 0; i < shape.mesh.indices.size(); i += 3)
@@ -269,33 +525,46 @@ namespace VCX::Engine {
                 }
         }
 
-        auto const SetMap1 = [&]<typename T>(T & val, std::string const & str) { if (str != "") val = LoadImageGray(directory / str); };
-        auto const SetMap4 = [&]<typename T>(T & val, std::string const & str) { if (str != "") val = LoadImageRGBA(directory / str); };
+        ImageLoadBatch images;
+        auto const     SetMap = [&]<typename T>(T & val, std::string const & str) { if (str != "") images.Request(val, directory / str); };
 
-        for (std::size_t i = 0; i < mats.size(); i++) {
-            if (perMatFaces[i].empty()) continue;
+        // every non-empty material group becomes one model, built concurrently into pre-sized slots
+        std::vector<std::size_t> groups;
+        for (std::size_t i = 0; i < mats.size(); i++)
+            if (! perMatFaces[i].empty()) groups.push_back(i);
 
-            models.emplace_back();
-            auto & model = models.back();
-            model.MaterialIndex = std::uint32_t(materials.size());
+        std::size_t const firstModel    = models.size();
+        std::size_t const firstMaterial = materials.size();
+        models.resize(firstModel + groups.size());
+        materials.resize(firstMaterial + groups.size());
 
-            materials.emplace_back();
-            auto & material = materials.back();
+        std::vector<std::function<void()>> jobs;
+        for (std::size_t k = 0; k < groups.size(); k++) {
+            std::size_t const i     = groups[k];
+            auto &            model = models[firstModel + k];
+            model.MaterialIndex     = std::uint32_t(firstMaterial + k);
+
+            auto & material = materials[firstMaterial + k];
 
             material.Blend = BlendMode::Opaque;
 
             material.Albedo.Fill(glm::vec4(mats[i].diffuse[0], mats[i].diffuse[1], mats[i].diffuse[2], mats[i].dissolve));
-            SetMap4(material.Albedo, mats[i].diffuse_texname);
+            SetMap(material.Albedo, mats[i].diffuse_texname);
 
             material.MetaSpec.Fill(glm::vec4(mats[i].specular[0], mats[i].specular[1], mats[i].specular[2], mats[i].shininess / 256.f));
-            SetMap4(material.MetaSpec, mats[i].specular_texname);
+            SetMap(material.MetaSpec, mats[i].specular_texname);
 
             material.Height.Fill(0);
-            SetMap1(material.Height, mats[i].bump_texname);
+            SetMap(material.Height, mats[i].bump_texname);
 
-            std::unordered_map<std::tuple<int, int, int>, std::uint32_t> vtxHashList;
-            AddUniqueVertices(attrib, perMatFaces[i], vtxHashList, model.Mesh);
+            jobs.push_back([&, i, &mesh = model.Mesh]() {
+                VertexHashTable vtxHashList(attrib.vertices.size() / 3, perMatFaces[i].size() / 6);
+                AddUniqueVertices(attrib, perMatFaces[i], vtxHashList, mesh);
+            });
         }
+        images.AppendJobs(jobs);
+        RunParallel(jobs);
+        images.Resolve();
     }
 
     static void LoadComplexModels(std::filesystem::path const & fileName, std::vector<Material> & materials, std::vector<Model> & models) {
@@ -317,21 +586,27 @@ namespace VCX::Engine {
         auto const directory = fileName.parent_path();
 		auto const root = YAML::Load(fin);
 
+        // images and meshes are only located here and decoded concurrently by RunParallel below;
+        // a later map key for the same slot replaces the earlier one, as the sequential loader did.
+        ImageLoadBatch                     images;
+        std::vector<std::function<void()>> meshLoads;
+
         auto constexpr SetValue = [] <typename T>(T & val, YAML::Node const & node) { if (node) val = node.as<T>(); };
-        auto const     SetMap1  = [&]<typename T>(T & val, YAML::Node const & node) { if (node) val = LoadImageGray(directory / node.as<std::string>()); };
-        auto const     SetMap4  = [&]<typename T>(T & val, YAML::Node const & node) { if (node) val = LoadImageRGBA(directory / node.as<std::string>()); };
+        auto const     SetMap   = [&]<typename T>(T & val, YAML::Node const & node) { if (node) images.Request(val, directory / node.as<std::string>()); };
 
         Scene scene;
         SetValue(scene.Reflection      , root["Reflection"]);
         SetValue(scene.AmbientIntensity, root["AmbientIntensity"]);
 
+        // the vectors are sized up front so that the pending loads can keep references into them
         scene.Skyboxes.clear();
         if (root["Skyboxes"]) {
+            scene.Skyboxes.resize(root["Skyboxes"].size());
+            std::size_t k = 0;
             for (auto const & skyboxNode : root["Skyboxes"]) {
-                Skybox skybox;
+                auto & skybox = scene.Skyboxes[k++];
                 for (std::size_t i = 0; i < 6; ++i)
-                    skybox.Images[i] = LoadImageRGB(directory / skyboxNode[i].as<std::string>());
-                scene.Skyboxes.push_back(std::move(skybox));
+                    images.Request(skybox.Images[i], directory / skyboxNode[i].as<std::string>());
             }
         }
 
@@ -368,10 +643,13 @@ namespace VCX::Engine {
 
         scene.Materials.clear();
         if (root["Materials"]) {
+            scene.Materials.resize(root["Materials"].size());
+            std::size_t k = 0;
             for (auto const & materialNode : root["Materials"]) {
-                Material material;
+                auto & material = scene.Materials[k];
                 if (materialNode["Name"])
-                    uniqueMaterials[materialNode["Name"].as<std::string>()] = std::uint32_t(scene.Materials.size());
+                    uniqueMaterials[materialNode["Name"].as<std::string>()] = std::uint32_t(k);
+                ++k;
 
                 SetValue(material.Blend, materialNode["Blend"]);
 
@@ -380,9 +658,9 @@ namespace VCX::Engine {
                 SetValue(albedoFactor, materialNode["Albedo"]);
                 SetValue(albedoFactor, materialNode["BaseColor"]);
                 material.Albedo.Fill(albedoFactor);
-                SetMap4(material.Albedo, materialNode["DiffuseMap"]  );
-                SetMap4(material.Albedo, materialNode["AlbedoMap"]   );
-                SetMap4(material.Albedo, materialNode["BaseColorMap"]);
+                SetMap(material.Albedo, materialNode["DiffuseMap"]  );
+                SetMap(material.Albedo, materialNode["AlbedoMap"]   );
+                SetMap(material.Albedo, materialNode["BaseColorMap"]);
 
                 glm::vec4 metaSpecFactor(0);
                 SetValue(metaSpecFactor  , materialNode["Specular"]);
@@ -392,22 +670,29 @@ namespace VCX::Engine {
                 SetValue(metaSpecFactor.a, materialNode["Smoothness"]);
                 metaSpecFactor.a /= 256;
                 material.MetaSpec.Fill(metaSpecFactor);
-                SetMap4(material.MetaSpec, materialNode["SpecularMap"]);
-                SetMap4(material.MetaSpec, materialNode["MetallicMap"]);
+                SetMap(material.MetaSpec, materialNode["SpecularMap"]);
+                SetMap(material.MetaSpec, materialNode["MetallicMap"]);
 
                 material.Height.Fill(0);
-                SetMap1(material.Height, materialNode["HeightMap"]);
-
-                scene.Materials.push_back(std::move(material));
+                SetMap(material.Height, materialNode["HeightMap"]);
             }
         }
 
+        // every mesh file is loaded once into scene.Meshes and shared by the models instancing it; Model::Mesh stays empty
+        // for them, see Scene::BakeWorldSpaceMeshes for consumers that need world-space copies
+        std::unordered_map<std::string, std::uint32_t> uniqueMeshes;
+
         scene.Models.clear();
+        scene.Meshes.clear();
         if (root["Models"]) {
+            std::size_t numModels = 0;
+            for (auto const & modelNode : root["Models"])
+                numModels += bool(modelNode["Mesh"]);
+            scene.Models.resize(numModels);
+            std::size_t k = 0;
             for (auto const & modelNode : root["Models"]) {
                 if (! modelNode["Mesh"]) continue;
-                Model model;
-                model.Mesh = LoadSurfaceMesh(directory / modelNode["Mesh"].as<std::string>());
+                Model & model = scene.Models[k++];
                 if (modelNode["Material"])
                     model.MaterialIndex = uniqueMaterials[modelNode["Material"].as<std::string>()];
                 glm::vec3 translation(0.);
@@ -419,17 +704,24 @@ namespace VCX::Engine {
                    rotation = modelNode["Rotation"].as<glm::mat3>();
                 if (modelNode["Scale"])
                    scale = modelNode["Scale"].as<glm::vec3>();
-                for (auto & pos : model.Mesh.Positions) {
-                  pos = translation + rotation * scale * pos;
-                }
-                for (auto & norm : model.Mesh.Normals) {
-                  norm = rotation * glm::vec3(norm.x / scale.x, norm.y / scale.y, norm.z / scale.z);
-                  norm = glm::normalize(norm);
-                }
-                scene.Models.push_back(std::move(model));
+                model.Transform    = glm::mat4(rotation * glm::mat3(scale.x, 0, 0, 0, scale.y, 0, 0, 0, scale.z));
+                model.Transform[3] = glm::vec4(translation, 1);
+
+                auto const path           = (directory / modelNode["Mesh"].as<std::string>()).lexically_normal();
+                auto const [it, inserted] = uniqueMeshes.try_emplace(path.string(), std::uint32_t(uniqueMeshes.size()));
+                model.MeshIndex           = it->second;
+                if (inserted)
+                    meshLoads.push_back([&scene, index = it->second, path]() { scene.Meshes[index] = LoadSurfaceMesh(path); });
             }
-        } 
-        
+            // sized before the load jobs run
+            scene.Meshes.resize(uniqueMeshes.size());
+        }
+
+        // meshes first: they are usually the larger jobs
+        images.AppendJobs(meshLoads);
+        RunParallel(meshLoads);
+        images.Resolve();
+
         if (root["ComplexModels"]) {
             for (auto const & modelNode : root["ComplexModels"]) {
                 if (! modelNode["Mesh"]) continue;
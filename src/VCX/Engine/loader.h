@@ -11,6 +11,10 @@ namespace VCX::Engine {
     // and an error will be emitted to spdlog.
     std::vector<std::byte> LoadBytes(std::filesystem::path const & fileName);
 
+    // write the concatenation of parts to a file through a per-thread temporary and a rename,
+    // so that concurrent readers never see a partial file. Returns false if the file cannot be written.
+    bool SaveBytes(std::filesystem::path const & fileName, std::initializer_list<std::span<std::byte const>> parts);
+
     Texture2D<Formats::R8>    LoadImageGray(std::filesystem::path const & fileName, bool const flipped = false);
     Texture2D<Formats::RGB8>  LoadImageRGB (std::filesystem::path const & fileName, bool const flipped = false);
     Texture2D<Formats::RGBA8> LoadImageRGBA(std::filesystem::path const & fileName, bool const flipped = false);
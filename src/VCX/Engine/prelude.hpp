@@ -2,6 +2,8 @@
 
 #include <array>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <span>
 #include <utility>
@@ -16,6 +18,22 @@ namespace VCX::Engine {
             span.size_bytes());
     }
 
+    // 64-bit non-cryptographic hash used to validate on-disk caches;
+    // passing the previous result as seed chains several byte ranges into one hash.
+    inline std::uint64_t hash_bytes(std::span<std::byte const> const bytes, std::uint64_t const seed = 0) {
+        std::uint64_t hash = 0x9e3779b97f4a7c15ull ^ seed ^ bytes.size();
+        std::size_t   i    = 0;
+        for (; i + 8 <= bytes.size(); i += 8) {
+            std::uint64_t word;
+            std::memcpy(&word, bytes.data() + i, 8);
+            hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+            hash ^= hash >> 32;
+        }
+        for (; i < bytes.size(); ++i)
+            hash = (hash ^ std::uint64_t(bytes[i])) * 0x100000001b3ull;
+        return hash;
+    }
+
     namespace detail {
         template<typename T, size_t ... Indices, typename ... Args>
         auto make_array_impl(std::index_sequence<Indices...>, Args&& ... args) {
@@ -59,6 +59,8 @@ namespace VCX::Labs::Rendering {
         std::array<Engine::Scene, Assets::ExampleScenes.size()> scenes;
         for (std::size_t i = 0; i < scenes.size(); i++) {
             scenes[i] = Engine::LoadScene(Assets::ExampleScenes[i]);
+            // the rasterizer and the ray tracer of this lab work on world-space Model::Mesh
+            scenes[i].BakeWorldSpaceMeshes();
             if (i == std::size_t(Assets::ExampleScene::SportsCar)) {
                 AddGround(scenes[i]);
             } else if (i == std::size_t(Assets::ExampleScene::WhiteOak)) {
@@ -0,0 +1,397 @@
+// BVH.cpp
+#include "Labs/final_hw/BVH.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+
+#include "Labs/final_hw/LinearBVH.h"
+#include "Labs/final_hw/Parallel.h"
+#include "Labs/final_hw/SpatialSplitBVH.h"
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        constexpr std::size_t c_MinParallelRefitNodes = 1 << 14; // 节点更少时 Refit 的线程开销超过收益
+        constexpr std::size_t c_RefitTasksPerThread   = 8;       // 切分出的子树数与线程数之比, 用于均衡负载
+        constexpr std::size_t c_BuildTasksPerThread   = 8;       // 并行收集三角形包围盒时的分段数与线程数之比
+    } // namespace
+
+    char const * GetBVHBuildModeName(BVHBuildMode const mode) {
+        switch (mode) {
+        case BVHBuildMode::SBVH: return "SBVH (Spatial Splits)";
+        case BVHBuildMode::LBVH: return "LBVH";
+        case BVHBuildMode::LBVHTreelet: return "LBVH + Treelets";
+        default: return "SAH";
+        }
+    }
+
+    void BVH::Build(Engine::SurfaceMesh const & mesh, BVHBuildMode const mode) {
+        auto const start = std::chrono::steady_clock::now();
+
+        // 收集网格中所有三角形的包围盒
+        std::vector<AABB> boxes(mesh.Indices.size() / 3);
+        ParallelForRange(boxes.size(), c_BuildTasksPerThread * GetThreadCount(), [&](std::size_t const begin, std::size_t const end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                AABB box;
+                box.Extend(mesh.Positions[mesh.Indices[3 * i + 0]]);
+                box.Extend(mesh.Positions[mesh.Indices[3 * i + 1]]);
+                box.Extend(mesh.Positions[mesh.Indices[3 * i + 2]]);
+                boxes[i] = box;
+            }
+        });
+        if (mode == BVHBuildMode::SBVH) {
+            _buildMode  = mode;
+            _inputCount = std::uint32_t(boxes.size());
+            BuildSpatialSplitBVH(mesh, boxes, c_MaxDuplication, c_MaxDepth, _nodes, _primitives);
+        } else BuildBoxes(boxes, mode);
+
+        // 图元此时是三角形的序号, 换成在 Indices 中的偏移
+        for (auto & prim : _primitives) prim *= 3;
+        _triangles.Build(mesh, _primitives);
+
+        _buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        _sahCost   = _buildSahCost = ComputeSAHCost();
+        spdlog::trace("VCX::Labs::Rendering::BVH::Build(..): {} triangles ({} references), {} nodes, {:.1f} ms.", _inputCount, _primitives.size(), _nodes.size(), _buildTime);
+    }
+
+    void BVH::Build(std::vector<AABB> const & boxes, BVHBuildMode const mode) {
+        auto const start = std::chrono::steady_clock::now();
+
+        BuildBoxes(boxes, mode);
+        _triangles = TriangleSoA();
+
+        _buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        _sahCost   = _buildSahCost = ComputeSAHCost();
+        spdlog::trace("VCX::Labs::Rendering::BVH::Build(..): {} boxes, {} nodes, {:.1f} ms.", _primitives.size(), _nodes.size(), _buildTime);
+    }
+
+    void BVH::BuildBoxes(std::vector<AABB> const & boxes, BVHBuildMode const mode) {
+        _buildMode  = mode;
+        _inputCount = std::uint32_t(boxes.size());
+        if (mode == BVHBuildMode::LBVH || mode == BVHBuildMode::LBVHTreelet) {
+            BuildLinearBVH(boxes, mode == BVHBuildMode::LBVHTreelet, c_MaxDepth, _nodes, _primitives);
+            return;
+        }
+
+        std::vector<BuildItem> items(boxes.size());
+        for (std::size_t i = 0; i < boxes.size(); ++i) items[i] = { boxes[i], boxes[i].Centroid() };
+        BuildItems(items);
+    }
+
+    void BVH::BuildItems(std::vector<BuildItem> const & items) {
+        _nodes.clear();
+        _order.resize(items.size());
+        std::iota(_order.begin(), _order.end(), 0);
+        if (! items.empty()) {
+            _nodes.reserve(2 * items.size());
+            BuildRecursive(items, 0, std::uint32_t(items.size()), 0);
+            _nodes.shrink_to_fit();
+        }
+
+        // 构建结束时的排列即叶节点中的图元顺序
+        _primitives.swap(_order);
+        _order.clear();
+        _order.shrink_to_fit();
+    }
+
+    std::uint32_t BVH::BuildRecursive(std::vector<BuildItem> const & items, std::uint32_t const begin, std::uint32_t const end, int const depth) {
+        std::uint32_t const nodeIdx = std::uint32_t(_nodes.size());
+        _nodes.emplace_back();
+
+        AABB bounds, centroidBounds;
+        for (std::uint32_t i = begin; i < end; ++i) {
+            bounds.Extend(items[_order[i]].Bounds);
+            centroidBounds.Extend(items[_order[i]].Centroid);
+        }
+        _nodes[nodeIdx].Bounds = bounds;
+
+        std::uint32_t const count    = end - begin;
+        auto const          MakeLeaf = [&]() {
+            _nodes[nodeIdx].Offset = begin;
+            _nodes[nodeIdx].Count  = count;
+            return nodeIdx;
+        };
+        if (count == 1 || depth >= c_MaxDepth) return MakeLeaf();
+
+        // 分桶 SAH: 在三个轴上寻找代价最小的划分
+        struct Bin {
+            AABB          Bounds;
+            std::uint32_t Count = 0;
+        };
+        glm::vec3 const extent     = centroidBounds.Max - centroidBounds.Min;
+        float const     parentArea = glm::max(bounds.SurfaceArea(), std::numeric_limits<float>::min());
+        float           bestCost   = std::numeric_limits<float>::max();
+        int             bestAxis   = -1;
+        int             bestSplit  = -1;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 0.0f) continue;
+            std::array<Bin, c_NumBins> bins;
+            float const                scale = c_NumBins / extent[axis];
+            for (std::uint32_t i = begin; i < end; ++i) {
+                auto const & item = items[_order[i]];
+                int const    b    = glm::min(int((item.Centroid[axis] - centroidBounds.Min[axis]) * scale), c_NumBins - 1);
+                bins[b].Count++;
+                bins[b].Bounds.Extend(item.Bounds);
+            }
+
+            std::array<float, c_NumBins - 1>         leftArea;
+            std::array<std::uint32_t, c_NumBins - 1> leftCount;
+            AABB                                     leftBox;
+            std::uint32_t                            leftN = 0;
+            for (int i = 0; i < c_NumBins - 1; ++i) {
+                leftBox.Extend(bins[i].Bounds);
+                leftN += bins[i].Count;
+                leftArea[i]  = leftBox.SurfaceArea();
+                leftCount[i] = leftN;
+            }
+
+            AABB          rightBox;
+            std::uint32_t rightN = 0;
+            for (int i = c_NumBins - 1; i > 0; --i) {
+                rightBox.Extend(bins[i].Bounds);
+                rightN += bins[i].Count;
+                if (leftCount[i - 1] == 0 || rightN == 0) continue;
+                float const cost = c_TraversalCost + c_IntersectCost * (leftArea[i - 1] * leftCount[i - 1] + rightBox.SurfaceArea() * rightN) / parentArea;
+                if (cost < bestCost) {
+                    bestCost  = cost;
+                    bestAxis  = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        // 所有质心重合, 无法继续划分
+        if (bestAxis < 0) return MakeLeaf();
+        if (bestCost >= c_IntersectCost * count && count <= c_MaxLeafSize) return MakeLeaf();
+
+        float const scale = c_NumBins / extent[bestAxis];
+        auto const  mid   = std::partition(_order.begin() + begin, _order.begin() + end, [&](std::uint32_t const idx) {
+            int const b = glm::min(int((items[idx].Centroid[bestAxis] - centroidBounds.Min[bestAxis]) * scale), c_NumBins - 1);
+            return b < bestSplit;
+        });
+        std::uint32_t split = std::uint32_t(mid - _order.begin());
+        if (split == begin || split == end) {
+            // 浮点误差导致划分失败时退化为中位数划分
+            split = begin + count / 2;
+            std::nth_element(_order.begin() + begin, _order.begin() + split, _order.begin() + end, [&](std::uint32_t const a, std::uint32_t const b) {
+                return items[a].Centroid[bestAxis] < items[b].Centroid[bestAxis];
+            });
+        }
+
+        BuildRecursive(items, begin, split, depth + 1);
+        std::uint32_t const right = BuildRecursive(items, split, end, depth + 1);
+        _nodes[nodeIdx].Offset    = right;
+        _nodes[nodeIdx].Count     = 0;
+        return nodeIdx;
+    }
+
+    void BVH::Refit(Engine::SurfaceMesh const & mesh) {
+        if (mesh.Indices.size() / 3 != _inputCount || _triangles.Size() != _primitives.size()) {
+            spdlog::warn("VCX::Labs::Rendering::BVH::Refit(..): mesh topology changed, rebuilding.");
+            Build(mesh, _buildMode);
+            return;
+        }
+        auto const start = std::chrono::steady_clock::now();
+
+        RefitNodes([&](std::uint32_t const first, std::uint32_t const count) {
+            AABB bounds;
+            for (std::uint32_t i = first; i < first + count; ++i) {
+                bounds.Extend(mesh.Positions[mesh.Indices[_primitives[i] + 0]]);
+                bounds.Extend(mesh.Positions[mesh.Indices[_primitives[i] + 1]]);
+                bounds.Extend(mesh.Positions[mesh.Indices[_primitives[i] + 2]]);
+            }
+            return bounds;
+        });
+        _triangles.Build(mesh, _primitives);
+
+        _refitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        _sahCost   = ComputeSAHCost();
+        spdlog::trace("VCX::Labs::Rendering::BVH::Refit(..): {} nodes, SAH cost {:.2f} (built {:.2f}), {:.2f} ms.", _nodes.size(), _sahCost, _buildSahCost, _refitTime);
+    }
+
+    void BVH::Refit(std::vector<AABB> const & boxes) {
+        if (boxes.size() != _inputCount || _triangles.Size() != 0) {
+            spdlog::warn("VCX::Labs::Rendering::BVH::Refit(..): box count changed, rebuilding.");
+            Build(boxes, _buildMode);
+            return;
+        }
+        auto const start = std::chrono::steady_clock::now();
+
+        RefitNodes([&](std::uint32_t const first, std::uint32_t const count) {
+            AABB bounds;
+            for (std::uint32_t i = first; i < first + count; ++i) bounds.Extend(boxes[_primitives[i]]);
+            return bounds;
+        });
+
+        _refitTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        _sahCost   = ComputeSAHCost();
+        spdlog::trace("VCX::Labs::Rendering::BVH::Refit(..): {} nodes, SAH cost {:.2f} (built {:.2f}), {:.2f} ms.", _nodes.size(), _sahCost, _buildSahCost, _refitTime);
+    }
+
+    template<typename LeafBounds>
+    void BVH::RefitNodes(LeafBounds const & leafBounds) {
+        // 节点按先序排列, 以 n 为根的子树占据连续区间 [n, end), 孩子的下标总大于父节点;
+        // 在区间内从后向前更新, 访问内部节点时两个孩子都已更新
+        auto const RefitRange = [&](std::uint32_t const begin, std::uint32_t const end) {
+            for (std::uint32_t i = end; i-- > begin;) {
+                BVHNode & node = _nodes[i];
+                if (node.IsLeaf()) {
+                    node.Bounds = leafBounds(node.Offset, node.Count);
+                } else {
+                    node.Bounds = _nodes[i + 1].Bounds;
+                    node.Bounds.Extend(_nodes[node.Offset].Bounds);
+                }
+            }
+        };
+
+        std::uint32_t const size = std::uint32_t(_nodes.size());
+        if (size < c_MinParallelRefitNodes) {
+            RefitRange(0, size);
+            return;
+        }
+
+        // 从根向下切分, 直到子树足够小; 各子树互不重叠, 可以并行更新, 切口以上的节点最后按先序的逆序更新
+        struct Range {
+            std::uint32_t Begin, End;
+        };
+        std::size_t const          grain = size / (c_RefitTasksPerThread * GetThreadCount()) + 1;
+        std::vector<Range>         subtrees;
+        std::vector<Range>         stack { { 0, size } };
+        std::vector<std::uint32_t> upper;
+        while (! stack.empty()) {
+            Range const range = stack.back();
+            stack.pop_back();
+            BVHNode const & node = _nodes[range.Begin];
+            if (node.IsLeaf() || range.End - range.Begin <= grain) {
+                subtrees.push_back(range);
+                continue;
+            }
+            upper.push_back(range.Begin);
+            stack.push_back({ node.Offset, range.End });
+            stack.push_back({ range.Begin + 1, node.Offset });
+        }
+        ParallelFor(subtrees.size(), [&](std::size_t const i) { RefitRange(subtrees[i].Begin, subtrees[i].End); });
+        for (auto it = upper.rbegin(); it != upper.rend(); ++it) RefitRange(*it, *it + 1);
+    }
+
+    bool BVH::Intersect(BVHHit & hit, Ray const & ray, float const tMin, float tMax) const {
+        if (_nodes.empty()) return false;
+
+        // t 以归一化方向度量, 方向每条光线只归一化一次
+        glm::vec3 const   dir    = glm::normalize(ray.Direction);
+        glm::vec3 const   invDir = 1.0f / dir;
+        glm::vec3 const   origin = ray.Origin;
+        TriangleRay const tri(origin, dir);
+
+        struct StackEntry {
+            std::uint32_t Node;
+            float         TEntry;
+        };
+        std::array<StackEntry, c_MaxDepth + 1> stack;
+        int                                    top = 0;
+
+        float tRoot;
+        if (! IntersectAABB(_nodes[0].Bounds, origin, invDir, tMin, tMax, tRoot)) return false;
+        stack[top++] = { 0, tRoot };
+
+        bool found = false;
+        while (top > 0) {
+            auto const entry = stack[--top];
+            if (entry.TEntry > tMax) continue;
+            BVHNode const & node = _nodes[entry.Node];
+
+            if (node.IsLeaf()) {
+                found |= IntersectLeaf(_triangles, _primitives, node.Offset, node.Count, tri, tMin, tMax, hit);
+                continue;
+            }
+
+            // 先访问较近的孩子
+            std::uint32_t const left  = entry.Node + 1;
+            std::uint32_t const right = node.Offset;
+            float               tLeft, tRight;
+            bool const          hitLeft  = IntersectAABB(_nodes[left].Bounds, origin, invDir, tMin, tMax, tLeft);
+            bool const          hitRight = IntersectAABB(_nodes[right].Bounds, origin, invDir, tMin, tMax, tRight);
+            if (hitLeft && hitRight) {
+                if (tLeft < tRight) {
+                    stack[top++] = { right, tRight };
+                    stack[top++] = { left, tLeft };
+                } else {
+                    stack[top++] = { left, tLeft };
+                    stack[top++] = { right, tRight };
+                }
+            } else if (hitLeft) {
+                stack[top++] = { left, tLeft };
+            } else if (hitRight) {
+                stack[top++] = { right, tRight };
+            }
+        }
+        return found;
+    }
+
+    bool BVH::Occluded(Ray const & ray, float const tMin, float const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        if (_nodes.empty()) return false;
+
+        glm::vec3 const   dir    = glm::normalize(ray.Direction);
+        glm::vec3 const   invDir = 1.0f / dir;
+        glm::vec3 const   origin = ray.Origin;
+        TriangleRay const tri(origin, dir);
+
+        // 只需判断是否存在交点, 不必记录进入距离
+        std::array<std::uint32_t, c_MaxDepth + 1> stack;
+        int                                       top = 0;
+
+        float tEntry;
+        if (! IntersectAABB(_nodes[0].Bounds, origin, invDir, tMin, tMax, tEntry)) return false;
+        stack[top++] = 0;
+
+        while (top > 0) {
+            std::uint32_t const nodeIdx = stack[--top];
+            BVHNode const &     node    = _nodes[nodeIdx];
+
+            if (node.IsLeaf()) {
+                if (OccludedLeaf(_triangles, _primitives, node.Offset, node.Count, tri, tMin, tMax, accept)) return true;
+                continue;
+            }
+
+            std::uint32_t const left  = nodeIdx + 1;
+            std::uint32_t const right = node.Offset;
+            if (IntersectAABB(_nodes[right].Bounds, origin, invDir, tMin, tMax, tEntry)) stack[top++] = right;
+            if (IntersectAABB(_nodes[left].Bounds, origin, invDir, tMin, tMax, tEntry)) stack[top++] = left;
+        }
+        return false;
+    }
+
+    std::size_t BVH::GetMemoryUsage() const {
+        return _nodes.size() * sizeof(BVHNode) + _primitives.size() * sizeof(std::uint32_t) + _triangles.GetMemoryUsage();
+    }
+
+    void BVH::Serialize(ByteWriter & writer) const {
+        writer.Write(_buildMode);
+        writer.Write(_inputCount);
+        writer.Write(_nodes);
+        writer.Write(_primitives);
+        writer.Write(_sahCost);
+        writer.Write(_buildSahCost);
+        _triangles.Serialize(writer);
+    }
+
+    bool BVH::Deserialize(ByteReader & reader) {
+        _buildTime = _refitTime = 0.0f;
+        return reader.Read(_buildMode) && reader.Read(_inputCount) && reader.Read(_nodes) && reader.Read(_primitives) && reader.Read(_sahCost) && reader.Read(_buildSahCost) && _triangles.Deserialize(reader);
+    }
+
+    float BVH::ComputeSAHCost() const {
+        if (_nodes.empty()) return 0.0f;
+        float const rootArea = glm::max(_nodes[0].Bounds.SurfaceArea(), std::numeric_limits<float>::min());
+        float       cost     = 0.0f;
+        for (auto const & node : _nodes) {
+            float const ratio = node.Bounds.SurfaceArea() / rootArea;
+            cost += node.IsLeaf() ? c_IntersectCost * node.Count * ratio : c_TraversalCost * ratio;
+        }
+        return cost;
+    }
+
+} // namespace VCX::Labs::Rendering
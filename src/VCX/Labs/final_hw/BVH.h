@@ -0,0 +1,213 @@
+// BVH.h
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Engine/SurfaceMesh.h"
+#include "Labs/final_hw/Ray.h"
+#include "Labs/final_hw/TriangleSoA.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 轴对齐包围盒
+    struct AABB {
+        glm::vec3 Min { std::numeric_limits<float>::max() };
+        glm::vec3 Max { std::numeric_limits<float>::lowest() };
+
+        void Extend(glm::vec3 const & p) {
+            Min = glm::min(Min, p);
+            Max = glm::max(Max, p);
+        }
+
+        void Extend(AABB const & box) {
+            Min = glm::min(Min, box.Min);
+            Max = glm::max(Max, box.Max);
+        }
+
+        glm::vec3 Centroid() const { return (Min + Max) * 0.5f; }
+
+        float SurfaceArea() const {
+            glm::vec3 const d = glm::max(Max - Min, glm::vec3(0.0f));
+            return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+    };
+
+    // slab 法求光线与包围盒的进入距离, 不相交时返回 false
+    inline bool IntersectAABB(AABB const & box, glm::vec3 const & origin, glm::vec3 const & invDir, float const tMin, float const tMax, float & tEntry) {
+        glm::vec3 const t0    = (box.Min - origin) * invDir;
+        glm::vec3 const t1    = (box.Max - origin) * invDir;
+        glm::vec3 const tNear = glm::min(t0, t1);
+        glm::vec3 const tFar  = glm::max(t0, t1);
+        float const     enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, tMin));
+        float const     exit  = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+        tEntry                = enter;
+        return enter <= exit;
+    }
+
+    // 扁平化的BVH节点 (32字节), 左孩子紧跟在父节点之后
+    struct BVHNode {
+        AABB          Bounds;
+        std::uint32_t Offset; // 叶节点: 第一个图元的下标; 内部节点: 右孩子的下标
+        std::uint32_t Count;  // 叶节点中的图元数, 0 表示内部节点
+
+        bool IsLeaf() const { return Count > 0; }
+    };
+
+    // 最近交点; 底层 BVH 只填写 FaceIndex, ModelIndex 由顶层填写
+    struct BVHHit {
+        float         T, U, V;
+        std::uint32_t ModelIndex;
+        std::uint32_t FaceIndex;
+    };
+
+    class CacheModel;
+
+    // 遍历统计: 光线数, 访问的内部节点数与求交的三角形数, 用于比较不同构建算法得到的树;
+    // 给出 Cache 时访问的节点与三角形数据还按地址送入这个缓存模型, 用于比较不同的光线顺序
+    struct TraversalStats {
+        std::uint64_t Rays      = 0;
+        std::uint64_t Hits      = 0;
+        std::uint64_t Nodes     = 0;
+        std::uint64_t Triangles = 0;
+        CacheModel *  Cache     = nullptr;
+    };
+
+    // 与叶节点中 [first, first + count) 的三角形求交, 命中更近的交点时更新 hit 与 tMax
+    inline bool IntersectLeaf(
+        TriangleSoA const &                tris,
+        std::vector<std::uint32_t> const & primitives,
+        std::uint32_t const                first,
+        std::uint32_t const                count,
+        TriangleRay const &                ray,
+        float const                        tMin,
+        float &                            tMax,
+        BVHHit &                           hit) {
+        bool found = false;
+        for (std::uint32_t i = first; i < first + count; i += TriangleSoA::c_Lanes) {
+            float t[TriangleSoA::c_Lanes], u[TriangleSoA::c_Lanes], v[TriangleSoA::c_Lanes];
+            int   mask = IntersectTriangles(tris, i, std::min<std::uint32_t>(TriangleSoA::c_Lanes, first + count - i), ray, tMin, tMax, t, u, v);
+            for (; mask; mask &= mask - 1) {
+                int const k = std::countr_zero(unsigned(mask));
+                if (t[k] > tMax) continue;
+                tMax          = t[k];
+                hit.T         = t[k];
+                hit.U         = u[k];
+                hit.V         = v[k];
+                hit.FaceIndex = primitives[i + k];
+                found         = true;
+            }
+        }
+        return found;
+    }
+
+    // 叶节点中 [first, first + count) 的三角形是否存在被 accept 接受的交点; accept 为空时接受所有交点
+    inline bool OccludedLeaf(
+        TriangleSoA const &                          tris,
+        std::vector<std::uint32_t> const &           primitives,
+        std::uint32_t const                          first,
+        std::uint32_t const                          count,
+        TriangleRay const &                          ray,
+        float const                                  tMin,
+        float const                                  tMax,
+        std::function<bool(BVHHit const &)> const & accept) {
+        for (std::uint32_t i = first; i < first + count; i += TriangleSoA::c_Lanes) {
+            float t[TriangleSoA::c_Lanes], u[TriangleSoA::c_Lanes], v[TriangleSoA::c_Lanes];
+            int   mask = IntersectTriangles(tris, i, std::min<std::uint32_t>(TriangleSoA::c_Lanes, first + count - i), ray, tMin, tMax, t, u, v);
+            if (mask && ! accept) return true;
+            for (; mask; mask &= mask - 1) {
+                int const k = std::countr_zero(unsigned(mask));
+                if (accept(BVHHit { t[k], u[k], v[k], 0, primitives[i + k] })) return true;
+            }
+        }
+        return false;
+    }
+
+    // 构建算法: 分桶 SAH 递归划分; SBVH 在 SAH 的基础上允许按空间位置划分并复制跨越平面的三角形, 构建最慢,
+    // 细长三角形多时质量最好 (只适用于三角形, 建在包围盒上时等同于 SAH); LBVH 按 Morton 码排序后并行构建,
+    // 快数倍但树的质量较差; LBVHTreelet 在 LBVH 上再做 treelet 重排, 构建时间与质量都介于 LBVH 与 SAH 之间
+    enum class BVHBuildMode : std::uint32_t {
+        SAH,
+        SBVH,
+        LBVH,
+        LBVHTreelet,
+    };
+
+    char const * GetBVHBuildModeName(BVHBuildMode mode);
+
+    // 基于表面积启发式 (SAH) 构建的包围盒层次结构, 可以建在一个网格的三角形上 (底层),
+    // 也可以建在任意一组包围盒上 (如实例的包围盒, 由调用者遍历节点)
+    class BVH {
+    public:
+        static constexpr int   c_NumBins        = 16;
+        static constexpr int   c_MaxLeafSize    = 8;
+        static constexpr int   c_MaxDepth       = 64;
+        static constexpr float c_TraversalCost  = 1.0f;
+        static constexpr float c_IntersectCost  = 1.0f;
+        static constexpr float c_MaxCostGrowth  = 1.5f; // Refit 后的 SAH 代价超过构建时的这一倍数即视为退化, 应当重建
+        static constexpr float c_MaxDuplication = 0.3f; // SBVH 因空间划分新增的三角形引用至多为三角形数的这一比例
+
+        void Build(Engine::SurfaceMesh const & mesh, BVHBuildMode mode = BVHBuildMode::SAH);
+        void Build(std::vector<AABB> const & boxes, BVHBuildMode mode = BVHBuildMode::SAH);
+
+        // 图元的位置改变而拓扑不变时, 保持树结构与图元顺序, 自底向上 (大树并行) 重算节点包围盒;
+        // 网格或包围盒的数目与构建时不同则以原来的构建算法重建
+        void Refit(Engine::SurfaceMesh const & mesh);
+        void Refit(std::vector<AABB> const & boxes);
+
+        // 求 [tMin, tMax] 内的最近交点, t 以归一化后的光线方向度量; 只适用于建在三角形上的 BVH
+        bool Intersect(BVHHit & hit, Ray const & ray, float tMin, float tMax) const;
+
+        // [tMin, tMax] 内是否存在被 accept 接受的交点, 找到第一个即返回; accept 为空时接受所有交点
+        bool Occluded(Ray const & ray, float tMin, float tMax, std::function<bool(BVHHit const &)> const & accept = nullptr) const;
+
+        bool                              IsEmpty() const { return _nodes.empty(); }
+        std::vector<BVHNode> const &      GetNodes() const { return _nodes; }
+        std::vector<std::uint32_t> const & GetPrimitives() const { return _primitives; } // SBVH 中同一图元可能出现多次
+        std::size_t                        GetInputCount() const { return _inputCount; }   // 构建时的三角形或包围盒数
+        TriangleSoA const &                GetTriangles() const { return _triangles; }
+        BVHBuildMode                       GetBuildMode() const { return _buildMode; }
+        float                              GetBuildTime() const { return _buildTime; } // 毫秒
+        float                              GetRefitTime() const { return _refitTime; } // 毫秒, 最近一次 Refit
+        float                              GetSAHCost() const { return _sahCost; }
+        float                              GetBuildSAHCost() const { return _buildSahCost; } // 最近一次构建时的 SAH 代价
+        bool                               IsDegraded() const { return _sahCost > c_MaxCostGrowth * _buildSahCost; }
+        std::size_t                        GetMemoryUsage() const; // 节点, 图元与三角形数据占用的字节数
+
+        // 写入/读回缓存文件; 读回的 BVH 构建时间为 0
+        void Serialize(ByteWriter & writer) const;
+        bool Deserialize(ByteReader & reader);
+
+    private:
+        struct BuildItem {
+            AABB      Bounds;
+            glm::vec3 Centroid;
+        };
+
+        void          BuildBoxes(std::vector<AABB> const & boxes, BVHBuildMode mode);
+        void          BuildItems(std::vector<BuildItem> const & items);
+        std::uint32_t BuildRecursive(std::vector<BuildItem> const & items, std::uint32_t begin, std::uint32_t end, int depth);
+        float         ComputeSAHCost() const;
+
+        template<typename LeafBounds>
+        void RefitNodes(LeafBounds const & leafBounds);
+
+        std::vector<BVHNode>       _nodes;
+        std::vector<std::uint32_t> _primitives; // 按叶节点顺序排列的图元: 三角形在 Mesh.Indices 中的偏移, 或包围盒的下标
+        TriangleSoA                _triangles;  // 与 _primitives 顺序一致, 建在包围盒上时为空
+        std::vector<std::uint32_t> _order; // 构建时的图元排列
+        BVHBuildMode               _buildMode    = BVHBuildMode::SAH;
+        std::uint32_t              _inputCount   = 0;
+        float                      _buildTime    = 0.0f;
+        float                      _refitTime    = 0.0f;
+        float                      _sahCost      = 0.0f;
+        float                      _buildSahCost = 0.0f;
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,74 @@
+// ByteStream.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace VCX::Labs::Rendering {
+
+    // 加速结构写入缓存文件时的顺序写入: 标量写原始字节, 数组先写 64 位元素个数再写原始字节
+    class ByteWriter {
+    public:
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        void Write(T const & value) {
+            auto const bytes = std::as_bytes(std::span(&value, 1));
+            _bytes.insert(_bytes.end(), bytes.begin(), bytes.end());
+        }
+
+        template<typename T>
+        void Write(std::vector<T> const & values) {
+            Write(std::uint64_t(values.size()));
+            auto const bytes = std::as_bytes(std::span(values));
+            _bytes.insert(_bytes.end(), bytes.begin(), bytes.end());
+        }
+
+        std::span<std::byte const> GetBytes() const { return _bytes; }
+
+    private:
+        std::vector<std::byte> _bytes;
+    };
+
+    // 与 ByteWriter 对应的顺序读取; 剩余字节不足时返回 false, 之后的读取也都失败
+    class ByteReader {
+    public:
+        explicit ByteReader(std::span<std::byte const> const bytes):
+            _bytes(bytes) {}
+
+        template<typename T>
+            requires std::is_trivially_copyable_v<T>
+        bool Read(T & value) {
+            if (_failed || sizeof(T) > _bytes.size()) return Fail();
+            std::memcpy(&value, _bytes.data(), sizeof(T));
+            _bytes = _bytes.subspan(sizeof(T));
+            return true;
+        }
+
+        template<typename T>
+        bool Read(std::vector<T> & values) {
+            std::uint64_t count;
+            if (! Read(count)) return false;
+            if (count > _bytes.size() / sizeof(T)) return Fail();
+            values.resize(count);
+            std::memcpy(values.data(), _bytes.data(), count * sizeof(T));
+            _bytes = _bytes.subspan(count * sizeof(T));
+            return true;
+        }
+
+        bool IsEnd() const { return ! _failed && _bytes.empty(); }
+
+    private:
+        bool Fail() {
+            _failed = true;
+            return false;
+        }
+
+        std::span<std::byte const> _bytes;
+        bool                       _failed = false;
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,62 @@
+// CacheModel.h
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VCX::Labs::Rendering {
+
+    // 组相联 LRU 缓存的软件模型, 按 64 字节的缓存行记录访问; 没有硬件计数器时用它估计遍历的缓存缺失.
+    // 只模拟一级缓存, 不考虑预取, 结果用于比较访问顺序而不是预测真实的缺失数
+    class CacheModel {
+    public:
+        static constexpr std::size_t c_LineSize = 64;
+
+        CacheModel(std::size_t const bytes, std::size_t const ways):
+            _ways(ways),
+            _sets(std::max<std::size_t>(1, bytes / (c_LineSize * ways))),
+            _tags(_sets * ways, c_Invalid) {}
+
+        // 访问 [data, data + bytes) 覆盖的每个缓存行
+        void Access(void const * const data, std::size_t const bytes) {
+            if (bytes == 0) return;
+            std::uintptr_t const first = reinterpret_cast<std::uintptr_t>(data) / c_LineSize;
+            std::uintptr_t const last  = (reinterpret_cast<std::uintptr_t>(data) + bytes - 1) / c_LineSize;
+            for (std::uintptr_t line = first; line <= last; ++line) AccessLine(line);
+        }
+
+        void Reset() {
+            std::fill(_tags.begin(), _tags.end(), c_Invalid);
+            _accesses = 0;
+            _misses   = 0;
+        }
+
+        std::uint64_t GetAccesses() const { return _accesses; }
+        std::uint64_t GetMisses() const { return _misses; }
+
+    private:
+        static constexpr std::uintptr_t c_Invalid = ~std::uintptr_t(0);
+
+        // 每组的标签按最近使用的顺序排列, 命中的行移到组首, 缺失时淘汰组尾
+        void AccessLine(std::uintptr_t const line) {
+            ++_accesses;
+            auto const set = _tags.begin() + (line % _sets) * _ways;
+            auto       it  = std::find(set, set + _ways, line);
+            if (it == set + _ways) {
+                ++_misses;
+                it = set + _ways - 1;
+            }
+            std::rotate(set, it, it + 1);
+            *set = line;
+        }
+
+        std::size_t                 _ways;
+        std::size_t                 _sets;
+        std::vector<std::uintptr_t> _tags;
+        std::uint64_t               _accesses = 0;
+        std::uint64_t               _misses   = 0;
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -2,13 +2,19 @@
 #include "Labs/final_hw/CasePathTracing.h"
 #include <glm/gtc/type_ptr.hpp>
 #include <imgui.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
 #include <random>
+#include <span>
+#include <vector>
 namespace VCX::Labs::Rendering {
 
     CasePathTracing::CasePathTracing(std::initializer_list<Assets::ExampleScene> && scenes):
         _scenes(scenes),
         _program(
-            Engine::GL::UniqueProgram({ Engine::GL::SharedShader("assets/shaders/flat.vert"), Engine::GL::SharedShader("assets/shaders/flat.frag") })),
+            Engine::GL::UniqueProgram({ Engine::GL::SharedShader("assets/shaders/flat-instanced.vert"), Engine::GL::SharedShader("assets/shaders/flat.frag") })),
         _sceneObject(4),
         _texture({ .MinFilter = Engine::GL::FilterMode::Linear, .MagFilter = Engine::GL::FilterMode::Nearest }) {
         _cameraManager.AutoRotate = false;
@@ -16,8 +22,7 @@ namespace VCX::Labs::Rendering {
     }
 
     CasePathTracing::~CasePathTracing() {
-        _stopFlag = true;
-        if (_task.joinable()) _task.join();
+        StopRendering();
     }
 
     void CasePathTracing::OnSetupPropsUI() {
@@ -26,10 +31,13 @@ namespace VCX::Labs::Rendering {
                 bool selected = i == _sceneIdx;
                 if (ImGui::Selectable(GetSceneName(i), selected)) {
                     if (! selected) {
-                        _sceneIdx   = i;
-                        _sceneDirty = true;
-                        _treeDirty  = true;
-                        _resetDirty = true;
+                        StopRendering();
+                        _sceneIdx       = i;
+                        _sceneLoading   = {};
+                        _sceneDirty     = true;
+                        _treeDirty      = true;
+                        _resetDirty     = true;
+                        _traversalStats = {};
                     }
                 }
             }
@@ -48,11 +56,8 @@ namespace VCX::Labs::Rendering {
 
         if (ImGui::Button("Reset Scene")) _resetDirty = true;
         ImGui::SameLine();
-        if (_task.joinable()) {
-            if (ImGui::Button("Stop Rendering")) {
-                _stopFlag = true;
-                if (_task.joinable()) _task.join();
-            }
+        if (_renderer.IsRunning()) {
+            if (ImGui::Button("Stop Rendering")) StopRendering();
         } else if (ImGui::Button("Start Rendering")) _stopFlag = false;
 
         ImGui::ProgressBar(float(_pixelIndex) / (_buffer.GetSizeX() * _buffer.GetSizeY()));
@@ -91,10 +96,52 @@ namespace VCX::Labs::Rendering {
             _resetDirty |= ImGui::SliderFloat("Sky Light", &_skyLightIntensity, 0.0f, 2.0f);
             _resetDirty |= ImGui::ColorEdit3("Sky Color", glm::value_ptr(_skyLightColor), ImGuiColorEditFlags_Float);
 
+            if (ImGui::BeginCombo("Sampler", GetSamplerName(_samplerType))) {
+                for (auto const type : { SamplerType::Independent, SamplerType::Stratified, SamplerType::Sobol }) {
+                    if (ImGui::Selectable(GetSamplerName(type), type == _samplerType) && type != _samplerType) {
+                        _samplerType = type;
+                        _resetDirty  = true;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Low-discrepancy samplers reach the same noise level with fewer samples");
+            }
+
             _resetDirty |= ImGui::SliderInt("Super Sample", &_superSampleRate, 1, 4);
             if (ImGui::IsItemHovered()) {
                 ImGui::SetTooltip("Anti-aliasing quality (ray samples per pixel)");
             }
+
+            if (ImGui::BeginCombo("BVH Builder", GetBVHBuildModeName(_buildMode))) {
+                for (auto const mode : { BVHBuildMode::SAH, BVHBuildMode::SBVH, BVHBuildMode::LBVH, BVHBuildMode::LBVHTreelet }) {
+                    if (ImGui::Selectable(GetBVHBuildModeName(mode), mode == _buildMode) && mode != _buildMode) {
+                        StopRendering();
+                        _buildMode      = mode;
+                        _treeDirty      = true;
+                        _resetDirty     = true;
+                        _traversalStats = {};
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("SBVH splits long thin triangles across nodes for faster traversal; LBVH builds several times faster than SAH at some cost in trace speed");
+            }
+            if (ImGui::Checkbox("Quantized Nodes", &_quantizedNodes)) {
+                StopRendering();
+                _treeDirty      = true;
+                _resetDirty     = true;
+                _traversalStats = {};
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Stores BVH4 child boxes as 8-bit offsets in one cache line per node; halves BVH memory, pays off once it no longer fits in cache");
+            }
+            ImGui::Checkbox("Wavefront", &_wavefront);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Traces each bounce of a whole tile together, sorted by direction and origin so that secondary rays stay coherent; same image, applies from the next render");
+            }
         }
         ImGui::Spacing();
 
@@ -106,9 +153,17 @@ namespace VCX::Labs::Rendering {
 
             ImGui::Text("Resolution: %d x %d", width, height);
             ImGui::Text("Total Rays: ~%dM", totalSamples / 1000000);
-            ImGui::Text("Progress: %d / %d pixels", _pixelIndex, totalPixels);
+            ImGui::Text("Progress: %d / %d pixels", int(_pixelIndex.load()), int(totalPixels));
+            ImGui::Text("Threads: %u (%dx%d tiles)", _renderer.GetThreadCount(), int(TileRenderer::c_TileSize), int(TileRenderer::c_TileSize));
+            if (! _treeDirty.load(std::memory_order_acquire)) {
+                auto const & bvh = _intersector.InternalBVH;
+                ImGui::Text("BVH: %d instances of %d meshes, %d triangles", int(_intersector.InternalSnapshot.GetInstanceCount()), int(bvh.GetBottomLevelCount()), int(bvh.GetTriangleCount()));
+                ImGui::Text("BVH4: %d %snodes in bottom levels, top level %d nodes", int(bvh.GetWideNodeCount()), _quantizedNodes ? "quantized " : "", int(bvh.GetTopLevel().GetNodes().size()));
+                ImGui::Text("BVH %s Time: %.1f ms (top level %.2f ms)", bvh.IsLoadedFromCache() ? "Load" : "Build", bvh.GetBuildTime(), bvh.GetTopLevel().GetBuildTime());
+                ImGui::Text("BVH SAH Cost: %.2f (%s)", bvh.GetSAHCost(), GetBVHBuildModeName(_buildMode));
+            }
 
-            if (_task.joinable()) {
+            if (_renderer.IsRunning()) {
                 ImGui::TextColored(ImVec4(0, 1, 0, 1), "Rendering...");
             } else if (_pixelIndex == totalPixels) {
                 ImGui::TextColored(ImVec4(1, 1, 0, 1), "Render Complete");
@@ -118,25 +173,113 @@ namespace VCX::Labs::Rendering {
         }
         ImGui::Spacing();
 
+        if (ImGui::CollapsingHeader("Traversal Statistics")) {
+            if (_treeDirty.load(std::memory_order_acquire)) {
+                ImGui::TextDisabled("The BVH is built when rendering starts");
+            } else {
+                auto const & bvh = _intersector.InternalBVH;
+                ImGui::Text("Builder: %s", GetBVHBuildModeName(_buildMode));
+                ImGui::Text("References: %d (%.2fx triangles)", int(bvh.GetReferenceCount()), float(bvh.GetReferenceCount()) / std::max<std::size_t>(bvh.GetTriangleCount(), 1));
+                ImGui::Text("Memory: %.1f MB", bvh.GetMemoryUsage() / 1048576.0f);
+                if (ImGui::Button("Trace Camera Rays")) MeasureTraversal();
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Traces %dx%d primary rays through the current view and counts the work per ray", c_StatsResolution, c_StatsResolution);
+                }
+                if (_traversalStats.Rays > 0) {
+                    double const rays = double(_traversalStats.Rays);
+                    ImGui::Text("Hit Rate: %.1f%% (%.1f ms)", 100.0 * _traversalStats.Hits / rays, _traversalTime);
+                    ImGui::Text("Nodes/Ray: %.2f", _traversalStats.Nodes / rays);
+                    ImGui::Text("Triangles/Ray: %.2f", _traversalStats.Triangles / rays);
+                }
+            }
+        }
+        ImGui::Spacing();
+
+        if (ImGui::CollapsingHeader("Model Transform")) {
+            if (_sceneDirty || _modelOffsets.empty()) {
+                ImGui::TextDisabled("The scene is still loading");
+            } else {
+                ImGui::SliderInt("Model", &_editModel, 0, int(_modelOffsets.size()) - 1);
+                float const speed = 2e-3f * glm::length(_sceneObject.Camera.Target - _sceneObject.Camera.Eye);
+                if (ImGui::DragFloat3("Offset", glm::value_ptr(_modelOffsets[_editModel]), speed)) {
+                    StopRendering();
+                    glm::mat4 const transform = GetModelTransform(_editModel);
+                    _sceneObject.SetModelTransform(_editModel, transform);
+                    // BVH 尚未建好时由渲染线程的 prepare 在构建后应用
+                    if (! _treeDirty.load(std::memory_order_acquire)) {
+                        auto const start = std::chrono::steady_clock::now();
+                        _intersector.SetTransform(_editModel, transform);
+                        _transformTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    }
+                    _resetDirty     = true;
+                    _traversalStats = {};
+                }
+                if (ImGui::IsItemHovered()) {
+                    ImGui::SetTooltip("Moves the model; the BVH refits its top level over the instance boxes instead of being rebuilt");
+                }
+                if (_transformTime > 0.0f) ImGui::Text("Top Level Update: %.3f ms", _transformTime);
+            }
+        }
+        ImGui::Spacing();
+
         if (ImGui::CollapsingHeader("Control")) {
             ImGui::Checkbox("Zoom Tooltip", &_enableZoom);
         }
         ImGui::Spacing();
     }
 
+    glm::mat4 CasePathTracing::GetModelTransform(std::uint32_t const modelIdx) const {
+        // 没有共享网格的模型已在世界空间中, 平移直接作用在其顶点上
+        auto const & model     = _scene->Models[modelIdx];
+        glm::mat4    transform = model.MeshIndex < _scene->Meshes.size() ? model.Transform : glm::mat4(1.0f);
+        transform[3] += glm::vec4(_modelOffsets[modelIdx], 0.0f);
+        return transform;
+    }
+
+    void CasePathTracing::MeasureTraversal() {
+        auto const &    camera    = _sceneObject.Camera;
+        glm::vec3 const lookDir   = glm::normalize(camera.Target - camera.Eye);
+        glm::vec3 const rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
+        glm::vec3 const upDir     = glm::normalize(glm::cross(rightDir, lookDir));
+        float const     aspect    = _buffer.GetSizeY() > 0 ? _buffer.GetSizeX() * 1.f / _buffer.GetSizeY() : 1.f;
+        float const     fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
+
+        _traversalStats  = {};
+        auto const start = std::chrono::steady_clock::now();
+        for (int j = 0; j < c_StatsResolution; ++j) {
+            for (int i = 0; i < c_StatsResolution; ++i) {
+                glm::vec3 pixelLookDir = lookDir;
+                pixelLookDir += fovFactor * (2.0f * (j + 0.5f) / c_StatsResolution - 1.0f) * upDir;
+                pixelLookDir += fovFactor * aspect * (2.0f * (i + 0.5f) / c_StatsResolution - 1.0f) * rightDir;
+                BVHHit hit;
+                _intersector.InternalBVH.Intersect(hit, Ray(camera.Eye, glm::normalize(pixelLookDir)), 0.0f, 1e7f, _traversalStats);
+            }
+        }
+        _traversalTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
     Common::CaseRenderResult CasePathTracing::OnRender(std::pair<std::uint32_t, std::uint32_t> const desiredSize) {
         if (_resetDirty) {
-            _stopFlag = true;
-            if (_task.joinable()) _task.join();
+            StopRendering();
             _pixelIndex = 0;
             _resizable  = true;
             _resetDirty = false;
         }
 
         if (_sceneDirty) {
-            _sceneObject.ReplaceScene(GetScene(_sceneIdx));
-            _cameraManager.Save(_sceneObject.Camera);
-            _sceneDirty = false;
+            // 场景在首次选中时于后台加载, 加载完成前保持上一个场景的预览且不开始渲染
+            if (! _sceneLoading.valid()) _sceneLoading = Content::RequestScene(_scenes[_sceneIdx]);
+            if (_sceneLoading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                _scene        = _sceneLoading.get();
+                _sceneLoading = {};
+                Content::EvictUnused();
+                _sceneObject.ReplaceScene(*_scene);
+                _cameraManager.Save(_sceneObject.Camera);
+                _modelOffsets.assign(_scene->Models.size(), glm::vec3(0.0f));
+                _editModel     = 0;
+                _transformTime = 0.0f;
+                _sceneDirty    = false;
+            }
         }
 
         if (_resizable) {
@@ -149,94 +292,159 @@ namespace VCX::Labs::Rendering {
 
             glEnable(GL_DEPTH_TEST);
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            for (auto const & model : _sceneObject.OpaqueModels)
-                model.Mesh.Draw({ _program.Use() });
+            for (auto const & model : _sceneObject.OpaqueModels) {
+                _program.GetUniforms().SetByName("u_Model", model.Transform);
+                _sceneObject.Meshes[model.MeshIndex].Draw({ _program.Use() });
+            }
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             glDisable(GL_DEPTH_TEST);
         }
 
-        if (! _stopFlag && ! _task.joinable()) {
+        if (! _stopFlag && ! _renderer.IsRunning() && ! _sceneDirty) {
             if (_pixelIndex == 0) {
                 _resizable = false;
                 _buffer    = _frame.GetColorAttachment().Download<Engine::Formats::RGB8>();
+                _renderer.Reset(_buffer.GetSizeX(), _buffer.GetSizeY());
             }
 
-            _task = std::thread([&]() {
-                auto const width  = _buffer.GetSizeX();
-                auto const height = _buffer.GetSizeY();
-
-                if (_pixelIndex == 0 && _treeDirty) {
-                    Engine::Scene const & scene = GetScene(_sceneIdx);
-                    _intersector.InitScene(&scene);
-                    _treeDirty = false;
-                }
+            auto const width  = _buffer.GetSizeX();
+            auto const height = _buffer.GetSizeY();
+            _renderer.Start(
+                [&]() {
+                    if (_treeDirty.load(std::memory_order_acquire)) {
+                        _intersector.InitScene(_scene.get(), Content::GetBVHCachePath(_scenes[_sceneIdx], _buildMode, _quantizedNodes), _buildMode, _quantizedNodes);
+                        // InitScene 读取的是场景中的变换, 移动过的模型在此重新放置
+                        for (std::uint32_t i = 0; i < _modelOffsets.size(); ++i)
+                            if (_modelOffsets[i] != glm::vec3(0.0f)) _intersector.SetTransform(i, GetModelTransform(i));
+                        _treeDirty.store(false, std::memory_order_release);
+                    }
+                },
+                // Path Tracing渲染一个像素块: 序号相同的子样本在块内组成一个相机光线包;
+                // 波前模式下像素块即整个图块, 子样本攒成一波后一起推进
+                [&, width, height, wavefront = _wavefront](std::size_t const x0, std::size_t const y0, std::size_t const x1, std::size_t const y1) {
+                    constexpr std::size_t c_BlockPixels = TileRenderer::c_BlockSize * TileRenderer::c_BlockSize;
+                    std::size_t const     n             = (x1 - x0) * (y1 - y0);
+                    int const             subSamples    = _samplesPerPixel * _superSampleRate * _superSampleRate;
+
+                    auto const &    camera    = _sceneObject.Camera;
+                    glm::vec3 const lookDir   = glm::normalize(camera.Target - camera.Eye);
+                    glm::vec3 const rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
+                    glm::vec3 const upDir     = glm::normalize(glm::cross(rightDir, lookDir));
+                    float const     aspect    = width * 1.f / height;
+                    float const     fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
+
+                    // 像素 (i, j) 第 (dx, dy) 个子像素的相机光线, sampler 需已为该子样本调用过 StartPixelSample
+                    auto const CameraRay = [&](std::size_t const i, std::size_t const j, int const dx, int const dy, Sampler const & sampler) {
+                        float step = 1.0f / _superSampleRate;
+                        float di = step * (0.5f + dx), dj = step * (0.5f + dy);
+
+                        // 添加随机抖动以减少规则采样
+                        glm::vec2 const jitter = sampler.Get2D(SampleDim::Camera);
+                        di += (jitter.x - 0.5f) * step;
+                        dj += (jitter.y - 0.5f) * step;
+
+                        glm::vec3 pixelLookDir = lookDir;
+                        pixelLookDir += fovFactor * (2.0f * (j + dj) / height - 1.0f) * upDir;
+                        pixelLookDir += fovFactor * aspect * (2.0f * (i + di) / width - 1.0f) * rightDir;
+
+                        // 光线锥的扩散角取一个子像素对应的张角, 纹理按该足迹选择 mip 层级
+                        return Ray(camera.Eye, glm::normalize(pixelLookDir), 0.0f, 2.0f * fovFactor / (height * _superSampleRate));
+                    };
 
-                // Path Tracing渲染循环
-                while (_pixelIndex < std::size_t(width) * height) {
-                    int i = _pixelIndex % width;
-                    int j = _pixelIndex / width;
+                    // 平均所有采样，应用gamma校正
+                    auto const Resolve = [&](std::span<glm::vec3 const> accumulatedColors) {
+                        float const totalSubSamples = float(subSamples);
+                        for (std::size_t k = 0; k < n; ++k)
+                            _buffer.At(x0 + k % (x1 - x0), y0 + k / (x1 - x0)) = glm::pow(accumulatedColors[k] / totalSubSamples, glm::vec3(1.0f / 2.2f));
+                    };
+
+                    if (wavefront) {
+                        auto const               sampler = CreateSampler(_samplerType, subSamples);
+                        std::vector<PixelSample> samples;
+                        std::vector<glm::vec3>   sampleColors;
+                        std::vector<glm::vec3>   accumulatedColors(n, glm::vec3(0.0f));
+                        samples.reserve(c_WavefrontSize + n);
+
+                        // 子样本按序号从小到大加入当前一波, 攒够 c_WavefrontSize 个或全部加入后一起追踪
+                        for (int index = 0; index < subSamples; ++index) {
+                            if (_stopFlag) return;
+                            int const dx = index % _superSampleRate, dy = index / _superSampleRate % _superSampleRate;
+                            for (std::size_t k = 0; k < n; ++k) {
+                                std::size_t const i = x0 + k % (x1 - x0), j = y0 + k / (x1 - x0);
+                                sampler->StartPixelSample(j * width + i, index);
+                                samples.push_back({ CameraRay(i, j, dx, dy, *sampler), j * width + i, std::uint32_t(index) });
+                            }
+                            if (samples.size() + n <= c_WavefrontSize && index + 1 < subSamples) continue;
+
+                            sampleColors.resize(samples.size());
+                            PathTraceWavefront(
+                                _intersector,
+                                *sampler,
+                                samples,
+                                _maxBounces,
+                                _enableDirectLighting,
+                                _enableRussianRoulette,
+                                _enableNextEventEstimation,
+                                _skyLightIntensity,
+                                _skyLightColor,
+                                sampleColors);
+                            for (std::size_t s = 0; s < samples.size(); ++s) accumulatedColors[s % n] += sampleColors[s];
+                            samples.clear();
+                        }
+                        Resolve(accumulatedColors);
+                        return;
+                    }
 
-                    glm::vec3 accumulatedColor(0.0f);
+                    // 整个像素块共用一个采样器, 着色每个子样本前按像素和样本序号重新定位
+                    auto const                             sampler = CreateSampler(_samplerType, subSamples);
+                    std::array<PixelSample, c_BlockPixels> samples;
+                    std::array<glm::vec3, c_BlockPixels>   sampleColors;
+                    std::array<glm::vec3, c_BlockPixels>   accumulatedColors {};
 
                     // 每像素多次采样
                     for (int sample = 0; sample < _samplesPerPixel; ++sample) {
+                        if (_stopFlag) return;
                         // 像素内随机采样（抗锯齿）
                         for (int dy = 0; dy < _superSampleRate; ++dy) {
                             for (int dx = 0; dx < _superSampleRate; ++dx) {
-                                float step = 1.0f / _superSampleRate;
-                                float di = step * (0.5f + dx), dj = step * (0.5f + dy);
-
-                                // 添加随机抖动以减少规则采样
-                                di += (RandomFloat() - 0.5f) * step;
-                                dj += (RandomFloat() - 0.5f) * step;
-
-                                auto const & camera    = _sceneObject.Camera;
-                                glm::vec3    lookDir   = glm::normalize(camera.Target - camera.Eye);
-                                glm::vec3    rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
-                                glm::vec3    upDir     = glm::normalize(glm::cross(rightDir, lookDir));
-                                float const  aspect    = width * 1.f / height;
-                                float const  fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
+                                for (std::size_t k = 0; k < n; ++k) {
+                                    std::size_t const i = x0 + k % (x1 - x0), j = y0 + k / (x1 - x0);
 
-                                glm::vec3 pixelLookDir = lookDir;
-                                pixelLookDir += fovFactor * (2.0f * (j + dj) / height - 1.0f) * upDir;
-                                pixelLookDir += fovFactor * aspect * (2.0f * (i + di) / width - 1.0f) * rightDir;
+                                    // 每个子样本由像素和样本序号确定, 与线程调度无关
+                                    std::uint32_t const index = std::uint32_t((sample * _superSampleRate + dy) * _superSampleRate + dx);
+                                    sampler->StartPixelSample(j * width + i, index);
+                                    samples[k] = { CameraRay(i, j, dx, dy, *sampler), j * width + i, index };
+                                }
 
-                                Ray initialRay(camera.Eye, glm::normalize(pixelLookDir));
-
-                                // 使用Path Tracing
-                                glm::vec3 sampleColor = PathTrace(
+                                // 使用Path Tracing, 相机光线成包求交
+                                PathTracePacket(
                                     _intersector,
-                                    initialRay,
+                                    *sampler,
+                                    std::span(samples.data(), n),
                                     _maxBounces,
                                     _enableDirectLighting,
                                     _enableRussianRoulette,
                                     _enableNextEventEstimation,
                                     _skyLightIntensity,
-                                    _skyLightColor);
-
-                                accumulatedColor += sampleColor;
+                                    _skyLightColor,
+                                    std::span(sampleColors.data(), n));
+                                for (std::size_t k = 0; k < n; ++k) accumulatedColors[k] += sampleColors[k];
                             }
                         }
                     }
-
-                    // 平均所有采样，应用gamma校正
-                    float     totalSubSamples = _samplesPerPixel * _superSampleRate * _superSampleRate;
-                    glm::vec3 finalColor      = accumulatedColor / totalSubSamples;
-                    finalColor                = glm::pow(finalColor, glm::vec3(1.0f / 2.2f));
-
-                    _buffer.At(i, j) = finalColor;
-                    ++_pixelIndex;
-
-                    if (_stopFlag) return;
-                }
-            });
+                    Resolve(std::span(accumulatedColors.data(), n));
+                },
+                _stopFlag,
+                _pixelIndex,
+                0,
+                _wavefront ? TileRenderer::c_TileSize : TileRenderer::c_BlockSize);
         }
 
         if (! _resizable) {
             if (! _stopFlag) _texture.Update(_buffer);
-            if (_task.joinable() && _pixelIndex == _buffer.GetSizeX() * _buffer.GetSizeY()) {
+            if (_renderer.IsRunning() && _pixelIndex == _buffer.GetSizeX() * _buffer.GetSizeY()) {
                 _stopFlag = true;
-                _task.join();
+                _renderer.Join();
             }
         }
 
@@ -9,6 +9,7 @@
 #include "Labs/final_hw/Content.h"
 #include "Labs/final_hw/PathTracing.h"
 #include "Labs/final_hw/SceneObject.h"
+#include "Labs/final_hw/TileRenderer.h"
 
 namespace VCX::Labs::Rendering {
 
@@ -33,32 +34,59 @@ namespace VCX::Labs::Rendering {
         Engine::GL::UniqueTexture2D _texture;
         RayIntersector              _intersector;
 
+        Content::SceneHandle                     _scene;
+        std::shared_future<Content::SceneHandle> _sceneLoading;
+
         std::size_t _sceneIdx { 0 };
         bool        _enableZoom { true };
         bool        _resetDirty { true };
         bool        _sceneDirty { true };
-        bool        _treeDirty { true };
+        // 渲染线程建好 BVH 后以 release 清除, 界面线程以 acquire 读取后才能访问 _intersector 中的 BVH
+        std::atomic_bool _treeDirty { true };
 
         // Path Tracing 参数
-        int       _samplesPerPixel { 16 };
-        int       _maxBounces { 5 };
-        bool      _enableDirectLighting { true };
-        bool      _enableRussianRoulette { true };
-        bool      _enableNextEventEstimation { true };
-        float     _skyLightIntensity { 0.8f };
-        glm::vec3 _skyLightColor { 0.7f, 0.8f, 1.0f };
-        int       _superSampleRate { 1 }; // 用于抗锯齿
-
-        std::size_t      _pixelIndex { 0 };
-        bool             _stopFlag { true };
-        Common::ImageRGB _buffer;
-        bool             _resizable { true };
-
-        std::thread _task;
+        int         _samplesPerPixel { 16 };
+        int         _maxBounces { 5 };
+        bool        _enableDirectLighting { true };
+        bool        _enableRussianRoulette { true };
+        bool        _enableNextEventEstimation { true };
+        float       _skyLightIntensity { 0.8f };
+        glm::vec3   _skyLightColor { 0.7f, 0.8f, 1.0f };
+        int         _superSampleRate { 1 }; // 用于抗锯齿
+        SamplerType _samplerType { SamplerType::Sobol };
+
+        BVHBuildMode _buildMode { BVHBuildMode::SAH };
+        bool         _quantizedNodes { false };
+        bool         _wavefront { false }; // 波前模式, 结果与逐像素追踪相同
+
+        // 遍历统计: 按当前视角追踪 c_StatsResolution^2 条相机光线, 统计每条光线访问的节点数与求交的三角形数
+        static constexpr int c_StatsResolution = 128;
+        TraversalStats       _traversalStats;
+        float                _traversalTime { 0.0f }; // 毫秒
+
+        // 模型移动: 每个模型在场景给出的变换之上的平移, 修改后只重新适配顶层 BVH, 底层与场景本身不变
+        std::vector<glm::vec3> _modelOffsets;
+        int                    _editModel { 0 };
+        float                  _transformTime { 0.0f }; // 毫秒, 最近一次更新顶层 BVH 的耗时
+
+        std::atomic_size_t _pixelIndex { 0 }; // 已完成的像素数
+        std::atomic_bool   _stopFlag { true };
+        Common::ImageRGB   _buffer;
+        bool               _resizable { true };
+
+        TileRenderer _renderer;
+
+        void      MeasureTraversal();
+        glm::mat4 GetModelTransform(std::uint32_t modelIdx) const; // 场景中的变换加上 _modelOffsets 中的平移
+
+        // 停止渲染并等待渲染线程退出; 修改渲染线程 prepare 中读取的场景或 BVH 参数之前调用
+        void StopRendering() {
+            _stopFlag = true;
+            _renderer.Join();
+        }
 
         auto GetBufferSize() const { return std::pair(std::uint32_t(_buffer.GetSizeX()), std::uint32_t(_buffer.GetSizeY())); }
 
-        char const *          GetSceneName(std::size_t const i) const { return Content::SceneNames[std::size_t(_scenes[i])].c_str(); }
-        Engine::Scene const & GetScene(std::size_t const i) const { return Content::Scenes[std::size_t(_scenes[i])]; }
+        char const * GetSceneName(std::size_t const i) const { return Content::SceneNames[std::size_t(_scenes[i])].c_str(); }
     };
 } // namespace VCX::Labs::Rendering
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "Labs/final_hw/CaseRayTracing.h"
+#include <array>
+#include <span>
 
 namespace VCX::Labs::Rendering {
 
@@ -6,7 +8,7 @@ namespace VCX::Labs::Rendering {
         _scenes(scenes),
         _program(
             Engine::GL::UniqueProgram({
-                Engine::GL::SharedShader("assets/shaders/flat.vert"),
+                Engine::GL::SharedShader("assets/shaders/flat-instanced.vert"),
                 Engine::GL::SharedShader("assets/shaders/flat.frag") })),
         _sceneObject(4),
         _texture({ .MinFilter = Engine::GL::FilterMode::Linear, .MagFilter = Engine::GL::FilterMode::Nearest }) {
@@ -15,8 +17,7 @@ namespace VCX::Labs::Rendering {
     }
 
     CaseRayTracing::~CaseRayTracing() {
-        _stopFlag = true;
-        if (_task.joinable()) _task.join();
+        StopRendering();
     }
 
     void CaseRayTracing::OnSetupPropsUI() {
@@ -25,8 +26,10 @@ namespace VCX::Labs::Rendering {
                 bool selected = i == _sceneIdx;
                 if (ImGui::Selectable(GetSceneName(i), selected)) {
                     if (! selected) {
-                        _sceneIdx   = i;
-                        _sceneDirty = true;
+                        StopRendering();
+                        _sceneIdx     = i;
+                        _sceneLoading = {};
+                        _sceneDirty   = true;
                         _treeDirty = true;
                         _resetDirty = true;
                     }
@@ -36,11 +39,8 @@ namespace VCX::Labs::Rendering {
         }
         if (ImGui::Button("Reset Scene")) _resetDirty = true;
         ImGui::SameLine();
-        if (_task.joinable()) {
-            if (ImGui::Button("Stop Rendering")) {
-                _stopFlag = true;
-                if (_task.joinable()) _task.join();
-            }
+        if (_renderer.IsRunning()) {
+            if (ImGui::Button("Stop Rendering")) StopRendering();
         } else if (ImGui::Button("Start Rendering")) _stopFlag = false;
         ImGui::ProgressBar(float(_pixelIndex) / (_buffer.GetSizeX() * _buffer.GetSizeY()));
         Common::ImGuiHelper::SaveImage(_texture, GetBufferSize(), true);
@@ -50,6 +50,28 @@ namespace VCX::Labs::Rendering {
             _resetDirty |= ImGui::SliderInt("Sample Rate", &_superSampleRate, 1, 5);
             _resetDirty |= ImGui::SliderInt("Max Depth", &_maximumDepth, 1, 15);
             _resetDirty |= ImGui::Checkbox("Shadow Ray", &_enableShadow);
+            if (ImGui::BeginCombo("BVH Builder", GetBVHBuildModeName(_buildMode))) {
+                for (auto const mode : { BVHBuildMode::SAH, BVHBuildMode::SBVH, BVHBuildMode::LBVH, BVHBuildMode::LBVHTreelet }) {
+                    if (ImGui::Selectable(GetBVHBuildModeName(mode), mode == _buildMode) && mode != _buildMode) {
+                        StopRendering();
+                        _buildMode  = mode;
+                        _treeDirty  = true;
+                        _resetDirty = true;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("SBVH splits long thin triangles across nodes for faster traversal; LBVH builds several times faster than SAH at some cost in trace speed");
+            }
+            if (ImGui::Checkbox("Quantized Nodes", &_quantizedNodes)) {
+                StopRendering();
+                _treeDirty  = true;
+                _resetDirty = true;
+            }
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("Stores BVH4 child boxes as 8-bit offsets in one cache line per node; halves BVH memory, pays off once it no longer fits in cache");
+            }
         }
         ImGui::Spacing();
 
@@ -61,16 +83,22 @@ namespace VCX::Labs::Rendering {
 
     Common::CaseRenderResult CaseRayTracing::OnRender(std::pair<std::uint32_t, std::uint32_t> const desiredSize) {
         if (_resetDirty) {
-            _stopFlag = true;
-            if (_task.joinable()) _task.join();
+            StopRendering();
             _pixelIndex = 0;
             _resizable  = true;
             _resetDirty = false;
         }
         if (_sceneDirty) {
-            _sceneObject.ReplaceScene(GetScene(_sceneIdx));
-            _cameraManager.Save(_sceneObject.Camera);
-            _sceneDirty = false;
+            // 场景在首次选中时于后台加载, 加载完成前保持上一个场景的预览且不开始渲染
+            if (! _sceneLoading.valid()) _sceneLoading = Content::RequestScene(_scenes[_sceneIdx]);
+            if (_sceneLoading.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                _scene        = _sceneLoading.get();
+                _sceneLoading = {};
+                Content::EvictUnused();
+                _sceneObject.ReplaceScene(*_scene);
+                _cameraManager.Save(_sceneObject.Camera);
+                _sceneDirty = false;
+            }
         }
         if (_resizable) {
             _frame.Resize(desiredSize);
@@ -82,56 +110,71 @@ namespace VCX::Labs::Rendering {
 
             glEnable(GL_DEPTH_TEST);
             glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            for (auto const & model : _sceneObject.OpaqueModels)
-                model.Mesh.Draw({ _program.Use() });
+            for (auto const & model : _sceneObject.OpaqueModels) {
+                _program.GetUniforms().SetByName("u_Model", model.Transform);
+                _sceneObject.Meshes[model.MeshIndex].Draw({ _program.Use() });
+            }
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
             glDisable(GL_DEPTH_TEST);
         }
-        if (! _stopFlag && ! _task.joinable()) {
+        if (! _stopFlag && ! _renderer.IsRunning() && ! _sceneDirty) {
             if (_pixelIndex == 0) {
                 _resizable = false;
                 _buffer    = _frame.GetColorAttachment().Download<Engine::Formats::RGB8>();
+                _renderer.Reset(_buffer.GetSizeX(), _buffer.GetSizeY());
             }
-            _task = std::thread([&]() {
-                auto const width  = _buffer.GetSizeX();
-                auto const height = _buffer.GetSizeY();
-                if (_pixelIndex == 0 && _treeDirty) {
-                    Engine::Scene const & scene = GetScene(_sceneIdx);
-                    _intersector.InitScene(&scene);
-                    _treeDirty = false;
-                }
-                // Render into tex.
-                while (_pixelIndex < std::size_t(width) * height) {
-                    int i = _pixelIndex % width;
-                    int j = _pixelIndex / width;
-                    glm::vec3 sum(0.0f);
+            auto const width  = _buffer.GetSizeX();
+            auto const height = _buffer.GetSizeY();
+            _renderer.Start(
+                [&]() {
+                    if (_treeDirty.load(std::memory_order_acquire)) {
+                        _intersector.InitScene(_scene.get(), Content::GetBVHCachePath(_scenes[_sceneIdx], _buildMode, _quantizedNodes), _buildMode, _quantizedNodes);
+                        _treeDirty.store(false, std::memory_order_release);
+                    }
+                },
+                // Render a pixel block into tex; sub-samples with the same index form one camera ray packet.
+                [&, width, height](std::size_t const x0, std::size_t const y0, std::size_t const x1, std::size_t const y1) {
+                    constexpr std::size_t c_BlockPixels = TileRenderer::c_BlockSize * TileRenderer::c_BlockSize;
+                    std::size_t const     n             = (x1 - x0) * (y1 - y0);
+                    auto const &          camera        = _sceneObject.Camera;
+                    glm::vec3 const       lookDir       = glm::normalize(camera.Target - camera.Eye);
+                    glm::vec3 const       rightDir      = glm::normalize(glm::cross(lookDir, camera.Up));
+                    glm::vec3 const       upDir         = glm::normalize(glm::cross(rightDir, lookDir));
+                    float const           aspect        = width * 1.f / height;
+                    float const           fovFactor     = std::tan(glm::radians(camera.Fovy) / 2);
+
+                    std::array<glm::vec3, c_BlockPixels> sum {};
+                    std::array<Ray, c_BlockPixels>       rays;
+                    std::array<RayHit, c_BlockPixels>    hits;
                     for (int dy = 0; dy < _superSampleRate; ++dy)
                         for (int dx = 0; dx < _superSampleRate; ++dx) {
-                            float        step = 1.0f / _superSampleRate;
-                            float        di = step * (0.5f + dx), dj = step * (0.5f + dy);
-                            auto const & camera    = _sceneObject.Camera;
-                            glm::vec3    lookDir   = glm::normalize(camera.Target - camera.Eye);
-                            glm::vec3    rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
-                            glm::vec3    upDir     = glm::normalize(glm::cross(rightDir, lookDir));
-                            float const  aspect    = width * 1.f / height;
-                            float const  fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
-                            lookDir += fovFactor * (2.0f * (j + dj) / height - 1.0f) * upDir;
-                            lookDir += fovFactor * aspect * (2.0f * (i + di) / width - 1.0f) * rightDir;
-                            Ray       initialRay(camera.Eye, glm::normalize(lookDir));
-                            glm::vec3 res = RayTrace(_intersector, initialRay, _maximumDepth, _enableShadow);
-                            sum += glm::pow(res, glm::vec3(1.0 / 2.2));
+                            float step = 1.0f / _superSampleRate;
+                            float di = step * (0.5f + dx), dj = step * (0.5f + dy);
+                            for (std::size_t k = 0; k < n; ++k) {
+                                std::size_t const i = x0 + k % (x1 - x0), j = y0 + k / (x1 - x0);
+                                glm::vec3         dir = lookDir;
+                                dir += fovFactor * (2.0f * (j + dj) / height - 1.0f) * upDir;
+                                dir += fovFactor * aspect * (2.0f * (i + di) / width - 1.0f) * rightDir;
+                                // the ray cone spans one sub-pixel, so textures are filtered at the matching mip level
+                                rays[k] = Ray(camera.Eye, glm::normalize(dir), 0.0f, 2.0f * fovFactor / (height * _superSampleRate));
+                            }
+                            _intersector.IntersectPacket(std::span(rays.data(), n), std::span(hits.data(), n));
+                            for (std::size_t k = 0; k < n; ++k) {
+                                glm::vec3 res = RayTrace(_intersector, rays[k], _maximumDepth, _enableShadow, &hits[k]);
+                                sum[k] += glm::pow(res, glm::vec3(1.0 / 2.2));
+                            }
                         }
-                    _buffer.At(i, j) = sum / glm::vec3(_superSampleRate * _superSampleRate);
-                    ++_pixelIndex;
-                    if (_stopFlag) return;
-                }
-            });
+                    for (std::size_t k = 0; k < n; ++k)
+                        _buffer.At(x0 + k % (x1 - x0), y0 + k / (x1 - x0)) = sum[k] / glm::vec3(_superSampleRate * _superSampleRate);
+                },
+                _stopFlag,
+                _pixelIndex);
         }
         if (! _resizable) {
             if (!_stopFlag) _texture.Update(_buffer);
-            if (_task.joinable() && _pixelIndex == _buffer.GetSizeX() * _buffer.GetSizeY()) {
+            if (_renderer.IsRunning() && _pixelIndex == _buffer.GetSizeX() * _buffer.GetSizeY()) {
                 _stopFlag = true;
-                _task.join();
+                _renderer.Join();
             }
         }
         return Common::CaseRenderResult {
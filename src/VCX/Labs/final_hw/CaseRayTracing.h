@@ -4,6 +4,7 @@
 #include "Engine/GL/Program.h"
 #include "Labs/final_hw/Content.h"
 #include "Labs/final_hw/SceneObject.h"
+#include "Labs/final_hw/TileRenderer.h"
 #include "Labs/final_hw/tasks.h"
 #include "Labs/Common/ICase.h"
 #include "Labs/Common/ImageRGB.h"
@@ -32,24 +33,34 @@ namespace VCX::Labs::Rendering {
         Engine::GL::UniqueTexture2D _texture;
         RayIntersector              _intersector;
 
+        Content::SceneHandle                     _scene;
+        std::shared_future<Content::SceneHandle> _sceneLoading;
+
         std::size_t                             _sceneIdx { 0 };
         bool                                    _enableZoom { true };
         bool                                    _enableShadow { true };
         int                                     _maximumDepth { 3 };
         int                                     _superSampleRate { 1 };
-        std::size_t                             _pixelIndex { 0 };
-        bool                                    _stopFlag { true };
+        BVHBuildMode                            _buildMode { BVHBuildMode::SAH };
+        bool                                    _quantizedNodes { false };
+        std::atomic_size_t                      _pixelIndex { 0 };
+        std::atomic_bool                        _stopFlag { true };
         bool                                    _sceneDirty { true };
-        bool                                    _treeDirty { true };
+        std::atomic_bool                        _treeDirty { true }; // cleared with release by the render thread once the BVH is built
         bool                                    _resetDirty { true };
         Common::ImageRGB                        _buffer;
         bool                                    _resizable { true };
 
-        std::thread _task;
+        TileRenderer _renderer;
+
+        // stop rendering and wait for the render thread; call before changing the scene or BVH settings its prepare step reads
+        void StopRendering() {
+            _stopFlag = true;
+            _renderer.Join();
+        }
 
         auto GetBufferSize() const { return std::pair(std::uint32_t(_buffer.GetSizeX()), std::uint32_t(_buffer.GetSizeY())); }
 
-        char const *          GetSceneName(std::size_t const i) const { return Content::SceneNames[std::size_t(_scenes[i])].c_str(); }
-        Engine::Scene const & GetScene(std::size_t const i) const { return Content::Scenes[std::size_t(_scenes[i])]; }
+        char const * GetSceneName(std::size_t const i) const { return Content::SceneNames[std::size_t(_scenes[i])].c_str(); }
     };
 } // namespace VCX::Labs::Rendering
@@ -1,16 +1,18 @@
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <mutex>
 
 #include <spdlog/spdlog.h>
 
 #include "Engine/loader.h"
 #include "Labs/final_hw/Content.h"
+#include "Labs/final_hw/InstanceBVH.h"
 
 namespace VCX::Labs::Rendering {
     static void AddGround(Engine::Scene & scene) {
         float const radius = scene.Cameras[0].ZFar * .5f;
-        float height = std::numeric_limits<float>::max();
-        for (auto const & model : scene.Models)
-            height = std::min(height, model.Mesh.GetAxisAlignedBoundingBox().first.y);
+        float const height = scene.GetAxisAlignedBoundingBox().first.y;
         scene.Models.emplace_back();
         scene.Models.back().MaterialIndex = std::uint32_t(scene.Materials.size());
         scene.Models.back().Mesh.Positions = {
@@ -55,17 +57,14 @@ namespace VCX::Labs::Rendering {
         scene.Materials.back().Height.Fill(0);
     }
 
-    static std::array<Engine::Scene, Assets::ExampleScenes.size()> LoadExampleScenes() {
-        std::array<Engine::Scene, Assets::ExampleScenes.size()> scenes;
-        for (std::size_t i = 0; i < scenes.size(); i++) {
-            scenes[i] = Engine::LoadScene(Assets::ExampleScenes[i]);
-            /*if (i == std::size_t(Assets::ExampleScene::SportsCar)) {
-                AddGround(scenes[i]);
-            } else if (i == std::size_t(Assets::ExampleScene::WhiteOak)) {
-                AddGround(scenes[i], -10.);
-            }*/
-        }
-        return scenes;
+    static Engine::Scene LoadExampleScene(std::size_t const i) {
+        Engine::Scene scene = Engine::LoadScene(Assets::ExampleScenes[i]);
+        /*if (i == std::size_t(Assets::ExampleScene::SportsCar)) {
+            AddGround(scene);
+        } else if (i == std::size_t(Assets::ExampleScene::WhiteOak)) {
+            AddGround(scene, -10.);
+        }*/
+        return scene;
     }
 
     static std::array<std::string, Assets::ExampleScenes.size()> LoadExampleSceneNames() {
@@ -76,6 +75,59 @@ namespace VCX::Labs::Rendering {
         return names;
     }
 
-    std::array<Engine::Scene, Assets::ExampleScenes.size()> const Content::Scenes = LoadExampleScenes();
-    std::array<std::string,   Assets::ExampleScenes.size()> const Content::SceneNames  = LoadExampleSceneNames();
+    std::array<std::string, Assets::ExampleScenes.size()> const Content::SceneNames = LoadExampleSceneNames();
+
+    namespace {
+        struct SceneCacheEntry {
+            std::shared_future<Content::SceneHandle> Scene;
+            std::uint64_t                            LastRequest = 0;
+        };
+
+        std::mutex                                                 s_SceneCacheMutex;
+        std::array<SceneCacheEntry, Assets::ExampleScenes.size()> s_SceneCache;
+        std::uint64_t                                              s_SceneRequestCount = 0;
+    } // namespace
+
+    std::shared_future<Content::SceneHandle> Content::RequestScene(Assets::ExampleScene const scene) {
+        std::size_t const i = std::size_t(scene);
+        if (i >= Assets::ExampleScenes.size()) {
+            spdlog::error("VCX::Labs::Rendering::Content::RequestScene({}): no such example scene.", i);
+            std::promise<SceneHandle> empty;
+            empty.set_value(std::make_shared<Engine::Scene const>());
+            return empty.get_future().share();
+        }
+
+        std::lock_guard<std::mutex> lock(s_SceneCacheMutex);
+        auto &                      entry = s_SceneCache[i];
+        if (! entry.Scene.valid()) {
+            entry.Scene = std::async(std::launch::async, [i]() {
+                auto const start = std::chrono::steady_clock::now();
+                auto       scene = std::make_shared<Engine::Scene const>(LoadExampleScene(i));
+                spdlog::info("VCX::Labs::Rendering::Content::RequestScene(..): loaded {} in {:.1f} ms.", SceneNames[i], std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+                return SceneHandle(std::move(scene));
+            }).share();
+        }
+        entry.LastRequest = ++s_SceneRequestCount;
+        return entry.Scene;
+    }
+
+    void Content::EvictUnused() {
+        std::lock_guard<std::mutex> lock(s_SceneCacheMutex);
+        std::vector<SceneCacheEntry *> unused;
+        for (auto & entry : s_SceneCache) {
+            if (! entry.Scene.valid() || entry.Scene.wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+            // only the cache itself still holds the scene
+            if (entry.Scene.get().use_count() == 1) unused.push_back(&entry);
+        }
+        if (unused.size() <= c_MaxUnusedScenes) return;
+        std::sort(unused.begin(), unused.end(), [](auto const * a, auto const * b) { return a->LastRequest > b->LastRequest; });
+        for (std::size_t k = c_MaxUnusedScenes; k < unused.size(); ++k) {
+            spdlog::info("VCX::Labs::Rendering::Content::EvictUnused(): released {}.", SceneNames[std::size_t(unused[k] - s_SceneCache.data())]);
+            unused[k]->Scene = {};
+        }
+    }
+
+    std::filesystem::path Content::GetBVHCachePath(Assets::ExampleScene const scene, BVHBuildMode const mode, bool const quantized) {
+        return InstanceBVH::GetCachePath(Assets::ExampleScenes[std::size_t(scene)], mode, quantized);
+    }
 } // namespace VCX::Labs::Rendering
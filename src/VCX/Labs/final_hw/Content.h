@@ -1,12 +1,30 @@
 #pragma once
 
+#include <filesystem>
+#include <future>
+#include <memory>
+
 #include "Assets/bundled.h"
 #include "Engine/Scene.h"
+#include "Labs/final_hw/BVH.h"
 
 namespace VCX::Labs::Rendering {
     class Content {
     public:
-        static std::array<Engine::Scene, Assets::ExampleScenes.size()> const Scenes;
-        static std::array<std::string,   Assets::ExampleScenes.size()> const SceneNames;
+        using SceneHandle = std::shared_ptr<Engine::Scene const>;
+
+        // how many scenes that no case holds are kept around before the least recently used one is released
+        static constexpr std::size_t c_MaxUnusedScenes = 1;
+
+        static std::array<std::string, Assets::ExampleScenes.size()> const SceneNames;
+
+        // start loading the scene on a background thread on first request; later requests share the same result
+        static std::shared_future<SceneHandle> RequestScene(Assets::ExampleScene scene);
+
+        // release loaded scenes held only by the cache, keeping the c_MaxUnusedScenes most recently requested
+        static void EvictUnused();
+
+        // where the acceleration structure of the scene built with the given mode and node layout is cached, next to its scene file
+        static std::filesystem::path GetBVHCachePath(Assets::ExampleScene scene, BVHBuildMode mode, bool quantized);
     };
 }
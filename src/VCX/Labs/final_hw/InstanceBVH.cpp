@@ -0,0 +1,531 @@
+// InstanceBVH.cpp
+#include "Labs/final_hw/InstanceBVH.h"
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include "Engine/MappedFile.h"
+#include "Engine/loader.h"
+#include "Labs/final_hw/CacheModel.h"
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        constexpr int c_PacketSize = int(InstanceBVH::c_MaxPacketSize);
+
+        // 世界空间中的光线 (dir 为其归一化方向) 变换到实例的物体空间; 方向保持变换后的长度 scale,
+        // 物体空间中的 t 即世界空间距离乘以 scale
+        Ray ToObjectSpace(InstanceSnapshot const & instance, Ray const & ray, glm::vec3 const & dir, float & scale) {
+            glm::vec3 const localDir = glm::mat3(instance.WorldToObject) * dir;
+            scale                    = glm::length(localDir);
+            return Ray(glm::vec3(instance.WorldToObject * glm::vec4(ray.Origin, 1.0f)), localDir, ray.ConeWidth, ray.ConeSpread);
+        }
+
+        // 按进入距离由近到远遍历顶层 BVH, 对光线可能到达的实例包围盒调用 visit(box), visit 返回 true 时结束遍历;
+        // tMax 按引用读取, visit 缩短它之后更远的子树会被跳过. stats 非空时累计访问的内部节点数 (并把读取的孩子节点送入其缓存模型)
+        template<typename Visit>
+        void TraverseTopLevel(BVH const & top, glm::vec3 const & origin, glm::vec3 const & invDir, float const tMin, float const & tMax, Visit && visit, TraversalStats * stats = nullptr) {
+            auto const & nodes = top.GetNodes();
+            struct StackEntry {
+                std::uint32_t Node;
+                float         TEntry;
+            };
+            std::array<StackEntry, BVH::c_MaxDepth + 1> stack;
+            int                                         size = 0;
+
+            float tRoot;
+            if (! IntersectAABB(nodes[0].Bounds, origin, invDir, tMin, tMax, tRoot)) return;
+            stack[size++] = { 0, tRoot };
+
+            while (size > 0) {
+                auto const entry = stack[--size];
+                if (entry.TEntry > tMax) continue;
+                BVHNode const & node = nodes[entry.Node];
+
+                if (node.IsLeaf()) {
+                    for (std::uint32_t i = node.Offset; i < node.Offset + node.Count; ++i)
+                        if (visit(top.GetPrimitives()[i])) return;
+                    continue;
+                }
+
+                if (stats) {
+                    ++stats->Nodes;
+                    if (stats->Cache) {
+                        stats->Cache->Access(&nodes[entry.Node + 1], sizeof(BVHNode));
+                        stats->Cache->Access(&nodes[node.Offset], sizeof(BVHNode));
+                    }
+                }
+                std::uint32_t const left  = entry.Node + 1;
+                std::uint32_t const right = node.Offset;
+                float               tLeft, tRight;
+                bool const          hitLeft  = IntersectAABB(nodes[left].Bounds, origin, invDir, tMin, tMax, tLeft);
+                bool const          hitRight = IntersectAABB(nodes[right].Bounds, origin, invDir, tMin, tMax, tRight);
+                if (hitLeft && hitRight) {
+                    if (tLeft < tRight) {
+                        stack[size++] = { right, tRight };
+                        stack[size++] = { left, tLeft };
+                    } else {
+                        stack[size++] = { left, tLeft };
+                        stack[size++] = { right, tRight };
+                    }
+                } else if (hitLeft) {
+                    stack[size++] = { left, tLeft };
+                } else if (hitRight) {
+                    stack[size++] = { right, tRight };
+                }
+            }
+        }
+
+        // 光线包在顶层 BVH 中的归一化方向; 顶层节点很少, 逐条光线测试包围盒即可
+        struct TopLevelPacket {
+            int       Size;
+            glm::vec3 Dir[c_PacketSize];
+            glm::vec3 InvDir[c_PacketSize];
+
+            explicit TopLevelPacket(std::span<Ray const> const rays):
+                Size(int(rays.size())) {
+                for (int i = 0; i < Size; ++i) {
+                    Dir[i]    = glm::normalize(rays[i].Direction);
+                    InvDir[i] = 1.0f / Dir[i];
+                }
+            }
+        };
+
+        // 光线包版本: 对到达实例包围盒的光线掩码调用 visit(box, rays); active 与 tMax 按引用读取,
+        // 不再活跃或当前交点更近的光线不会再进入子树
+        template<typename Visit>
+        void TraversePacketTopLevel(
+            BVH const &            top,
+            std::span<Ray const>   rays,
+            TopLevelPacket const & packet,
+            float const            tMin,
+            float const *          tMax,
+            std::uint32_t const &  active,
+            Visit &&               visit) {
+            auto const & nodes = top.GetNodes();
+            struct StackEntry {
+                std::uint32_t Node;
+                std::uint32_t Rays;
+                float         TEntry; // 击中光线的最小进入距离
+            };
+            std::array<StackEntry, BVH::c_MaxDepth + 1> stack;
+            int                                         size = 0;
+
+            auto const IntersectBox = [&](AABB const & box, std::uint32_t const mask, float & minEntry) {
+                std::uint32_t hit = 0;
+                minEntry          = std::numeric_limits<float>::infinity();
+                for (std::uint32_t m = mask; m; m &= m - 1) {
+                    int const i = std::countr_zero(m);
+                    float     tEntry;
+                    if (! IntersectAABB(box, rays[i].Origin, packet.InvDir[i], tMin, tMax[i], tEntry)) continue;
+                    hit |= 1u << i;
+                    minEntry = std::min(minEntry, tEntry);
+                }
+                return hit;
+            };
+
+            float               tRoot;
+            std::uint32_t const root = IntersectBox(nodes[0].Bounds, active, tRoot);
+            if (! root) return;
+            stack[size++] = { 0, root, tRoot };
+
+            while (size > 0 && active) {
+                auto const    entry = stack[--size];
+                std::uint32_t mask  = 0;
+                for (std::uint32_t m = entry.Rays & active; m; m &= m - 1) {
+                    int const i = std::countr_zero(m);
+                    if (entry.TEntry <= tMax[i]) mask |= 1u << i;
+                }
+                if (! mask) continue;
+                BVHNode const & node = nodes[entry.Node];
+
+                if (node.IsLeaf()) {
+                    for (std::uint32_t i = node.Offset; i < node.Offset + node.Count; ++i) visit(top.GetPrimitives()[i], mask & active);
+                    continue;
+                }
+
+                std::uint32_t const left  = entry.Node + 1;
+                std::uint32_t const right = node.Offset;
+                float               tLeft, tRight;
+                std::uint32_t const hitLeft  = IntersectBox(nodes[left].Bounds, mask, tLeft);
+                std::uint32_t const hitRight = IntersectBox(nodes[right].Bounds, mask, tRight);
+                if (hitLeft && hitRight) {
+                    if (tLeft < tRight) {
+                        stack[size++] = { right, hitRight, tRight };
+                        stack[size++] = { left, hitLeft, tLeft };
+                    } else {
+                        stack[size++] = { left, hitLeft, tLeft };
+                        stack[size++] = { right, hitRight, tRight };
+                    }
+                } else if (hitLeft) {
+                    stack[size++] = { left, hitLeft, tLeft };
+                } else if (hitRight) {
+                    stack[size++] = { right, hitRight, tRight };
+                }
+            }
+        }
+
+        // 底层 BVH 缓存文件: 文件头之后依次是各网格的二叉 BVH 与 4 叉 BVH (见各自的 Serialize)
+        struct CacheHeader {
+            char          Magic[8];
+            std::uint32_t Version;
+            std::uint32_t NumMeshes;
+            std::uint64_t GeometryHash;
+            std::uint64_t ContentHash;
+        };
+
+        constexpr char          c_CacheMagic[8] = "VCXBVH4";
+        constexpr std::uint32_t c_CacheVersion  = 5;
+
+        // 底层 BVH 只取决于各网格的顶点位置与索引, 以及构建算法, 构建参数和节点布局
+        std::uint64_t HashGeometry(SceneSnapshot const & snapshot, BVHBuildMode const mode, bool const quantized) {
+            std::array<float, 13> const parameters = {
+                float(mode),
+                float(quantized),
+                BVH::c_MaxDuplication,
+                float(BVH::c_NumBins),
+                float(BVH::c_MaxLeafSize),
+                float(BVH::c_MaxDepth),
+                BVH::c_TraversalCost,
+                BVH::c_IntersectCost,
+                float(sizeof(BVHNode)),
+                float(sizeof(WideBVHNode)),
+                float(sizeof(QuantizedBVHNode)),
+                float(WideBVHNode::c_Width),
+                float(TriangleSoA::c_Lanes),
+            };
+            std::uint64_t hash = Engine::hash_bytes(std::as_bytes(std::span(parameters)));
+            for (std::uint32_t i = 0; i < snapshot.GetMeshCount(); ++i) {
+                auto const & mesh = *snapshot.GetMesh(i).Source;
+                hash              = Engine::hash_bytes(std::as_bytes(std::span(mesh.Positions)), hash);
+                hash              = Engine::hash_bytes(std::as_bytes(std::span(mesh.Indices)), hash);
+            }
+            return hash;
+        }
+    } // namespace
+
+    void InstanceBVH::Build(SceneSnapshot const & snapshot, std::filesystem::path const & cachePath, BVHBuildMode const mode, bool const quantized) {
+        auto const start = std::chrono::steady_clock::now();
+
+        _snapshot        = &snapshot;
+        _buildMode       = mode;
+        _quantized       = quantized;
+        _loadedFromCache = false;
+        if (cachePath.empty()) {
+            BuildBottomLevels();
+        } else {
+            std::uint64_t const hash = HashGeometry(snapshot, mode, quantized);
+            _loadedFromCache         = LoadCache(cachePath, hash);
+            if (! _loadedFromCache) {
+                BuildBottomLevels();
+                SaveCache(cachePath, hash);
+            }
+        }
+        BuildTopLevel();
+
+        _buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        spdlog::info(
+            "VCX::Labs::Rendering::InstanceBVH::Build(..): {} instances of {} meshes, {} triangles, {} {}BVH4 nodes, {:.1f} ms{}.",
+            snapshot.GetInstanceCount(),
+            _bottom.size(),
+            GetTriangleCount(),
+            GetWideNodeCount(),
+            _quantized ? "quantized " : "",
+            _buildTime,
+            _loadedFromCache ? " (cached)" : "");
+    }
+
+    std::filesystem::path InstanceBVH::GetCachePath(std::filesystem::path const & scene, BVHBuildMode const mode, bool const quantized) {
+        char const * tag = nullptr;
+        switch (mode) {
+        case BVHBuildMode::SBVH: tag = ".sbvh"; break;
+        case BVHBuildMode::LBVH: tag = ".lbvh"; break;
+        case BVHBuildMode::LBVHTreelet: tag = ".treelet"; break;
+        default: tag = ".sah"; break;
+        }
+        return std::filesystem::path(scene) += std::string(tag) + (quantized ? ".q.bvh" : ".bvh");
+    }
+
+    void InstanceBVH::BuildBottomLevels() {
+        _bottom.clear();
+        _bottom.reserve(_snapshot->GetMeshCount());
+        for (std::uint32_t i = 0; i < _snapshot->GetMeshCount(); ++i) {
+            auto & bottom = *_bottom.emplace_back(std::make_unique<BottomLevel>());
+            bottom.Binary.Build(*_snapshot->GetMesh(i).Source, _buildMode);
+            bottom.Wide.Build(bottom.Binary, _quantized);
+        }
+    }
+
+    bool InstanceBVH::LoadCache(std::filesystem::path const & cachePath, std::uint64_t const geometryHash) {
+        if (! std::filesystem::exists(cachePath)) return false;
+
+        Engine::MappedFile const file(cachePath);
+        auto const               bytes = file.GetBytes();
+        if (bytes.size() < sizeof(CacheHeader)) return false;
+
+        CacheHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        auto const payload = bytes.subspan(sizeof(header));
+        if (std::memcmp(header.Magic, c_CacheMagic, sizeof(header.Magic)) != 0
+            || header.Version != c_CacheVersion
+            || header.NumMeshes != _snapshot->GetMeshCount()
+            || header.GeometryHash != geometryHash
+            || header.ContentHash != Engine::hash_bytes(payload)) {
+            spdlog::warn("VCX::Labs::Rendering::InstanceBVH::Build(..): stale or corrupted BVH cache {}, rebuilding.", cachePath.filename().string());
+            return false;
+        }
+
+        // 每个数组在映射中都是连续的原始字节, 各用一次 memcpy 读回
+        ByteReader reader(payload);
+        _bottom.clear();
+        _bottom.reserve(header.NumMeshes);
+        for (std::uint32_t i = 0; i < header.NumMeshes; ++i) {
+            auto & bottom = *_bottom.emplace_back(std::make_unique<BottomLevel>());
+            if (! bottom.Binary.Deserialize(reader) || ! bottom.Wide.Deserialize(reader, bottom.Binary)) break;
+        }
+        if (! reader.IsEnd()) {
+            spdlog::warn("VCX::Labs::Rendering::InstanceBVH::Build(..): malformed BVH cache {}, rebuilding.", cachePath.filename().string());
+            _bottom.clear();
+            return false;
+        }
+        return true;
+    }
+
+    void InstanceBVH::SaveCache(std::filesystem::path const & cachePath, std::uint64_t const geometryHash) const {
+        ByteWriter writer;
+        for (auto const & bottom : _bottom) {
+            bottom->Binary.Serialize(writer);
+            bottom->Wide.Serialize(writer);
+        }
+
+        CacheHeader header {};
+        std::memcpy(header.Magic, c_CacheMagic, sizeof(header.Magic));
+        header.Version      = c_CacheVersion;
+        header.NumMeshes    = std::uint32_t(_bottom.size());
+        header.GeometryHash = geometryHash;
+        header.ContentHash  = Engine::hash_bytes(writer.GetBytes());
+        if (! Engine::SaveBytes(cachePath, { std::as_bytes(std::span(&header, 1)), writer.GetBytes() }))
+            spdlog::warn("VCX::Labs::Rendering::InstanceBVH::Build(..): cannot write BVH cache {}.", cachePath.filename().string());
+    }
+
+    void InstanceBVH::BuildTopLevel() {
+        _top.Build(ComputeInstanceBoxes());
+    }
+
+    bool InstanceBVH::Refit(std::uint32_t const meshIdx) {
+        auto &       bottom = *_bottom[meshIdx];
+        auto const & mesh   = *_snapshot->GetMesh(meshIdx).Source;
+        bottom.Binary.Refit(mesh);
+        bool const rebuild = bottom.Binary.IsDegraded();
+        if (rebuild) bottom.Binary.Build(mesh, _buildMode);
+        // 4 叉树的收缩只有线性开销, 直接按更新后的二叉树重新收缩
+        bottom.Wide.Build(bottom.Binary, _quantized);
+        return rebuild;
+    }
+
+    void InstanceBVH::RefitTopLevel() {
+        std::size_t const count = _instances.size();
+        auto const        boxes = ComputeInstanceBoxes();
+        if (boxes.size() != count || _top.IsEmpty()) {
+            _top.Build(boxes);
+            return;
+        }
+        _top.Refit(boxes);
+        if (_top.IsDegraded()) _top.Build(boxes);
+    }
+
+    std::vector<AABB> InstanceBVH::ComputeInstanceBoxes() {
+        // 底层根节点的包围盒按实例的变换取 8 个角点, 得到世界空间中的包围盒; 空网格的实例不进入顶层
+        std::vector<AABB> boxes;
+        _instances.clear();
+        for (std::uint32_t i = 0; i < _snapshot->GetInstanceCount(); ++i) {
+            auto const & instance = _snapshot->GetInstance(i);
+            auto const & nodes    = _bottom[instance.Mesh]->Binary.GetNodes();
+            if (nodes.empty()) continue;
+
+            AABB const & local = nodes[0].Bounds;
+            AABB         world;
+            if (instance.Identity) {
+                world = local;
+            } else {
+                for (int c = 0; c < 8; ++c) {
+                    glm::vec3 const corner(c & 1 ? local.Max.x : local.Min.x, c & 2 ? local.Max.y : local.Min.y, c & 4 ? local.Max.z : local.Min.z);
+                    world.Extend(glm::vec3(instance.ObjectToWorld * glm::vec4(corner, 1.0f)));
+                }
+            }
+            boxes.push_back(world);
+            _instances.push_back(i);
+        }
+        return boxes;
+    }
+
+    std::size_t InstanceBVH::GetTriangleCount() const {
+        std::size_t count = 0;
+        for (auto const & bottom : _bottom) count += bottom->Binary.GetInputCount();
+        return count;
+    }
+
+    std::size_t InstanceBVH::GetReferenceCount() const {
+        std::size_t count = 0;
+        for (auto const & bottom : _bottom) count += bottom->Binary.GetPrimitives().size();
+        return count;
+    }
+
+    std::size_t InstanceBVH::GetWideNodeCount() const {
+        std::size_t count = 0;
+        for (auto const & bottom : _bottom) count += bottom->Wide.GetNodeCount();
+        return count;
+    }
+
+    float InstanceBVH::GetSAHCost() const {
+        float       cost  = 0.0f;
+        std::size_t count = 0;
+        for (auto const & bottom : _bottom) {
+            cost += bottom->Binary.GetSAHCost() * bottom->Binary.GetInputCount();
+            count += bottom->Binary.GetInputCount();
+        }
+        return count ? cost / count : 0.0f;
+    }
+
+    std::size_t InstanceBVH::GetMemoryUsage() const {
+        std::size_t bytes = _top.GetMemoryUsage() + _instances.size() * sizeof(std::uint32_t);
+        for (auto const & bottom : _bottom) bytes += bottom->Binary.GetMemoryUsage() + bottom->Wide.GetMemoryUsage();
+        return bytes;
+    }
+
+    bool InstanceBVH::IntersectInstance(std::uint32_t const instanceIdx, Ray const & ray, glm::vec3 const & dir, float const tMin, float & tMax, BVHHit & hit, TraversalStats * const stats) const {
+        auto const & instance = _snapshot->GetInstance(instanceIdx);
+        auto const & bottom   = _bottom[instance.Mesh]->Wide;
+        float        scale    = 1.0f;
+        Ray const    local    = instance.Identity ? ray : ToObjectSpace(instance, ray, dir, scale);
+        if (! (stats ? bottom.Intersect(hit, local, tMin * scale, tMax * scale, *stats) : bottom.Intersect(hit, local, tMin * scale, tMax * scale))) return false;
+        hit.T /= scale;
+        hit.ModelIndex = instanceIdx;
+        tMax           = hit.T;
+        return true;
+    }
+
+    bool InstanceBVH::OccludedInstance(std::uint32_t const instanceIdx, Ray const & ray, glm::vec3 const & dir, float const tMin, float const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        auto const & instance = _snapshot->GetInstance(instanceIdx);
+        auto const & bottom   = _bottom[instance.Mesh]->Wide;
+        float        scale    = 1.0f;
+        Ray const    local    = instance.Identity ? ray : ToObjectSpace(instance, ray, dir, scale);
+        if (! accept) return bottom.Occluded(local, tMin * scale, tMax * scale);
+        return bottom.Occluded(local, tMin * scale, tMax * scale, [&accept, instanceIdx, scale](BVHHit const & hit) {
+            return accept(BVHHit { hit.T / scale, hit.U, hit.V, instanceIdx, hit.FaceIndex });
+        });
+    }
+
+    bool InstanceBVH::Intersect(BVHHit & hit, Ray const & ray, float const tMin, float tMax) const {
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir   = glm::normalize(ray.Direction);
+        bool            found = false;
+        TraverseTopLevel(_top, ray.Origin, 1.0f / dir, tMin, tMax, [&](std::uint32_t const box) {
+            found |= IntersectInstance(_instances[box], ray, dir, tMin, tMax, hit);
+            return false;
+        });
+        return found;
+    }
+
+    bool InstanceBVH::Intersect(BVHHit & hit, Ray const & ray, float const tMin, float tMax, TraversalStats & stats) const {
+        ++stats.Rays;
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir   = glm::normalize(ray.Direction);
+        bool            found = false;
+        TraverseTopLevel(
+            _top, ray.Origin, 1.0f / dir, tMin, tMax, [&](std::uint32_t const box) {
+                found |= IntersectInstance(_instances[box], ray, dir, tMin, tMax, hit, &stats);
+                return false;
+            },
+            &stats);
+        stats.Hits += found;
+        return found;
+    }
+
+    bool InstanceBVH::Occluded(Ray const & ray, float const tMin, float const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir      = glm::normalize(ray.Direction);
+        bool            occluded = false;
+        TraverseTopLevel(_top, ray.Origin, 1.0f / dir, tMin, tMax, [&](std::uint32_t const box) {
+            return occluded = OccludedInstance(_instances[box], ray, dir, tMin, tMax, accept);
+        });
+        return occluded;
+    }
+
+    std::uint32_t InstanceBVH::IntersectPacket(std::span<Ray const> const rays, float const tMin, float const tMax, std::span<BVHHit> const hits) const {
+        if (IsEmpty() || rays.empty()) return 0;
+
+        TopLevelPacket const packet(rays);
+        int const            n = packet.Size;
+        float                tFar[c_PacketSize];
+        std::fill(tFar, tFar + n, tMax);
+
+        std::uint32_t const active = (1u << n) - 1;
+        std::uint32_t       found  = 0;
+        TraversePacketTopLevel(_top, rays, packet, tMin, tFar, active, [&](std::uint32_t const box, std::uint32_t const mask) {
+            std::uint32_t const instanceIdx = _instances[box];
+            auto const &        instance    = _snapshot->GetInstance(instanceIdx);
+            if (instance.Identity) {
+                // 整包交给底层, 未到达该实例的光线以 tMax = tMin 排除在外
+                float t[c_PacketSize];
+                for (int i = 0; i < n; ++i) t[i] = mask >> i & 1 ? tFar[i] : tMin;
+                std::uint32_t const closer = _bottom[instance.Mesh]->Wide.IntersectPacket(rays, tMin, std::span(t, n), hits);
+                for (std::uint32_t m = closer; m; m &= m - 1) {
+                    int const i        = std::countr_zero(m);
+                    tFar[i]            = t[i];
+                    hits[i].ModelIndex = instanceIdx;
+                }
+                found |= closer;
+            } else {
+                // 变换后各条光线方向的长度不同, 逐条求交
+                for (std::uint32_t m = mask; m; m &= m - 1) {
+                    int const i = std::countr_zero(m);
+                    if (IntersectInstance(instanceIdx, rays[i], packet.Dir[i], tMin, tFar[i], hits[i])) found |= 1u << i;
+                }
+            }
+        });
+        return found;
+    }
+
+    std::uint32_t InstanceBVH::OccludedPacket(std::span<Ray const> const rays, float const tMin, std::span<float const> const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        if (IsEmpty() || rays.empty()) return 0;
+
+        TopLevelPacket const packet(rays);
+        int const            n      = packet.Size;
+        std::uint32_t        active = 0;
+        for (int i = 0; i < n; ++i)
+            if (tMax[i] > tMin) active |= 1u << i;
+
+        // 已确定被遮挡的光线不再参与之后的遍历
+        std::uint32_t occluded = 0;
+        TraversePacketTopLevel(_top, rays, packet, tMin, tMax.data(), active, [&](std::uint32_t const box, std::uint32_t const mask) {
+            std::uint32_t const instanceIdx = _instances[box];
+            auto const &        instance    = _snapshot->GetInstance(instanceIdx);
+            if (instance.Identity) {
+                float t[c_PacketSize];
+                for (int i = 0; i < n; ++i) t[i] = mask >> i & 1 ? tMax[i] : tMin;
+                auto const & bottom = _bottom[instance.Mesh]->Wide;
+                occluded |= accept
+                    ? bottom.OccludedPacket(rays, tMin, std::span(t, n), [&accept, instanceIdx](BVHHit const & hit) {
+                          return accept(BVHHit { hit.T, hit.U, hit.V, instanceIdx, hit.FaceIndex });
+                      })
+                    : bottom.OccludedPacket(rays, tMin, std::span(t, n));
+            } else {
+                for (std::uint32_t m = mask; m; m &= m - 1) {
+                    int const i = std::countr_zero(m);
+                    if (OccludedInstance(instanceIdx, rays[i], packet.Dir[i], tMin, tMax[i], accept)) occluded |= 1u << i;
+                }
+            }
+            active &= ~occluded;
+        });
+        return occluded;
+    }
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,92 @@
+// InstanceBVH.h
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Labs/final_hw/BVH.h"
+#include "Labs/final_hw/Ray.h"
+#include "Labs/final_hw/SceneSnapshot.h"
+#include "Labs/final_hw/WideBVH.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 两层加速结构: 快照中的每份网格几何建一棵底层 BVH (塌缩为 4 叉后遍历), 由引用它的所有实例共享;
+    // 顶层 BVH 建在实例的世界空间包围盒上, 光线到达实例时变换到其物体空间继续遍历底层.
+    // 命中的 BVHHit::ModelIndex 为实例 (模型) 的下标, 快照需比它存活得更久
+    class InstanceBVH {
+    public:
+        static constexpr std::size_t c_MaxPacketSize = WideBVH::c_MaxPacketSize;
+
+        // cachePath 非空时底层 BVH 优先从这个缓存文件读取; 缓存以网格几何, 构建算法与构建参数的哈希为键,
+        // 不存在, 过期或损坏时照常构建并写回. 底层以 mode 构建 (Refit 退化后的重建也是), 顶层总是以 SAH 重新构建;
+        // quantized 时底层 4 叉树使用压缩节点, 见 QuantizedBVHNode
+        void Build(SceneSnapshot const & snapshot, std::filesystem::path const & cachePath = {}, BVHBuildMode mode = BVHBuildMode::SAH, bool quantized = false);
+
+        // 场景文件 scene 以 mode 与 quantized 构建时的缓存文件 <scene>.<mode>[.q].bvh; 每种组合各占一个文件,
+        // 切换构建算法或节点格式时不会互相覆盖
+        static std::filesystem::path GetCachePath(std::filesystem::path const & scene, BVHBuildMode mode, bool quantized);
+
+        // 只重建顶层 BVH, 底层保持不变: 快照 UpdateTransforms 之后调用
+        void BuildTopLevel();
+
+        // 快照 UpdateMesh 之后调用: 重算网格 meshIdx 的底层 BVH 的包围盒, SAH 代价退化时改为重建,
+        // 返回是否重建; 底层的包围盒变了, 之后还需要更新顶层
+        bool Refit(std::uint32_t meshIdx);
+
+        // 与 BuildTopLevel 相同, 但只重算顶层节点的包围盒, SAH 代价退化时才重建
+        void RefitTopLevel();
+
+        // 与 BVH::Intersect 语义相同
+        bool Intersect(BVHHit & hit, Ray const & ray, float tMin, float tMax) const;
+
+        // 与 Intersect 相同, 同时累计两层的遍历统计, 见 WideBVH 的同名函数
+        bool Intersect(BVHHit & hit, Ray const & ray, float tMin, float tMax, TraversalStats & stats) const;
+
+        // 与 BVH::Occluded 语义相同
+        bool Occluded(Ray const & ray, float tMin, float tMax, std::function<bool(BVHHit const &)> const & accept = nullptr) const;
+
+        // 与 WideBVH 的光线包版本语义相同, 至多 c_MaxPacketSize 条光线
+        std::uint32_t IntersectPacket(std::span<Ray const> rays, float tMin, float tMax, std::span<BVHHit> hits) const;
+        std::uint32_t OccludedPacket(std::span<Ray const> rays, float tMin, std::span<float const> tMax, std::function<bool(BVHHit const &)> const & accept = nullptr) const;
+
+        bool        IsEmpty() const { return _top.IsEmpty(); }
+        BVH const & GetTopLevel() const { return _top; }
+        std::size_t GetBottomLevelCount() const { return _bottom.size(); }
+        std::size_t GetTriangleCount() const;   // 各底层 BVH 的三角形数之和, 共享的网格只计一次
+        std::size_t GetReferenceCount() const;  // 各底层 BVH 叶节点中的三角形引用数之和, SBVH 中多于三角形数
+        std::size_t GetWideNodeCount() const;   // 各底层 4 叉 BVH 的节点数之和
+        std::size_t GetMemoryUsage() const;     // 两层结构占用的字节数, 共享的底层只计一次
+        float       GetBuildTime() const { return _buildTime; } // 毫秒, 含顶层
+        bool        IsLoadedFromCache() const { return _loadedFromCache; }
+        float       GetSAHCost() const; // 各底层 BVH 的 SAH 代价按三角形数的加权平均
+
+    private:
+        struct BottomLevel {
+            BVH     Binary;
+            WideBVH Wide; // 引用 Binary, 因此 BottomLevel 构建后不能移动
+        };
+
+        void              BuildBottomLevels();
+        bool              LoadCache(std::filesystem::path const & cachePath, std::uint64_t geometryHash);
+        void              SaveCache(std::filesystem::path const & cachePath, std::uint64_t geometryHash) const;
+        std::vector<AABB> ComputeInstanceBoxes(); // 各实例在世界空间中的包围盒, 同时填写 _instances
+
+        bool IntersectInstance(std::uint32_t instanceIdx, Ray const & ray, glm::vec3 const & dir, float tMin, float & tMax, BVHHit & hit, TraversalStats * stats = nullptr) const;
+        bool OccludedInstance(std::uint32_t instanceIdx, Ray const & ray, glm::vec3 const & dir, float tMin, float tMax, std::function<bool(BVHHit const &)> const & accept) const;
+
+        SceneSnapshot const *                     _snapshot = nullptr;
+        std::vector<std::unique_ptr<BottomLevel>> _bottom;    // 与快照中的网格几何一一对应
+        std::vector<std::uint32_t>                _instances; // 顶层图元 (包围盒) 对应的实例, 不含空网格的实例
+        BVH                                       _top;
+        BVHBuildMode                              _buildMode       = BVHBuildMode::SAH;
+        bool                                      _quantized       = false;
+        float                                     _buildTime       = 0.0f;
+        bool                                      _loadedFromCache = false;
+    };
+
+} // namespace VCX::Labs::Rendering
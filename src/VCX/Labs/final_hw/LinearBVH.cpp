@@ -0,0 +1,406 @@
+// LinearBVH.cpp
+#include "Labs/final_hw/LinearBVH.h"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <numeric>
+
+#include "Labs/final_hw/Morton.h"
+#include "Labs/final_hw/Parallel.h"
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        constexpr std::uint32_t c_LeafFlag        = 1u << 31; // 基数树中孩子的引用: 带此标记为排序后的图元序号, 否则为内部节点
+        constexpr std::size_t   c_WideKeyMinCount = 1 << 20;  // 图元更多时改用 63 位 Morton 码, 减少重复的码
+        constexpr int           c_TreeletLeaves   = 7;        // 每个 treelet 的叶数, 动态规划的开销随它指数增长
+        constexpr std::uint32_t c_MinTreeletCount = 16;       // 只重排图元不少于此数的子树: 底部的小子树最多, 重排收益却很少
+        constexpr std::size_t   c_RangesPerThread = 8;        // 并行循环切分的段数与线程数之比
+
+        // 按 keys 对 order 做稳定的 LSD 基数排序, 每趟 8 位: 各段先并行统计直方图, 由前缀和得到每段每个桶的写入位置后并行分发;
+        // 所有键在某一位上都相同的趟直接跳过
+        template<typename Key>
+        void RadixSort(std::vector<Key> & keys, std::vector<std::uint32_t> & order) {
+            std::size_t const n         = keys.size();
+            std::size_t const numRanges = std::max<std::size_t>(1, std::min(c_RangesPerThread * GetThreadCount(), n / 4096));
+            std::size_t const rangeSize = (n + numRanges - 1) / numRanges;
+
+            std::vector<Key>                           keysOut(n);
+            std::vector<std::uint32_t>                 orderOut(n);
+            std::vector<std::array<std::uint32_t, 256>> counts(numRanges);
+            for (int shift = 0; shift < int(sizeof(Key) * 8); shift += 8) {
+                ParallelFor(numRanges, [&](std::size_t const r) {
+                    counts[r].fill(0);
+                    for (std::size_t i = r * rangeSize; i < std::min(n, (r + 1) * rangeSize); ++i) ++counts[r][(keys[i] >> shift) & 0xff];
+                });
+
+                std::uint32_t offset = 0;
+                bool          skip   = false;
+                for (int d = 0; d < 256 && ! skip; ++d) {
+                    std::uint32_t total = 0;
+                    for (std::size_t r = 0; r < numRanges; ++r) {
+                        std::uint32_t const count = counts[r][d];
+                        counts[r][d]              = offset + total;
+                        total += count;
+                    }
+                    skip = total == n;
+                    offset += total;
+                }
+                if (skip) continue;
+
+                ParallelFor(numRanges, [&](std::size_t const r) {
+                    auto & next = counts[r];
+                    for (std::size_t i = r * rangeSize; i < std::min(n, (r + 1) * rangeSize); ++i) {
+                        std::uint32_t const pos = next[(keys[i] >> shift) & 0xff]++;
+                        keysOut[pos]            = keys[i];
+                        orderOut[pos]           = order[i];
+                    }
+                });
+                keys.swap(keysOut);
+                order.swap(orderOut);
+            }
+        }
+
+        // 排序后的 n 个图元上的基数树: n - 1 个内部节点, 0 为根
+        struct RadixTree {
+            std::vector<std::uint32_t> Left, Right; // 孩子的引用
+            std::vector<std::uint32_t> Parent;      // 内部节点的父节点, 根为自身
+            std::vector<std::uint32_t> LeafParent;  // 图元 (叶) 的父节点
+            std::vector<AABB>          Bounds;
+            std::vector<std::uint32_t> Count; // 子树中的图元数
+            std::vector<float>         Cost;  // 子树的 SAH 代价 (未除以根的表面积)
+        };
+
+        // Karras 2012: 内部节点 i 的区间一端是 i, 向公共前缀更长的一侧伸展, 再在区间内二分找到前缀分叉处;
+        // 每个节点只读排序后的键, 可以完全并行. 键相同时用序号补充公共前缀, 保证区间划分唯一
+        template<typename Key>
+        void BuildRadixTree(std::vector<Key> const & keys, RadixTree & tree) {
+            std::int64_t const n     = std::int64_t(keys.size());
+            auto const         Delta = [&](std::int64_t const i, std::int64_t const j) -> int {
+                if (j < 0 || j >= n) return -1;
+                Key const diff = keys[i] ^ keys[j];
+                if (diff != 0) return std::countl_zero(diff);
+                return int(sizeof(Key) * 8) + std::countl_zero(std::uint32_t(i ^ j));
+            };
+
+            ParallelForRange(std::size_t(n - 1), c_RangesPerThread * GetThreadCount(), [&](std::size_t const begin, std::size_t const end) {
+                for (std::int64_t i = std::int64_t(begin); i < std::int64_t(end); ++i) {
+                    int const d         = Delta(i, i + 1) > Delta(i, i - 1) ? 1 : -1;
+                    int const deltaMin  = Delta(i, i - d);
+                    std::int64_t lengthMax = 2;
+                    while (Delta(i, i + lengthMax * d) > deltaMin) lengthMax *= 2;
+                    std::int64_t length = 0;
+                    for (std::int64_t t = lengthMax / 2; t >= 1; t /= 2)
+                        if (Delta(i, i + (length + t) * d) > deltaMin) length += t;
+                    std::int64_t const j         = i + length * d;
+                    int const          deltaNode = Delta(i, j);
+
+                    std::int64_t split = 0;
+                    for (std::int64_t t = length; t > 1;) {
+                        t = (t + 1) / 2;
+                        if (Delta(i, i + (split + t) * d) > deltaNode) split += t;
+                    }
+                    std::int64_t const gamma = i + split * d + std::min(d, 0);
+
+                    std::uint32_t const left  = std::min(i, j) == gamma ? c_LeafFlag | std::uint32_t(gamma) : std::uint32_t(gamma);
+                    std::uint32_t const right = std::max(i, j) == gamma + 1 ? c_LeafFlag | std::uint32_t(gamma + 1) : std::uint32_t(gamma + 1);
+                    tree.Left[i]              = left;
+                    tree.Right[i]             = right;
+                    for (std::uint32_t const child : { left, right }) {
+                        if (child & c_LeafFlag) tree.LeafParent[child & ~c_LeafFlag] = std::uint32_t(i);
+                        else tree.Parent[child] = std::uint32_t(i);
+                    }
+                }
+            });
+            tree.Parent[0] = 0;
+        }
+
+        // 自底向上并行计算包围盒与代价: 每个图元沿父节点向上, 到达内部节点的两条路径中后到的一条继续, 此时两个孩子都已完成.
+        // treelet 重排只改动当前节点子树内部, 子树此时不会再被其他线程访问
+        class BottomUpPass {
+        public:
+            BottomUpPass(RadixTree & tree, std::span<AABB const> boxes, std::vector<std::uint32_t> const & order, bool optimizeTreelets):
+                _tree(tree), _boxes(boxes), _order(order), _optimizeTreelets(optimizeTreelets) {}
+
+            void Run() {
+                std::size_t const                      n = _order.size();
+                std::vector<std::atomic_uint32_t> visits(n - 1);
+                ParallelForRange(n, c_RangesPerThread * GetThreadCount(), [&](std::size_t const begin, std::size_t const end) {
+                    for (std::size_t j = begin; j < end; ++j) {
+                        std::uint32_t node = _tree.LeafParent[j];
+                        while (visits[node].fetch_add(1, std::memory_order_acq_rel) == 1) {
+                            Update(node);
+                            if (_optimizeTreelets && _tree.Count[node] >= c_MinTreeletCount) OptimizeTreelet(node);
+                            if (node == 0) break;
+                            node = _tree.Parent[node];
+                        }
+                    }
+                });
+            }
+
+        private:
+            AABB const & GetBounds(std::uint32_t const ref) const { return ref & c_LeafFlag ? _boxes[_order[ref & ~c_LeafFlag]] : _tree.Bounds[ref]; }
+            std::uint32_t GetCount(std::uint32_t const ref) const { return ref & c_LeafFlag ? 1 : _tree.Count[ref]; }
+            float GetCost(std::uint32_t const ref) const { return ref & c_LeafFlag ? BVH::c_IntersectCost * GetBounds(ref).SurfaceArea() : _tree.Cost[ref]; }
+
+            // 图元不多于 c_MaxLeafSize 的子树在收为叶节点更便宜时展开为叶节点 (见 Emitter::IsLeaf)
+            static float NodeCost(float const area, std::uint32_t const count, float const childCost) {
+                float const cost = BVH::c_TraversalCost * area + childCost;
+                return count <= BVH::c_MaxLeafSize ? std::min(cost, BVH::c_IntersectCost * area * count) : cost;
+            }
+
+            void Update(std::uint32_t const node) {
+                std::uint32_t const left  = _tree.Left[node];
+                std::uint32_t const right = _tree.Right[node];
+                AABB                bounds = GetBounds(left);
+                bounds.Extend(GetBounds(right));
+                _tree.Bounds[node] = bounds;
+                _tree.Count[node]  = GetCount(left) + GetCount(right);
+                _tree.Cost[node]   = NodeCost(bounds.SurfaceArea(), _tree.Count[node], GetCost(left) + GetCost(right));
+            }
+
+            // 反复展开 treelet 中表面积最大的内部节点, 直到有 c_TreeletLeaves 个叶; 对叶的所有子集动态规划出 SAH 代价最小的拓扑,
+            // 比原拓扑更好时复用原来的内部节点重建
+            void OptimizeTreelet(std::uint32_t const root) {
+                std::array<std::uint32_t, c_TreeletLeaves>     leaves { _tree.Left[root], _tree.Right[root] };
+                std::array<std::uint32_t, c_TreeletLeaves - 2> internals;
+                int                                            numLeaves = 2, numInternals = 0;
+                while (numLeaves < c_TreeletLeaves) {
+                    int   best     = -1;
+                    float bestArea = -1.0f;
+                    for (int i = 0; i < numLeaves; ++i) {
+                        if (leaves[i] & c_LeafFlag) continue;
+                        float const area = _tree.Bounds[leaves[i]].SurfaceArea();
+                        if (area > bestArea) {
+                            bestArea = area;
+                            best     = i;
+                        }
+                    }
+                    if (best < 0) break;
+                    std::uint32_t const node   = leaves[best];
+                    internals[numInternals++]  = node;
+                    leaves[best]               = _tree.Left[node];
+                    leaves[numLeaves++]        = _tree.Right[node];
+                }
+                if (numLeaves < 3) return;
+
+                constexpr int                             c_NumSubsets = 1 << c_TreeletLeaves;
+                std::array<AABB, c_NumSubsets>            bounds;
+                std::array<std::uint32_t, c_NumSubsets>   counts;
+                std::array<float, c_NumSubsets>           costs;
+                std::array<std::uint8_t, c_NumSubsets>    splits;
+                int const                                 full = (1 << numLeaves) - 1;
+                for (int s = 1; s <= full; ++s) {
+                    int const k = std::countr_zero(unsigned(s));
+                    if ((s & (s - 1)) == 0) {
+                        bounds[s] = GetBounds(leaves[k]);
+                        counts[s] = GetCount(leaves[k]);
+                        costs[s]  = GetCost(leaves[k]);
+                        continue;
+                    }
+                    bounds[s] = bounds[s & (s - 1)];
+                    bounds[s].Extend(bounds[s & -s]);
+                    counts[s] = counts[s & (s - 1)] + counts[s & -s];
+
+                    // 子集的编号都小于 s, 已经求出; 只枚举含最低位的一半划分以免重复
+                    int const low      = s & -s;
+                    int const rest     = s ^ low;
+                    float     bestCost = std::numeric_limits<float>::max();
+                    for (int q = (rest - 1) & rest;; q = (q - 1) & rest) {
+                        float const cost = costs[q | low] + costs[rest ^ q];
+                        if (cost < bestCost) {
+                            bestCost  = cost;
+                            splits[s] = std::uint8_t(q | low);
+                        }
+                        if (q == 0) break;
+                    }
+                    costs[s] = NodeCost(bounds[s].SurfaceArea(), counts[s], bestCost);
+                }
+                if (costs[full] >= _tree.Cost[root] * (1.0f - 1e-5f)) return;
+
+                int        next    = 0;
+                auto const Rebuild = [&](auto const & self, int const s, std::uint32_t const node) -> void {
+                    _tree.Bounds[node] = bounds[s];
+                    _tree.Count[node]  = counts[s];
+                    _tree.Cost[node]   = costs[s];
+                    std::uint32_t children[2];
+                    int const     parts[2] = { splits[s], s ^ splits[s] };
+                    for (int c = 0; c < 2; ++c) {
+                        if ((parts[c] & (parts[c] - 1)) == 0) {
+                            children[c] = leaves[std::countr_zero(unsigned(parts[c]))];
+                        } else {
+                            children[c] = internals[next++];
+                            self(self, parts[c], children[c]);
+                        }
+                        if (children[c] & c_LeafFlag) _tree.LeafParent[children[c] & ~c_LeafFlag] = node;
+                        else _tree.Parent[children[c]] = node;
+                    }
+                    _tree.Left[node]  = children[0];
+                    _tree.Right[node] = children[1];
+                };
+                Rebuild(Rebuild, full, root);
+            }
+
+            RadixTree &                        _tree;
+            std::span<AABB const>              _boxes;
+            std::vector<std::uint32_t> const & _order;
+            bool                               _optimizeTreelets;
+        };
+
+        // 把基数树展开为先序排列的 BVHNode: 根附近的节点顺序展开, 其下足够小的子树作为任务各自并行展开到局部数组,
+        // 最后按先序拼接并把局部下标平移到全局
+        class Emitter {
+        public:
+            Emitter(RadixTree const & tree, std::span<AABB const> boxes, std::vector<std::uint32_t> const & order, int const maxDepth):
+                _tree(tree), _boxes(boxes), _order(order), _maxDepth(maxDepth) {}
+
+            void Run(std::vector<BVHNode> & nodes, std::vector<std::uint32_t> & primitives) {
+                std::size_t const   n    = _order.size();
+                std::uint32_t const root = n > 1 ? 0 : c_LeafFlag;
+                _grain                   = n / (c_RangesPerThread * GetThreadCount()) + 1;
+                Split(root, 0);
+                ParallelFor(_tasks.size(), [&](std::size_t const t) { EmitSubtree(_tasks[t].Ref, _tasks[t].Depth, _tasks[t].Nodes, _tasks[t].Primitives); });
+
+                std::size_t numNodes = CountUpperNodes(root, 0);
+                for (auto const & task : _tasks) numNodes += task.Nodes.size();
+                nodes.resize(numNodes);
+                primitives.resize(n);
+                std::uint32_t nodeCursor = 0, primCursor = 0, taskCursor = 0;
+                Place(root, 0, nodes, nodeCursor, primCursor, taskCursor);
+                ParallelFor(_tasks.size(), [&](std::size_t const t) {
+                    auto const & task = _tasks[t];
+                    for (std::size_t i = 0; i < task.Nodes.size(); ++i) {
+                        BVHNode node = task.Nodes[i];
+                        node.Offset += node.IsLeaf() ? task.PrimitiveBase : task.NodeBase;
+                        nodes[task.NodeBase + i] = node;
+                    }
+                    std::copy(task.Primitives.begin(), task.Primitives.end(), primitives.begin() + task.PrimitiveBase);
+                });
+            }
+
+        private:
+            struct Task {
+                std::uint32_t              Ref;
+                int                        Depth;
+                std::vector<BVHNode>       Nodes;
+                std::vector<std::uint32_t> Primitives;
+                std::uint32_t              NodeBase      = 0;
+                std::uint32_t              PrimitiveBase = 0;
+            };
+
+            bool IsLeaf(std::uint32_t const ref, int const depth) const {
+                if ((ref & c_LeafFlag) || depth >= _maxDepth) return true;
+                return _tree.Count[ref] <= BVH::c_MaxLeafSize && _tree.Cost[ref] >= BVH::c_IntersectCost * _tree.Bounds[ref].SurfaceArea() * _tree.Count[ref];
+            }
+
+            bool IsTask(std::uint32_t const ref, int const depth) const { return IsLeaf(ref, depth) || _tree.Count[ref] <= _grain; }
+
+            AABB const & GetBounds(std::uint32_t const ref) const { return ref & c_LeafFlag ? _boxes[_order[ref & ~c_LeafFlag]] : _tree.Bounds[ref]; }
+
+            // 根附近图元多于 _grain 的内部节点留给 Place 顺序展开, 其余子树成为任务
+            void Split(std::uint32_t const ref, int const depth) {
+                if (IsTask(ref, depth)) {
+                    _tasks.push_back({ ref, depth, {}, {} });
+                    return;
+                }
+                Split(_tree.Left[ref], depth + 1);
+                Split(_tree.Right[ref], depth + 1);
+            }
+
+            std::size_t CountUpperNodes(std::uint32_t const ref, int const depth) const {
+                if (IsTask(ref, depth)) return 0;
+                return 1 + CountUpperNodes(_tree.Left[ref], depth + 1) + CountUpperNodes(_tree.Right[ref], depth + 1);
+            }
+
+            // 与 Split 相同的先序遍历: 放置根附近的节点, 为任务分配全局下标, 返回 ref 的下标
+            std::uint32_t Place(std::uint32_t const ref, int const depth, std::vector<BVHNode> & nodes, std::uint32_t & nodeCursor, std::uint32_t & primCursor, std::uint32_t & taskCursor) {
+                std::uint32_t const nodeIdx = nodeCursor;
+                if (IsTask(ref, depth)) {
+                    auto & task        = _tasks[taskCursor++];
+                    task.NodeBase      = nodeCursor;
+                    task.PrimitiveBase = primCursor;
+                    nodeCursor += std::uint32_t(task.Nodes.size());
+                    primCursor += std::uint32_t(task.Primitives.size());
+                    return nodeIdx;
+                }
+                ++nodeCursor;
+                Place(_tree.Left[ref], depth + 1, nodes, nodeCursor, primCursor, taskCursor);
+                std::uint32_t const right = Place(_tree.Right[ref], depth + 1, nodes, nodeCursor, primCursor, taskCursor);
+                nodes[nodeIdx]            = { _tree.Bounds[ref], right, 0 };
+                return nodeIdx;
+            }
+
+            // 顺序展开一棵子树, 下标都相对于局部数组
+            std::uint32_t EmitSubtree(std::uint32_t const ref, int const depth, std::vector<BVHNode> & nodes, std::vector<std::uint32_t> & primitives) const {
+                std::uint32_t const nodeIdx = std::uint32_t(nodes.size());
+                nodes.emplace_back();
+                if (IsLeaf(ref, depth)) {
+                    std::uint32_t const first = std::uint32_t(primitives.size());
+                    CollectPrimitives(ref, primitives);
+                    nodes[nodeIdx]            = { GetBounds(ref), first, std::uint32_t(primitives.size()) - first };
+                    return nodeIdx;
+                }
+                EmitSubtree(_tree.Left[ref], depth + 1, nodes, primitives);
+                std::uint32_t const right = EmitSubtree(_tree.Right[ref], depth + 1, nodes, primitives);
+                nodes[nodeIdx]            = { _tree.Bounds[ref], right, 0 };
+                return nodeIdx;
+            }
+
+            void CollectPrimitives(std::uint32_t const ref, std::vector<std::uint32_t> & primitives) const {
+                if (ref & c_LeafFlag) {
+                    primitives.push_back(_order[ref & ~c_LeafFlag]);
+                    return;
+                }
+                CollectPrimitives(_tree.Left[ref], primitives);
+                CollectPrimitives(_tree.Right[ref], primitives);
+            }
+
+            RadixTree const &                  _tree;
+            std::span<AABB const>              _boxes;
+            std::vector<std::uint32_t> const & _order;
+            int                                _maxDepth;
+            std::size_t                        _grain = 0;
+            std::vector<Task>                  _tasks;
+        };
+    } // namespace
+
+    void BuildLinearBVH(std::span<AABB const> const boxes, bool const optimizeTreelets, int const maxDepth, std::vector<BVHNode> & nodes, std::vector<std::uint32_t> & primitives) {
+        nodes.clear();
+        primitives.clear();
+        std::size_t const n = boxes.size();
+        if (n == 0) return;
+
+        AABB centroidBounds;
+        for (auto const & box : boxes) centroidBounds.Extend(box.Centroid());
+        glm::vec3 const origin = centroidBounds.Min;
+        glm::vec3 const scale  = 1.0f / glm::max(centroidBounds.Max - centroidBounds.Min, glm::vec3(std::numeric_limits<float>::min()));
+
+        std::vector<std::uint32_t> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        RadixTree  tree;
+        auto const BuildTree = [&]<typename Key>(Key) {
+            std::vector<Key> keys(n);
+            ParallelForRange(n, c_RangesPerThread * GetThreadCount(), [&](std::size_t const begin, std::size_t const end) {
+                for (std::size_t i = begin; i < end; ++i) keys[i] = MortonCode<Key>((boxes[i].Centroid() - origin) * scale);
+            });
+            RadixSort(keys, order);
+            BuildRadixTree(keys, tree);
+        };
+
+        std::size_t const numInternals = std::max<std::size_t>(n, 2) - 1;
+        tree.Left.resize(numInternals);
+        tree.Right.resize(numInternals);
+        tree.Parent.resize(numInternals);
+        tree.LeafParent.resize(n);
+        tree.Bounds.resize(numInternals);
+        tree.Count.resize(numInternals);
+        tree.Cost.resize(numInternals);
+        if (n > 1) {
+            if (n >= c_WideKeyMinCount) BuildTree(std::uint64_t());
+            else BuildTree(std::uint32_t());
+            BottomUpPass(tree, boxes, order, optimizeTreelets).Run();
+        }
+        Emitter(tree, boxes, order, maxDepth).Run(nodes, primitives);
+    }
+
+} // namespace VCX::Labs::Rendering
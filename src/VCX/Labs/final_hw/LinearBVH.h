@@ -0,0 +1,18 @@
+// LinearBVH.h
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Labs/final_hw/BVH.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 线性 BVH (LBVH): 包围盒中心的 Morton 码并行基数排序后, 并行求出基数树的每个内部节点 (Karras 2012),
+    // 再并行按先序展开为 BVHNode. optimizeTreelets 时在自底向上计算包围盒的同一遍中重排每个足够大的
+    // 7 叶 treelet (Karras & Aila 2013), 用少量构建时间换回大部分 SAH 质量.
+    // 输出与 BVH 内部的布局相同: primitives 为叶节点顺序的 boxes 下标, 深度超过 maxDepth 的子树收为一个叶节点
+    void BuildLinearBVH(std::span<AABB const> boxes, bool optimizeTreelets, int maxDepth, std::vector<BVHNode> & nodes, std::vector<std::uint32_t> & primitives);
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,39 @@
+// Morton.h
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace VCX::Labs::Rendering {
+
+    // 把 10 位整数的各位分散到每 3 位的最低位上
+    inline std::uint32_t SpreadBits(std::uint32_t x) {
+        x = (x | (x << 16)) & 0x030000ffu;
+        x = (x | (x << 8)) & 0x0300f00fu;
+        x = (x | (x << 4)) & 0x030c30c3u;
+        x = (x | (x << 2)) & 0x09249249u;
+        return x;
+    }
+
+    // 把 21 位整数的各位分散到每 3 位的最低位上
+    inline std::uint64_t SpreadBits(std::uint64_t x) {
+        x = (x | (x << 32)) & 0x001f00000000ffffull;
+        x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+        x = (x | (x << 8)) & 0x100f00f00f00f00full;
+        x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+        x = (x | (x << 2)) & 0x1249249249249249ull;
+        return x;
+    }
+
+    // p 的各分量在 [0, 1] 内; 32 位键为 30 位码, 64 位键为 63 位码
+    template<typename Key>
+    Key MortonCode(glm::vec3 const & p) {
+        constexpr float scale = float((Key(1) << (sizeof(Key) * 8 / 3)) - 1);
+        Key const       x     = Key(glm::clamp(p.x * scale, 0.0f, scale));
+        Key const       y     = Key(glm::clamp(p.y * scale, 0.0f, scale));
+        Key const       z     = Key(glm::clamp(p.z * scale, 0.0f, scale));
+        return (SpreadBits(x) << 2) | (SpreadBits(y) << 1) | SpreadBits(z);
+    }
+
+} // namespace VCX::Labs::Rendering
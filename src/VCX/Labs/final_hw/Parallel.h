@@ -0,0 +1,48 @@
+// Parallel.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace VCX::Labs::Rendering {
+
+    namespace detail {
+        inline std::atomic_size_t s_ThreadCount { 0 };
+    }
+
+    // 并行算法使用的线程数, 默认为硬件线程数
+    inline std::size_t GetThreadCount() {
+        std::size_t const count = detail::s_ThreadCount.load(std::memory_order_relaxed);
+        return count ? count : std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // 设置并行算法使用的线程数, 0 恢复为硬件线程数; 可以多于硬件线程数, 用于在核数少的机器上检查并行与串行的结果一致
+    inline void SetThreadCount(std::size_t const count) { detail::s_ThreadCount.store(count, std::memory_order_relaxed); }
+
+    // 在 GetThreadCount() 个线程上对 [0, count) 中的每个 i 调用 func(i), 各线程依次领取下一个下标
+    template<typename Func>
+    void ParallelFor(std::size_t const count, Func const & func) {
+        std::size_t const  numThreads = std::min(count, GetThreadCount());
+        std::atomic_size_t next { 0 };
+        auto const         Work = [&]() {
+            for (std::size_t i; (i = next++) < count;) func(i);
+        };
+
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < numThreads; ++t) threads.emplace_back(Work);
+        Work();
+        for (auto & thread : threads) thread.join();
+    }
+
+    // 把 [0, count) 均分为至多 numRanges 段连续区间, 并行地对每段调用 func(begin, end)
+    template<typename Func>
+    void ParallelForRange(std::size_t const count, std::size_t const numRanges, Func const & func) {
+        std::size_t const size = (count + numRanges - 1) / std::max<std::size_t>(numRanges, 1);
+        if (size == 0) return;
+        ParallelFor((count + size - 1) / size, [&](std::size_t const i) { func(i * size, std::min(count, (i + 1) * size)); });
+    }
+
+} // namespace VCX::Labs::Rendering
@@ -1,18 +1,19 @@
 // PathTracing.cpp
 #include "Labs/final_hw/PathTracing.h"
 #include <algorithm>
+#include <bit>
 #include <cmath>
+#include <limits>
+#include <vector>
 
-namespace VCX::Labs::Rendering {
+#include "Labs/final_hw/Morton.h"
 
-    // 定义线程局部随机数生成器
-    thread_local std::mt19937                          RandomGenerator(std::random_device {}());
-    thread_local std::uniform_real_distribution<float> RandomDistribution(0.0f, 1.0f);
+namespace VCX::Labs::Rendering {
 
     // 在单位半球上均匀采样
-    glm::vec3 SampleHemisphereUniform(const glm::vec3 & normal) {
-        float u1 = RandomFloat();
-        float u2 = RandomFloat();
+    glm::vec3 SampleHemisphereUniform(const glm::vec3 & normal, const glm::vec2 & u) {
+        float u1 = u.x;
+        float u2 = u.y;
 
         float r   = sqrt(1.0f - u1 * u1);
         float phi = 2.0f * glm::pi<float>() * u2;
@@ -39,9 +40,9 @@ namespace VCX::Labs::Rendering {
     }
 
     // 基于余弦权重的半球采样
-    glm::vec3 SampleHemisphereCosine(const glm::vec3 & normal) {
-        float u1 = RandomFloat();
-        float u2 = RandomFloat();
+    glm::vec3 SampleHemisphereCosine(const glm::vec3 & normal, const glm::vec2 & u) {
+        float u1 = u.x;
+        float u2 = u.y;
 
         float r     = sqrt(u1);
         float theta = 2.0f * glm::pi<float>() * u2;
@@ -69,14 +70,14 @@ namespace VCX::Labs::Rendering {
     }
 
     // 重要性采样（基于粗糙度）
-    glm::vec3 SampleHemisphereImportance(const glm::vec3 & normal, float roughness) {
+    glm::vec3 SampleHemisphereImportance(const glm::vec3 & normal, float roughness, const glm::vec2 & u) {
         // 基于粗糙度选择采样策略
         if (roughness > 0.5f) {
             // 粗糙表面使用余弦采样
-            return SampleHemisphereCosine(normal);
+            return SampleHemisphereCosine(normal, u);
         } else {
             // 光滑表面使用均匀采样
-            return SampleHemisphereUniform(normal);
+            return SampleHemisphereUniform(normal, u);
         }
     }
 
@@ -133,8 +134,8 @@ namespace VCX::Labs::Rendering {
     }
 
     // BRDF重要性采样
-    glm::vec3 BRDF::Sample(const glm::vec3 & wo, const glm::vec3 & normal, float & pdf) const {
-        float r = RandomFloat();
+    glm::vec3 BRDF::Sample(const glm::vec3 & wo, const glm::vec3 & normal, float uLobe, const glm::vec2 & u, float & pdf) const {
+        float r = uLobe;
 
         // 根据金属度和粗糙度决定采样策略
         if (Metallic > 0.8f && Roughness < 0.1f) {
@@ -144,13 +145,13 @@ namespace VCX::Labs::Rendering {
             return wi;
         } else if (r < 0.5f) {
             // 漫反射采样（余弦权重）
-            glm::vec3 wi = SampleHemisphereCosine(normal);
+            glm::vec3 wi = SampleHemisphereCosine(normal, u);
             pdf          = glm::max(0.0f, glm::dot(normal, wi)) / glm::pi<float>();
             return wi;
         } else {
             // 镜面反射采样（基于粗糙度）
-            float u1 = RandomFloat();
-            float u2 = RandomFloat();
+            float u1 = u.x;
+            float u2 = u.y;
 
             float alpha    = Roughness * Roughness;
             float phi      = 2.0f * glm::pi<float>() * u1;
@@ -241,23 +242,24 @@ namespace VCX::Labs::Rendering {
         return brdf;
     }
 
-    // 直接光照采样 (Next Event Estimation)
-    glm::vec3 SampleDirectLighting(
-        const RayIntersector & intersector,
-        const glm::vec3 &      position,
-        const glm::vec3 &      normal,
-        const BRDF &           brdf,
-        const glm::vec3 &      wo) {
-        glm::vec3    directLight(0.0f);
-        const auto & scene  = *intersector.InternalScene;
-        const auto & lights = scene.Lights;
+    // 选择光源并构造阴影光线
+    DirectLightSample SampleLight(
+        const Engine::Scene & scene,
+        const RayHit &        hit,
+        const glm::vec3 &     normal,
+        const BRDF &          brdf,
+        const glm::vec3 &     wo,
+        float                 uLight) {
+        DirectLightSample sample;
+        const auto &      lights   = scene.Lights;
+        const glm::vec3 & position = hit.IntersectPosition;
 
         if (lights.empty()) {
-            return directLight;
+            return sample;
         }
 
         // 随机选择一个光源
-        int          lightIndex = int(RandomFloat() * lights.size());
+        int          lightIndex = glm::min(int(uLight * lights.size()), int(lights.size()) - 1);
         const auto & light      = lights[lightIndex];
 
         glm::vec3 lightDir;
@@ -303,19 +305,10 @@ namespace VCX::Labs::Rendering {
             lightIntensity /= (lightDistance * lightDistance);
         }
 
-        // 检查遮挡
-        Ray  shadowRay(position + normal * EPS1, lightDir);
-        auto shadowHit = intersector.IntersectRay(shadowRay);
-
-        if (shadowHit.IntersectState) {
-            if (shadowHit.IntersectAlbedo.w >= 0.2f) {
-                glm::vec3 shadowPos  = shadowHit.IntersectPosition;
-                float     shadowDist = glm::length(shadowPos - position);
-                if (shadowDist < lightDistance - EPS1) {
-                    return directLight;
-                }
-            }
-        }
+        // 阴影光线只需判断光源之前是否存在遮挡物; 点光源与聚光灯不是几何体, 距离从偏移后的起点量起
+        glm::vec3 const origin = SpawnRayOrigin(hit, lightDir);
+        sample.ShadowRay       = Ray(origin, lightDir);
+        sample.MaxDistance     = light.Type == Engine::LightType::Directional ? lightDistance : glm::distance(origin, light.Position);
 
         // 计算直接光照贡献
         float ndotl = glm::max(0.0f, glm::dot(normal, lightDir));
@@ -330,13 +323,30 @@ namespace VCX::Labs::Rendering {
                 weight = lightPdf * lightPdf / (lightPdf * lightPdf + brdfPdf * brdfPdf);
             }
 
-            directLight = brdfValue * lightIntensity * ndotl * weight / lightPdf;
+            sample.Radiance = brdfValue * lightIntensity * ndotl * weight / lightPdf;
         }
 
         // 乘以光源选择概率的倒数
-        directLight *= lights.size();
+        sample.Radiance *= lights.size();
 
-        return directLight;
+        return sample;
+    }
+
+    // 直接光照采样 (Next Event Estimation)
+    glm::vec3 SampleDirectLighting(
+        const RayIntersector & intersector,
+        const RayHit &         hit,
+        const glm::vec3 &      normal,
+        const BRDF &           brdf,
+        const glm::vec3 &      wo,
+        float                  uLight) {
+        const DirectLightSample sample = SampleLight(*intersector.InternalScene, hit, normal, brdf, wo, uLight);
+
+        // 没有贡献的样本不必追踪阴影光线
+        if (sample.Radiance == glm::vec3(0.0f) || intersector.Occluded(sample.ShadowRay, sample.MaxDistance)) {
+            return glm::vec3(0.0f);
+        }
+        return sample.Radiance;
     }
 
     // 环境光采样 (天空光)
@@ -348,82 +358,99 @@ namespace VCX::Labs::Rendering {
         return color * intensity;
     }
 
-    // Path Tracing核心函数
-    glm::vec3 PathTrace(
+    // 命中点的法线, 翻转到入射一侧
+    static glm::vec3 FacingNormal(const RayHit & hit, const Ray & ray) {
+        glm::vec3 const normal = glm::normalize(hit.IntersectNormal);
+        return glm::dot(normal, -ray.Direction) < 0.0f ? -normal : normal;
+    }
+
+    bool ShadePathVertex(
         const RayIntersector & intersector,
-        Ray                    ray,
-        int                    maxBounces,
+        const Sampler &        sampler,
+        const RayHit &         rayHit,
+        int                    bounce,
         bool                   enableDirectLighting,
         bool                   enableRussianRoulette,
         bool                   enableNextEventEstimation,
         float                  skyLightIntensity,
-        const glm::vec3 &      skyLightColor) {
-        glm::vec3 throughput(1.0f);
-        glm::vec3 radiance(0.0f);
+        const glm::vec3 &      skyLightColor,
+        const glm::vec3 *      directLight,
+        Ray &                  ray,
+        glm::vec3 &            throughput,
+        glm::vec3 &            radiance) {
+        if (! rayHit.IntersectState) {
+            // 命中天空，添加环境光
+            radiance += throughput * SampleEnvironmentLight(ray, skyLightIntensity, skyLightColor);
+            return false;
+        }
 
-        for (int bounce = 0; bounce <= maxBounces; bounce++) {
-            auto rayHit = intersector.IntersectRay(ray);
+        const glm::vec3 pos    = rayHit.IntersectPosition;
+        const glm::vec3 normal = FacingNormal(rayHit, ray);
 
-            if (! rayHit.IntersectState) {
-                // 命中天空，添加环境光
-                radiance += throughput * SampleEnvironmentLight(ray, skyLightIntensity, skyLightColor);
-                break;
-            }
+        // 创建BRDF
+        BRDF brdf = CreateBRDFFromMaterial(rayHit.IntersectAlbedo, rayHit.IntersectMetaSpec);
 
-            const glm::vec3 pos      = rayHit.IntersectPosition;
-            glm::vec3       normal   = glm::normalize(rayHit.IntersectNormal);
-            const glm::vec4 albedo   = rayHit.IntersectAlbedo;
-            const glm::vec4 metaSpec = rayHit.IntersectMetaSpec;
+        // 自发光（如果有）
+        // 注意：当前场景格式不支持自发光，这里为0
+        glm::vec3 emission = glm::vec3(0.0f);
+        radiance += throughput * emission;
 
-            // 确保法线朝向入射方向
-            if (glm::dot(normal, -ray.Direction) < 0.0f) {
-                normal = -normal;
-            }
+        // 直接光照 (Next Event Estimation)
+        if (enableDirectLighting && enableNextEventEstimation) {
+            radiance += throughput * (directLight ? *directLight : SampleDirectLighting(intersector, rayHit, normal, brdf, -ray.Direction, sampler.Get1D(SampleDim::Bounce(bounce, SampleDim::Light))));
+        }
 
-            // 创建BRDF
-            BRDF brdf = CreateBRDFFromMaterial(albedo, metaSpec);
+        // 重要性采样下一个方向
+        glm::vec3 wo = -ray.Direction;
+        float     pdf;
+        glm::vec3 wi = brdf.Sample(wo, normal, sampler.Get1D(SampleDim::Bounce(bounce, SampleDim::Lobe)), sampler.Get2D(SampleDim::Bounce(bounce, SampleDim::Direction)), pdf);
 
-            // 自发光（如果有）
-            // 注意：当前场景格式不支持自发光，这里为0
-            glm::vec3 emission = glm::vec3(0.0f);
-            radiance += throughput * emission;
+        if (pdf < 1e-6f) {
+            return false;
+        }
 
-            // 直接光照 (Next Event Estimation)
-            if (enableDirectLighting && enableNextEventEstimation) {
-                glm::vec3 directLight = SampleDirectLighting(intersector, pos, normal, brdf, -ray.Direction);
-                radiance += throughput * directLight;
-            }
+        // 计算BRDF值
+        glm::vec3 brdfValue = brdf.Evaluate(wi, wo, normal);
 
-            // 重要性采样下一个方向
-            glm::vec3 wo = -ray.Direction;
-            float     pdf;
-            glm::vec3 wi = brdf.Sample(wo, normal, pdf);
+        // 更新吞吐量
+        float ndotl = glm::max(0.0f, glm::dot(normal, wi));
+        throughput *= brdfValue * ndotl / pdf;
 
-            if (pdf < 1e-6f) {
-                break;
+        // 俄罗斯轮盘赌终止
+        if (enableRussianRoulette && bounce > 2) {
+            float surviveProb = glm::min(1.0f, glm::max(glm::max(throughput.x, throughput.y), throughput.z));
+            if (sampler.Get1D(SampleDim::Bounce(bounce, SampleDim::Roulette)) > surviveProb) {
+                return false;
             }
+            throughput /= surviveProb;
+        }
 
-            // 计算BRDF值
-            glm::vec3 brdfValue = brdf.Evaluate(wi, wo, normal);
-
-            // 更新吞吐量
-            float ndotl = glm::max(0.0f, glm::dot(normal, wi));
-            throughput *= brdfValue * ndotl / pdf;
+        // 准备下一次反弹: 光线锥从命中处的宽度继续扩散, 粗糙表面按 alpha = roughness^2 的波瓣宽度额外展开
+        float const coneWidth = ray.ConeWidth + ray.ConeSpread * glm::distance(ray.Origin, pos);
+        ray                   = Ray(SpawnRayOrigin(rayHit, wi), wi, coneWidth, ray.ConeSpread + 2.0f * brdf.Roughness * brdf.Roughness);
 
-            // 俄罗斯轮盘赌终止
-            if (enableRussianRoulette && bounce > 2) {
-                float surviveProb = glm::min(1.0f, glm::max(glm::max(throughput.x, throughput.y), throughput.z));
-                if (RandomFloat() > surviveProb) {
-                    break;
-                }
-                throughput /= surviveProb;
-            }
+        // 如果吞吐量太小，提前终止
+        return glm::max(glm::max(throughput.x, throughput.y), throughput.z) >= 1e-3f;
+    }
 
-            // 准备下一次反弹
-            ray = Ray(pos + normal * EPS1, wi);
+    // Path Tracing核心函数
+    glm::vec3 PathTrace(
+        const RayIntersector & intersector,
+        const Sampler &        sampler,
+        Ray                    ray,
+        int                    maxBounces,
+        bool                   enableDirectLighting,
+        bool                   enableRussianRoulette,
+        bool                   enableNextEventEstimation,
+        float                  skyLightIntensity,
+        const glm::vec3 &      skyLightColor,
+        const RayHit *         primaryHit) {
+        glm::vec3 throughput(1.0f);
+        glm::vec3 radiance(0.0f);
 
-            // 如果吞吐量太小，提前终止
-            if (glm::max(glm::max(throughput.x, throughput.y), throughput.z) < 1e-3f) {
+        for (int bounce = 0; bounce <= maxBounces; bounce++) {
+            auto rayHit = primaryHit && bounce == 0 ? *primaryHit : intersector.IntersectRay(ray);
+            if (! ShadePathVertex(intersector, sampler, rayHit, bounce, enableDirectLighting, enableRussianRoulette, enableNextEventEstimation, skyLightIntensity, skyLightColor, nullptr, ray, throughput, radiance)) {
                 break;
             }
         }
@@ -431,69 +458,139 @@ namespace VCX::Labs::Rendering {
         return radiance;
     }
 
-    // 渐进式Path Tracing实现
-    ProgressivePathTracer::ProgressivePathTracer(int width, int height): _width(width), _height(height), _sampleCount(0) {
-        _buffer      = Common::ImageRGB(width, height);
-        _accumulator = Common::ImageRGB(width, height);
+    void PathTracePacket(
+        const RayIntersector &       intersector,
+        Sampler &                    sampler,
+        std::span<const PixelSample> samples,
+        int                          maxBounces,
+        bool                         enableDirectLighting,
+        bool                         enableRussianRoulette,
+        bool                         enableNextEventEstimation,
+        float                        skyLightIntensity,
+        const glm::vec3 &            skyLightColor,
+        std::span<glm::vec3>         radiance) {
+        constexpr std::size_t c_PacketSize = RayIntersector::c_MaxPacketSize;
+
+        for (std::size_t first = 0; first < samples.size(); first += c_PacketSize) {
+            std::size_t const count = std::min(c_PacketSize, samples.size() - first);
+
+            // 相机光线成包求交
+            Ray    rays[c_PacketSize];
+            RayHit hits[c_PacketSize];
+            for (std::size_t i = 0; i < count; ++i) rays[i] = samples[first + i].CameraRay;
+            intersector.IntersectPacket(std::span(rays, count), std::span(hits, count));
+
+            // 阴影光线与之后的反弹逐条追踪: 阴影光线从分散的交点出发, 成包求交反而比单条光线慢
+            for (std::size_t i = 0; i < count; ++i) {
+                sampler.StartPixelSample(samples[first + i].Pixel, samples[first + i].SampleIndex);
+                radiance[first + i] = PathTrace(
+                    intersector,
+                    sampler,
+                    rays[i],
+                    maxBounces,
+                    enableDirectLighting,
+                    enableRussianRoulette,
+                    enableNextEventEstimation,
+                    skyLightIntensity,
+                    skyLightColor,
+                    &hits[i]);
+            }
+        }
     }
 
-    void ProgressivePathTracer::RenderFrame(
-        const RayIntersector & intersector,
-        const Engine::Camera & camera,
-        int                    samplesPerPixel,
-        int                    maxBounces,
-        bool                   enableDirectLighting,
-        bool                   enableRussianRoulette,
-        bool                   enableNextEventEstimation,
-        float                  skyLightIntensity,
-        const glm::vec3 &      skyLightColor) {
-        _sampleCount++;
-
-        // 并行渲染所有像素（简化版，实际应该使用并行算法）
-        for (int y = 0; y < _height; y++) {
-            for (int x = 0; x < _width; x++) {
-                glm::vec3 accumulatedColor(0.0f);
-
-                // 每像素多次采样
-                for (int s = 0; s < samplesPerPixel; s++) {
-                    // 像素内随机采样
-                    float di = RandomFloat() - 0.5f;
-                    float dj = RandomFloat() - 0.5f;
-
-                    glm::vec3 lookDir   = glm::normalize(camera.Target - camera.Eye);
-                    glm::vec3 rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
-                    glm::vec3 upDir     = glm::normalize(glm::cross(rightDir, lookDir));
-                    float     aspect    = _width * 1.f / _height;
-                    float     fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
-
-                    glm::vec3 pixelLookDir = lookDir;
-                    pixelLookDir += fovFactor * (2.0f * (y + dj) / _height - 1.0f) * upDir;
-                    pixelLookDir += fovFactor * aspect * (2.0f * (x + di) / _width - 1.0f) * rightDir;
-
-                    Ray ray(camera.Eye, glm::normalize(pixelLookDir));
-
-                    // Path Tracing
-                    glm::vec3 sampleColor = PathTrace(
-                        intersector,
-                        ray,
-                        maxBounces,
-                        enableDirectLighting,
-                        enableRussianRoulette,
-                        enableNextEventEstimation,
-                        skyLightIntensity,
-                        skyLightColor);
-
-                    accumulatedColor += sampleColor;
+    // 键的高 32 位为 3 位卦限与 30 位 Morton 码去掉最低一位后的 29 位, 低 32 位存路径序号, 键相同的路径保持原来的相对顺序
+    void SortRays(std::span<const Ray> rays, std::vector<std::uint32_t> & active, std::vector<std::uint64_t> & keys) {
+        AABB bounds;
+        for (std::uint32_t const i : active) bounds.Extend(rays[i].Origin);
+        glm::vec3 const scale = 1.0f / glm::max(bounds.Max - bounds.Min, glm::vec3(std::numeric_limits<float>::min()));
+
+        keys.resize(active.size());
+        for (std::size_t k = 0; k < active.size(); ++k) {
+            const Ray &         ray    = rays[active[k]];
+            std::uint32_t const octant = std::uint32_t(ray.Direction.x < 0.0f) | std::uint32_t(ray.Direction.y < 0.0f) << 1 | std::uint32_t(ray.Direction.z < 0.0f) << 2;
+            std::uint32_t const morton = MortonCode<std::uint32_t>((ray.Origin - bounds.Min) * scale);
+            keys[k]                    = std::uint64_t(octant << 29 | morton >> 1) << 32 | active[k];
+        }
+        std::sort(keys.begin(), keys.end());
+        for (std::size_t k = 0; k < active.size(); ++k) active[k] = std::uint32_t(keys[k]);
+    }
+
+    std::size_t PathTraceWavefront(
+        const RayIntersector &       intersector,
+        Sampler &                    sampler,
+        std::span<const PixelSample> samples,
+        int                          maxBounces,
+        bool                         enableDirectLighting,
+        bool                         enableRussianRoulette,
+        bool                         enableNextEventEstimation,
+        float                        skyLightIntensity,
+        const glm::vec3 &            skyLightColor,
+        std::span<glm::vec3>         radiance,
+        bool                         sortRays) {
+        std::size_t const n = samples.size();
+
+        std::vector<Ray>           rays(n);
+        std::vector<glm::vec3>     throughput(n, glm::vec3(1.0f));
+        std::vector<std::uint32_t> active(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            rays[i]     = samples[i].CameraRay;
+            radiance[i] = glm::vec3(0.0f);
+            active[i]   = std::uint32_t(i);
+        }
+
+        std::vector<std::uint64_t> keys;
+        std::vector<Ray>           sortedRays;
+        std::vector<RayHit>        hits;
+        std::vector<Ray>           shadowRays;
+        std::vector<float>         shadowDistances;
+        std::vector<glm::vec3>     directLight;
+        bool const                 sampleLights = enableDirectLighting && enableNextEventEstimation;
+        std::size_t                numRays      = 0;
+        for (int bounce = 0; bounce <= maxBounces && ! active.empty(); ++bounce) {
+            std::size_t const count = active.size();
+
+            // 本次反弹的光线排序后成包求交, 再按同样的顺序着色
+            if (sortRays) SortRays(rays, active, keys);
+            sortedRays.resize(count);
+            hits.resize(count);
+            for (std::size_t k = 0; k < count; ++k) sortedRays[k] = rays[active[k]];
+            intersector.IntersectPacket(sortedRays, hits);
+            numRays += count;
+
+            // 各顶点的光源样本, 阴影光线同样按此顺序成包做遮挡测试; 未命中或没有贡献的样本不参与
+            if (sampleLights) {
+                shadowRays.resize(count);
+                shadowDistances.assign(count, 0.0f);
+                directLight.assign(count, glm::vec3(0.0f));
+                for (std::size_t k = 0; k < count; ++k) {
+                    if (! hits[k].IntersectState) continue;
+                    const Ray & ray = sortedRays[k];
+                    sampler.StartPixelSample(samples[active[k]].Pixel, samples[active[k]].SampleIndex);
+                    const glm::vec3         normal = FacingNormal(hits[k], ray);
+                    const BRDF              brdf   = CreateBRDFFromMaterial(hits[k].IntersectAlbedo, hits[k].IntersectMetaSpec);
+                    const DirectLightSample sample = SampleLight(*intersector.InternalScene, hits[k], normal, brdf, -ray.Direction, sampler.Get1D(SampleDim::Bounce(bounce, SampleDim::Light)));
+                    shadowRays[k]                  = sample.ShadowRay;
+                    directLight[k]                 = sample.Radiance;
+                    if (sample.Radiance != glm::vec3(0.0f)) shadowDistances[k] = sample.MaxDistance;
+                }
+                for (std::size_t first = 0; first < count; first += RayIntersector::c_MaxPacketSize) {
+                    std::size_t const size     = std::min(RayIntersector::c_MaxPacketSize, count - first);
+                    std::uint32_t     occluded = intersector.OccludedPacket(std::span(shadowRays).subspan(first, size), std::span(shadowDistances).subspan(first, size));
+                    for (; occluded; occluded &= occluded - 1) directLight[first + std::countr_zero(occluded)] = glm::vec3(0.0f);
                 }
+            }
 
-                // 累积并平均
-                glm::vec3 newSample   = accumulatedColor / float(samplesPerPixel);
-                glm::vec3 oldColor    = _accumulator.At(x, y);
-                glm::vec3 newColor    = (oldColor * float(_sampleCount - 1) + newSample) / float(_sampleCount);
-                _accumulator.At(x, y) = newColor;
-                _buffer.At(x, y)      = glm::pow(newColor, glm::vec3(1.0f / 2.2f));
+            std::size_t alive = 0;
+            for (std::size_t k = 0; k < count; ++k) {
+                std::uint32_t const i = active[k];
+                sampler.StartPixelSample(samples[i].Pixel, samples[i].SampleIndex);
+                if (ShadePathVertex(intersector, sampler, hits[k], bounce, enableDirectLighting, enableRussianRoulette, enableNextEventEstimation, skyLightIntensity, skyLightColor, sampleLights ? &directLight[k] : nullptr, rays[i], throughput[i], radiance[i])) {
+                    active[alive++] = i;
+                }
             }
+            active.resize(alive);
         }
+        return numRays;
     }
 
 } // namespace VCX::Labs::Rendering
\ No newline at end of file
@@ -2,25 +2,20 @@
 #pragma once
 
 #include "Engine/Scene.h"
-#include "Labs/Common/ImageRGB.h"
 #include "Labs/final_hw/Ray.h"
+#include "Labs/final_hw/Sampler.h"
 #include "Labs/final_hw/tasks.h"
+#include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
-#include <random>
+#include <span>
+#include <vector>
 namespace VCX::Labs::Rendering {
 
-    // 线程局部随机数生成器
-    thread_local extern std::mt19937                          RandomGenerator;
-    thread_local extern std::uniform_real_distribution<float> RandomDistribution;
-
-    inline float RandomFloat() {
-        return RandomDistribution(RandomGenerator);
-    }
-
-    // 采样函数
-    glm::vec3 SampleHemisphereUniform(const glm::vec3 & normal);
-    glm::vec3 SampleHemisphereCosine(const glm::vec3 & normal);
-    glm::vec3 SampleHemisphereImportance(const glm::vec3 & normal, float roughness);
+    // 采样函数, u 为 [0,1)^2 内的二维样本
+    glm::vec3 SampleHemisphereUniform(const glm::vec3 & normal, const glm::vec2 & u);
+    glm::vec3 SampleHemisphereCosine(const glm::vec3 & normal, const glm::vec2 & u);
+    glm::vec3 SampleHemisphereImportance(const glm::vec3 & normal, float roughness, const glm::vec2 & u);
 
     // BRDF结构
     struct BRDF {
@@ -33,8 +28,8 @@ namespace VCX::Labs::Rendering {
         // 评估BRDF
         glm::vec3 Evaluate(const glm::vec3 & wi, const glm::vec3 & wo, const glm::vec3 & normal) const;
 
-        // 重要性采样
-        glm::vec3 Sample(const glm::vec3 & wo, const glm::vec3 & normal, float & pdf) const;
+        // 重要性采样, uLobe 选择漫反射/镜面分支, u 采样方向
+        glm::vec3 Sample(const glm::vec3 & wo, const glm::vec3 & normal, float uLobe, const glm::vec2 & u, float & pdf) const;
 
         // 计算采样PDF
         float PDF(const glm::vec3 & wi, const glm::vec3 & wo, const glm::vec3 & normal) const;
@@ -52,13 +47,30 @@ namespace VCX::Labs::Rendering {
     // 从场景材质创建BRDF
     BRDF CreateBRDFFromMaterial(const glm::vec4 & albedo, const glm::vec4 & metaSpec);
 
+    // 一个光源样本: 阴影光线未被遮挡时的直接光照贡献; Radiance 为 0 时不必追踪阴影光线
+    struct DirectLightSample {
+        Ray       ShadowRay;
+        float     MaxDistance = 0.0f;
+        glm::vec3 Radiance { 0.0f };
+    };
+
+    // 选择光源并构造阴影光线, 不做遮挡测试; 阴影光线的起点按 hit 的误差上界偏移, 不会与 hit 所在的表面自交
+    DirectLightSample SampleLight(
+        const Engine::Scene & scene,
+        const RayHit &        hit,
+        const glm::vec3 &     normal,
+        const BRDF &          brdf,
+        const glm::vec3 &     wo,
+        float                 uLight);
+
     // 直接光照采样 (Next Event Estimation)
     glm::vec3 SampleDirectLighting(
         const RayIntersector & intersector,
-        const glm::vec3 &      position,
+        const RayHit &         hit,
         const glm::vec3 &      normal,
         const BRDF &           brdf,
-        const glm::vec3 &      wo);
+        const glm::vec3 &      wo,
+        float                  uLight);
 
     // 环境光采样 (天空光)
     glm::vec3 SampleEnvironmentLight(
@@ -66,49 +78,79 @@ namespace VCX::Labs::Rendering {
         float             intensity,
         const glm::vec3 & color);
 
-    // Path Tracing核心函数
+    // 路径的一个顶点: 对第 bounce 次求交的结果 rayHit 累加天空光或自发光与直接光照, 采样下一个方向并把 ray 换成下一段光线,
+    // 返回路径是否继续; 给出 directLight 时使用其中已做过遮挡测试的直接光照
+    bool ShadePathVertex(
+        const RayIntersector & intersector,
+        const Sampler &        sampler,
+        const RayHit &         rayHit,
+        int                    bounce,
+        bool                   enableDirectLighting,
+        bool                   enableRussianRoulette,
+        bool                   enableNextEventEstimation,
+        float                  skyLightIntensity,
+        const glm::vec3 &      skyLightColor,
+        const glm::vec3 *      directLight,
+        Ray &                  ray,
+        glm::vec3 &            throughput,
+        glm::vec3 &            radiance);
+
+    // Path Tracing核心函数, 随机数按 SampleDim 的维度分配从 sampler 中读取;
+    // 给出 primaryHit 时第一次求交直接使用其中的结果
     glm::vec3 PathTrace(
         const RayIntersector & intersector,
+        const Sampler &        sampler,
         Ray                    ray,
         int                    maxBounces,
         bool                   enableDirectLighting,
         bool                   enableRussianRoulette,
         bool                   enableNextEventEstimation,
         float                  skyLightIntensity,
-        const glm::vec3 &      skyLightColor);
-
-    // 渐进式Path Tracing (用于交互式渲染)
-    class ProgressivePathTracer {
-    public:
-        ProgressivePathTracer(int width, int height);
-
-        // 渲染一帧
-        void RenderFrame(
-            const RayIntersector & intersector,
-            const Engine::Camera & camera,
-            int                    samplesPerPixel,
-            int                    maxBounces,
-            bool                   enableDirectLighting,
-            bool                   enableRussianRoulette,
-            bool                   enableNextEventEstimation,
-            float                  skyLightIntensity,
-            const glm::vec3 &      skyLightColor);
-
-        // 获取当前渲染结果
-        const Common::ImageRGB & GetBuffer() const { return _buffer; }
-
-        // 重置渲染
-        void Reset() { _sampleCount = 0; }
-
-        // 获取样本数
-        int GetSampleCount() const { return _sampleCount; }
-
-    private:
-        Common::ImageRGB _buffer;
-        Common::ImageRGB _accumulator;
-        int              _width;
-        int              _height;
-        int              _sampleCount;
+        const glm::vec3 &      skyLightColor,
+        const RayHit *         primaryHit = nullptr);
+
+    // 一个像素样本: 相机光线与着色前交给 Sampler::StartPixelSample 的像素和样本序号
+    struct PixelSample {
+        Ray           CameraRay;
+        std::uint64_t Pixel;
+        std::uint32_t SampleIndex;
     };
 
+    // 光线包版本: 一组相干的相机光线 (如一个像素块) 成包求交, 阴影光线与之后的反弹逐条追踪.
+    // 着色每个样本前为其调用 sampler.StartPixelSample, 结果与逐条调用 PathTrace 相同
+    void PathTracePacket(
+        const RayIntersector &       intersector,
+        Sampler &                    sampler,
+        std::span<const PixelSample> samples,
+        int                          maxBounces,
+        bool                         enableDirectLighting,
+        bool                         enableRussianRoulette,
+        bool                         enableNextEventEstimation,
+        float                        skyLightIntensity,
+        const glm::vec3 &            skyLightColor,
+        std::span<glm::vec3>         radiance);
+
+    // 每次调用波前模式的样本数上限, 调用者按此把一个图块的样本分批, 使一波的光线与交点数组留在 L2 中
+    inline constexpr std::size_t c_WavefrontSize = 4096;
+
+    // 波前模式每次反弹的光线顺序: 按方向所在的卦限与起点在这些光线起点范围内的 Morton 码给 active 中的路径排序, keys 为临时存储
+    void SortRays(std::span<const Ray> rays, std::vector<std::uint32_t> & active, std::vector<std::uint64_t> & keys);
+
+    // 波前模式: 所有样本的路径一起推进, 每次反弹把仍存活的光线按方向卦限与起点的 Morton 码排序, 按此顺序成包求交,
+    // 阴影光线同样成包做遮挡测试, 使相邻追踪的光线访问相近的节点与三角形. 着色前重新为该路径调用 StartPixelSample,
+    // 结果与逐条调用 PathTrace 相同; 返回追踪的最近交点光线数 (不含阴影光线). sortRays 为 false 时按路径序号追踪,
+    // 只用于衡量排序的效果
+    std::size_t PathTraceWavefront(
+        const RayIntersector &       intersector,
+        Sampler &                    sampler,
+        std::span<const PixelSample> samples,
+        int                          maxBounces,
+        bool                         enableDirectLighting,
+        bool                         enableRussianRoulette,
+        bool                         enableNextEventEstimation,
+        float                        skyLightIntensity,
+        const glm::vec3 &            skyLightColor,
+        std::span<glm::vec3>         radiance,
+        bool                         sortRays = true);
+
 } // namespace VCX::Labs::Rendering
\ No newline at end of file
@@ -0,0 +1,50 @@
+// Random.h
+#pragma once
+
+#include <cstdint>
+
+namespace VCX::Labs::Rendering {
+
+    // PCG32 随机数生成器 (PCG-XSH-RR), 状态仅 16 字节
+    class PCG32 {
+    public:
+        PCG32() { Seed(0x853c49e6748fea9bull, 0xda3e39cb94b95bdbull); }
+
+        PCG32(std::uint64_t const seed, std::uint64_t const sequence) { Seed(seed, sequence); }
+
+        // sequence 选择独立的随机数流, seed 决定流中的起点
+        void Seed(std::uint64_t const seed, std::uint64_t const sequence) {
+            _state = 0;
+            _inc   = (sequence << 1u) | 1u;
+            NextUInt();
+            _state += seed;
+            NextUInt();
+        }
+
+        std::uint32_t NextUInt() {
+            std::uint64_t const old        = _state;
+            _state                         = old * 6364136223846793005ull + _inc;
+            std::uint32_t const xorshifted = std::uint32_t(((old >> 18u) ^ old) >> 27u);
+            std::uint32_t const rot        = std::uint32_t(old >> 59u);
+            return (xorshifted >> rot) | (xorshifted << ((~rot + 1u) & 31u));
+        }
+
+        // [0, 1) 内的均匀浮点数, 取高 24 位保证不会得到 1
+        float NextFloat() { return float(NextUInt() >> 8) * 0x1p-24f; }
+
+    private:
+        std::uint64_t _state;
+        std::uint64_t _inc;
+    };
+
+    // SplitMix64 的混合函数, 将相邻的整数映射为互不相关的 64 位值
+    inline std::uint64_t MixBits(std::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebull;
+        x ^= x >> 31;
+        return x;
+    }
+
+} // namespace VCX::Labs::Rendering
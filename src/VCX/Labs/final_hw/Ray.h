@@ -7,8 +7,14 @@ namespace VCX::Labs::Rendering {
     struct Ray {
         glm::vec3 Origin { 0, 0, 0 };
         glm::vec3 Direction { 0, 0, 0 };
+        // isotropic ray differential (ray cone): footprint width at the origin and its growth per unit distance,
+        // used to pick texture mip levels at hits. Both zero means the hit is not filtered.
+        float ConeWidth  = 0;
+        float ConeSpread = 0;
         Ray() = default;
         Ray(const glm::vec3 & orig, const glm::vec3 & dir):
             Origin { orig }, Direction { dir } {}
+        Ray(const glm::vec3 & orig, const glm::vec3 & dir, float coneWidth, float coneSpread):
+            Origin { orig }, Direction { dir }, ConeWidth { coneWidth }, ConeSpread { coneSpread } {}
     };
 } // namespace VCX::Labs::Rendering
@@ -0,0 +1,154 @@
+// Sampler.cpp
+#include "Labs/final_hw/Sampler.h"
+#include "Labs/final_hw/Random.h"
+#include <algorithm>
+#include <cmath>
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        // 由高 24 位得到 [0, 1) 内的浮点数
+        float ToUnitFloat(std::uint32_t const x) {
+            return float(x >> 8) * 0x1p-24f;
+        }
+
+        std::uint32_t ReverseBits(std::uint32_t x) {
+            x = (x << 16) | (x >> 16);
+            x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+            x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+            x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+            x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+            return x;
+        }
+
+        // Sobol 序列第 0 维 (van der Corput) 与第 1 维, 均以 32 位定点数表示
+        std::uint32_t Sobol0(std::uint32_t const index) {
+            return ReverseBits(index);
+        }
+
+        std::uint32_t Sobol1(std::uint32_t index) {
+            std::uint32_t result = 0;
+            for (std::uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1)
+                if (index & 1u) result ^= v;
+            return result;
+        }
+
+        // Laine-Karras 置换: 作用于位反转后的值时等价于嵌套均匀 (Owen) 扰乱
+        std::uint32_t LaineKarrasPermutation(std::uint32_t x, std::uint32_t const seed) {
+            x += seed;
+            x ^= x * 0x6c50b47cu;
+            x ^= x * 0xb82f1e52u;
+            x ^= x * 0xc7afe638u;
+            x ^= x * 0x8d22f6e6u;
+            return x;
+        }
+
+        std::uint32_t OwenScramble(std::uint32_t const x, std::uint32_t const seed) {
+            return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+        }
+
+        // Kensler 的无存储随机置换: 返回 [0, n) 的第 seed 个置换中 i 的像
+        std::uint32_t PermutationElement(std::uint32_t i, std::uint32_t const n, std::uint32_t const seed) {
+            std::uint32_t w = n - 1;
+            w |= w >> 1;
+            w |= w >> 2;
+            w |= w >> 4;
+            w |= w >> 8;
+            w |= w >> 16;
+            do {
+                i ^= seed;
+                i *= 0xe170893du;
+                i ^= seed >> 16;
+                i ^= (i & w) >> 4;
+                i ^= seed >> 8;
+                i *= 0x0929eb3fu;
+                i ^= seed >> 23;
+                i ^= (i & w) >> 1;
+                i *= 1u | seed >> 27;
+                i *= 0x6935fa69u;
+                i ^= (i & w) >> 11;
+                i *= 0x74dcb303u;
+                i ^= (i & w) >> 2;
+                i *= 0x9e501cc3u;
+                i ^= (i & w) >> 2;
+                i *= 0xc860a3dfu;
+                i &= w;
+                i ^= i >> 5;
+            } while (i >= n);
+            return (i + seed) % n;
+        }
+    } // namespace
+
+    std::uint64_t Sampler::Hash(std::uint32_t const dim) const {
+        return MixBits(MixBits(MixBits(_pixel) ^ _seed) + dim);
+    }
+
+    float IndependentSampler::Get1D(std::uint32_t const dim) const {
+        return PCG32(Hash(dim), _sampleIndex).NextFloat();
+    }
+
+    glm::vec2 IndependentSampler::Get2D(std::uint32_t const dim) const {
+        PCG32 rng(Hash(dim), _sampleIndex);
+        float const u = rng.NextFloat();
+        return { u, rng.NextFloat() };
+    }
+
+    float StratifiedSampler::Get1D(std::uint32_t const dim) const {
+        std::uint64_t const hash    = Hash(dim);
+        std::uint32_t const n       = std::max(_samplesPerPixel, 1u);
+        std::uint32_t const stratum = PermutationElement(_sampleIndex % n, n, std::uint32_t(hash));
+        float const         jitter  = PCG32(hash, _sampleIndex).NextFloat();
+        return glm::min((stratum + jitter) / n, 0x1.fffffep-1f);
+    }
+
+    glm::vec2 StratifiedSampler::Get2D(std::uint32_t const dim) const {
+        // 尽量接近正方形的 nx * ny 网格, 多出的样本退化为在整个网格上的随机层
+        std::uint64_t const hash    = Hash(dim);
+        std::uint32_t const n       = std::max(_samplesPerPixel, 1u);
+        std::uint32_t const nx      = std::max(1u, std::uint32_t(std::sqrt(float(n))));
+        std::uint32_t const ny      = n / nx;
+        std::uint32_t const cells   = nx * ny;
+        std::uint32_t const stratum = PermutationElement(_sampleIndex % cells, cells, std::uint32_t(hash));
+        PCG32               rng(hash, _sampleIndex);
+        float const         jx = rng.NextFloat();
+        float const         jy = rng.NextFloat();
+        if (_sampleIndex % n >= cells) return { jx, jy };
+        return {
+            glm::min((stratum % nx + jx) / nx, 0x1.fffffep-1f),
+            glm::min((stratum / nx + jy) / ny, 0x1.fffffep-1f),
+        };
+    }
+
+    float SobolSampler::Get1D(std::uint32_t const dim) const {
+        std::uint64_t const hash  = Hash(dim);
+        std::uint32_t const index = OwenScramble(_sampleIndex, std::uint32_t(hash));
+        return ToUnitFloat(OwenScramble(Sobol0(index), std::uint32_t(hash >> 32)));
+    }
+
+    glm::vec2 SobolSampler::Get2D(std::uint32_t const dim) const {
+        std::uint64_t const hash  = Hash(dim);
+        std::uint32_t const index = OwenScramble(_sampleIndex, std::uint32_t(hash));
+        std::uint64_t const seeds = MixBits(hash);
+        return {
+            ToUnitFloat(OwenScramble(Sobol0(index), std::uint32_t(seeds))),
+            ToUnitFloat(OwenScramble(Sobol1(index), std::uint32_t(seeds >> 32))),
+        };
+    }
+
+    std::unique_ptr<Sampler> CreateSampler(SamplerType const type, std::uint32_t const samplesPerPixel, std::uint64_t const seed) {
+        switch (type) {
+        case SamplerType::Stratified: return std::make_unique<StratifiedSampler>(samplesPerPixel, seed);
+        case SamplerType::Sobol: return std::make_unique<SobolSampler>(samplesPerPixel, seed);
+        default: return std::make_unique<IndependentSampler>(samplesPerPixel, seed);
+        }
+    }
+
+    char const * GetSamplerName(SamplerType const type) {
+        switch (type) {
+        case SamplerType::Stratified: return "Stratified";
+        case SamplerType::Sobol: return "Sobol (Owen)";
+        default: return "Independent";
+        }
+    }
+
+} // namespace VCX::Labs::Rendering
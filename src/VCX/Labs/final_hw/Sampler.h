@@ -0,0 +1,90 @@
+// Sampler.h
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/glm.hpp>
+
+namespace VCX::Labs::Rendering {
+
+    enum class SamplerType {
+        Independent, // 独立均匀随机数
+        Stratified,  // 每个维度独立分层抖动
+        Sobol,       // 逐维度 Owen 扰乱的 Sobol 序列
+    };
+
+    // 采样维度的显式分配: 相机占 2 维, 之后每次反弹占 c_DimsPerBounce 维,
+    // 同一维度在同一像素的所有样本之间构成低差异点集
+    namespace SampleDim {
+        constexpr std::uint32_t Camera          = 0; // 2D 像素内抖动
+        constexpr std::uint32_t BounceBase      = 2;
+        constexpr std::uint32_t Light           = 0; // 1D 光源选择
+        constexpr std::uint32_t Lobe            = 1; // 1D BRDF 分支选择
+        constexpr std::uint32_t Direction       = 2; // 2D BRDF 方向采样
+        constexpr std::uint32_t Roulette        = 4; // 1D 俄罗斯轮盘赌
+        constexpr std::uint32_t c_DimsPerBounce = 5;
+
+        constexpr std::uint32_t Bounce(int const bounce, std::uint32_t const offset) {
+            return BounceBase + std::uint32_t(bounce) * c_DimsPerBounce + offset;
+        }
+    } // namespace SampleDim
+
+    // 可替换的采样器接口. 每个像素样本由 (像素, 样本序号) 确定, 各维度的取值与调用顺序无关,
+    // 因此相同设置下的渲染结果与线程调度无关
+    class Sampler {
+    public:
+        // samplesPerPixel: 每像素的样本总数 (分层采样据此划分网格); seed: 额外的随机种子, 例如帧序号
+        Sampler(std::uint32_t const samplesPerPixel, std::uint64_t const seed): _samplesPerPixel(samplesPerPixel), _seed(seed) { }
+        virtual ~Sampler() = default;
+
+        void StartPixelSample(std::uint64_t const pixel, std::uint32_t const sampleIndex) {
+            _pixel       = pixel;
+            _sampleIndex = sampleIndex;
+        }
+
+        virtual float     Get1D(std::uint32_t dim) const = 0;
+        virtual glm::vec2 Get2D(std::uint32_t dim) const = 0;
+
+    protected:
+        // 由像素, 种子和维度得到的哈希值, 用于各维度的独立扰乱
+        std::uint64_t Hash(std::uint32_t dim) const;
+
+        std::uint32_t _samplesPerPixel;
+        std::uint64_t _seed;
+        std::uint64_t _pixel       = 0;
+        std::uint32_t _sampleIndex = 0;
+    };
+
+    class IndependentSampler : public Sampler {
+    public:
+        using Sampler::Sampler;
+
+        float     Get1D(std::uint32_t dim) const override;
+        glm::vec2 Get2D(std::uint32_t dim) const override;
+    };
+
+    // 每个维度把 [0,1) (或 [0,1)^2) 划分为 samplesPerPixel 个层, 样本按维度独立打乱后落入各层
+    class StratifiedSampler : public Sampler {
+    public:
+        using Sampler::Sampler;
+
+        float     Get1D(std::uint32_t dim) const override;
+        glm::vec2 Get2D(std::uint32_t dim) const override;
+    };
+
+    // 以 Sobol 序列的前两维为基础, 每个维度使用独立的 Owen 扰乱和样本序号打乱 (padded Sobol),
+    // 样本数为 2 的幂时效果最好
+    class SobolSampler : public Sampler {
+    public:
+        using Sampler::Sampler;
+
+        float     Get1D(std::uint32_t dim) const override;
+        glm::vec2 Get2D(std::uint32_t dim) const override;
+    };
+
+    std::unique_ptr<Sampler> CreateSampler(SamplerType type, std::uint32_t samplesPerPixel, std::uint64_t seed = 0);
+
+    char const * GetSamplerName(SamplerType type);
+
+} // namespace VCX::Labs::Rendering
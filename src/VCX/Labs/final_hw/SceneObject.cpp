@@ -47,11 +47,6 @@ namespace VCX::Labs::Rendering {
         return item;
     }
 
-    ModelObject::ModelObject(Engine::Model const & model) :
-        Mesh(MakeRenderItem(model.Mesh)), 
-        MaterialIndex(model.MaterialIndex) {
-    }
-
     void SceneObject::ReplaceScene(Engine::Scene const & scene) {
         Reflection       = scene.Reflection;
         AmbientIntensity = scene.AmbientIntensity;
@@ -94,14 +89,30 @@ namespace VCX::Labs::Rendering {
         for (auto const & material : scene.Materials)
             Materials.push_back(MaterialObject(material));
         
+        Meshes.clear();
+        for (auto const & mesh : scene.Meshes)
+            Meshes.push_back(MakeRenderItem(mesh));
+
         OpaqueModels.clear();
         TransparentModels.clear();
-        for (auto const & model : scene.Models) {
+        for (std::size_t i = 0; i < scene.Models.size(); ++i) {
+            auto const & model  = scene.Models[i];
+            auto         object = ModelObject {
+                .ModelIndex    = std::uint32_t(i),
+                .MeshIndex     = model.MeshIndex,
+                .Transform     = model.Transform,
+                .MaterialIndex = model.MaterialIndex,
+            };
+            if (model.MeshIndex == Engine::Model::c_NoMesh) {
+                object.MeshIndex = std::uint32_t(Meshes.size());
+                object.Transform = glm::mat4(1);
+                Meshes.push_back(MakeRenderItem(model.Mesh));
+            }
             auto const blend = scene.Materials[model.MaterialIndex].Blend;
             if (blend == Engine::BlendMode::Opaque) {
-                OpaqueModels.push_back(ModelObject(model));
+                OpaqueModels.push_back(object);
             } else if (blend == Engine::BlendMode::Transparent) {
-                TransparentModels.push_back(ModelObject(model));
+                TransparentModels.push_back(object);
             }
         }
 
@@ -114,4 +125,10 @@ namespace VCX::Labs::Rendering {
         passConstants.CntDirectionalLights = int(std::min(CntDirectionalLights,  c_MaxCntLights - passConstants.CntPointLights - passConstants.CntSpotLights));
         PassConstantsBlock.Update(passConstants);
     }
+
+    void SceneObject::SetModelTransform(std::uint32_t const modelIdx, glm::mat4 const & transform) {
+        for (auto * models : { &OpaqueModels, &TransparentModels })
+            for (auto & model : *models)
+                if (model.ModelIndex == modelIdx) model.Transform = transform;
+    }
 } // namespace VCX::Labs::Rendering
\ No newline at end of file
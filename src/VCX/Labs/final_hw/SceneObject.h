@@ -22,11 +22,12 @@ namespace VCX::Labs::Rendering {
         explicit MaterialObject(Engine::Material const & material);
     };
 
+    // 一个模型画作 SceneObject::Meshes[MeshIndex] 经 Transform 变换; 共享同一网格文件的模型共用一份顶点缓冲
     struct ModelObject {
-        Engine::GL::UniqueIndexedRenderItem Mesh;
-        std::uint32_t                       MaterialIndex;
-
-        explicit ModelObject(Engine::Model const & model);
+        std::uint32_t ModelIndex; // Scene::Models 的下标
+        std::uint32_t MeshIndex;
+        glm::mat4     Transform;
+        std::uint32_t MaterialIndex;
     };
 
     struct SceneObject {
@@ -64,6 +65,9 @@ namespace VCX::Labs::Rendering {
 
         std::vector<MaterialObject>  Materials;
 
+        // 前 Scene::Meshes.size() 个与 Scene::Meshes 一一对应 (物体空间), 其后为没有共享网格的模型各自的网格 (世界空间)
+        std::vector<Engine::GL::UniqueIndexedRenderItem> Meshes;
+
         std::vector<ModelObject>     OpaqueModels;
         std::vector<ModelObject>     TransparentModels;
 
@@ -72,5 +76,8 @@ namespace VCX::Labs::Rendering {
         SceneObject(int const bindingPoint) : PassConstantsBlock(bindingPoint, Engine::GL::DrawFrequency::Stream) { }
 
         void ReplaceScene(Engine::Scene const & scene);
+
+        // 以 transform 代替模型 modelIdx 原来的变换绘制
+        void SetModelTransform(std::uint32_t modelIdx, glm::mat4 const & transform);
     };
 } // namespace VCX::Labs::Rendering
\ No newline at end of file
@@ -0,0 +1,74 @@
+// SceneSnapshot.cpp
+#include "Labs/final_hw/SceneSnapshot.h"
+
+namespace VCX::Labs::Rendering {
+
+    void SceneSnapshot::Build(Engine::Scene const & scene) {
+        _meshes.clear();
+        _computedNormals.clear();
+        _meshes.reserve(scene.Meshes.size() + scene.Models.size());
+
+        // 先建好全部材质, 之后 _materials 不再扩容, 实例可以直接保存指针
+        _materials.assign(scene.Materials.size(), MaterialSnapshot {});
+        for (std::size_t i = 0; i < scene.Materials.size(); ++i) {
+            _materials[i].Blend = scene.Materials[i].Blend;
+            _materials[i].Albedo.Build(scene.Materials[i].Albedo, true);
+            _materials[i].MetaSpec.Build(scene.Materials[i].MetaSpec, false);
+        }
+
+        for (auto const & mesh : scene.Meshes) AddMesh(mesh);
+
+        _instances.assign(scene.Models.size(), InstanceSnapshot {});
+        for (std::size_t i = 0; i < scene.Models.size(); ++i) {
+            auto const & model    = scene.Models[i];
+            auto &       instance = _instances[i];
+            if (model.MeshIndex < scene.Meshes.size()) {
+                instance.Mesh = model.MeshIndex;
+            } else {
+                instance.Mesh = std::uint32_t(_meshes.size());
+                AddMesh(model.Mesh);
+            }
+            instance.Material = &_materials[model.MaterialIndex];
+            instance.MinAlpha = instance.Material->Albedo.GetMinAlpha();
+        }
+        UpdateTransforms(scene);
+    }
+
+    void SceneSnapshot::UpdateTransforms(Engine::Scene const & scene) {
+        for (std::size_t i = 0; i < scene.Models.size(); ++i) {
+            auto const & model = scene.Models[i];
+            // 没有共享网格的模型已经在世界空间中
+            SetTransform(std::uint32_t(i), model.MeshIndex < scene.Meshes.size() ? model.Transform : glm::mat4(1.0f));
+        }
+    }
+
+    void SceneSnapshot::SetTransform(std::uint32_t const modelIdx, glm::mat4 const & transform) {
+        auto & instance        = _instances[modelIdx];
+        instance.Identity      = transform == glm::mat4(1.0f);
+        instance.ObjectToWorld = transform;
+        instance.WorldToObject = glm::inverse(transform);
+        instance.NormalToWorld = glm::transpose(glm::inverse(glm::mat3(transform)));
+    }
+
+    void SceneSnapshot::UpdateMesh(std::uint32_t const meshIdx) {
+        auto &       snapshot = _meshes[meshIdx];
+        auto const & mesh     = *snapshot.Source;
+        snapshot.Positions    = mesh.Positions.data();
+        snapshot.Indices      = mesh.Indices.data();
+        if (mesh.IsNormalAvailable()) {
+            snapshot.Normals = mesh.Normals.data();
+        } else {
+            // 移动 vector 不会改变其缓冲区地址, 指针在 _computedNormals 扩容后仍然有效
+            _computedNormals[meshIdx] = mesh.ComputeNormals();
+            snapshot.Normals          = _computedNormals[meshIdx].data();
+        }
+        snapshot.TexCoords = mesh.IsTexCoordAvailable() ? mesh.TexCoords.data() : nullptr;
+    }
+
+    void SceneSnapshot::AddMesh(Engine::SurfaceMesh const & mesh) {
+        _meshes.push_back({ .Source = &mesh });
+        _computedNormals.emplace_back();
+        UpdateMesh(std::uint32_t(_meshes.size() - 1));
+    }
+
+} // namespace VCX::Labs::Rendering
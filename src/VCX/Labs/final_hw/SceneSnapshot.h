@@ -0,0 +1,73 @@
+// SceneSnapshot.h
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Engine/Scene.h"
+#include "Labs/final_hw/ShadingTexture.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 着色用的材质: 纹理已转换为线性空间的 ShadingTexture
+    struct MaterialSnapshot {
+        Engine::BlendMode Blend = Engine::BlendMode::Opaque;
+        ShadingTexture    Albedo;
+        ShadingTexture    MetaSpec;
+    };
+
+    // 一份网格几何 (物体空间) 的着色数据, 指针指向原网格或快照中补全的数据
+    struct MeshSnapshot {
+        Engine::SurfaceMesh const * Source    = nullptr; // 原网格, 用于构建底层 BVH
+        glm::vec3 const *           Positions = nullptr;
+        glm::vec3 const *           Normals   = nullptr;
+        glm::vec2 const *           TexCoords = nullptr; // 为空表示网格没有纹理坐标, 统一取 (0.5, 0.5)
+        std::uint32_t const *       Indices   = nullptr;
+    };
+
+    // 单个模型 (网格几何的一个实例) 的着色数据
+    struct InstanceSnapshot {
+        std::uint32_t            Mesh     = 0; // 网格几何的下标
+        MaterialSnapshot const * Material = nullptr;
+        float                    MinAlpha = 1.0f; // 反照率纹理 alpha 通道的最小值, 用于跳过阴影光线的透明度测试
+        bool                     Identity = true; // 物体空间即世界空间, 求交与着色都不必变换
+        glm::mat4                ObjectToWorld { 1 };
+        glm::mat4                WorldToObject { 1 };
+        glm::mat3                NormalToWorld { 1 }; // ObjectToWorld 线性部分的逆转置
+    };
+
+    // 求交器一侧的场景快照: 在 InitScene 时一次性补全法线, 转换材质纹理并解析材质引用,
+    // 命中后的着色只需读取三角形的三个顶点.
+    // 网格几何在前 Scene::Meshes.size() 个位置与 Scene::Meshes 一一对应, 被多个模型共享;
+    // 没有共享网格的模型 (ComplexModels 等) 各自的世界空间网格排在其后
+    class SceneSnapshot {
+    public:
+        void Build(Engine::Scene const & scene);
+
+        // 模型的 Transform 改变后重新读取实例的变换, 网格与材质不变
+        void UpdateTransforms(Engine::Scene const & scene);
+
+        // 直接设置实例 modelIdx 的物体空间到世界空间的变换, 不经过场景; 没有共享网格的模型的网格已在世界空间中,
+        // 其变换作用在世界空间的顶点上
+        void SetTransform(std::uint32_t modelIdx, glm::mat4 const & transform);
+
+        // 原网格的顶点改变 (拓扑不变) 后重新读取网格 meshIdx 的顶点数据, 缺失的法线重新计算
+        void UpdateMesh(std::uint32_t meshIdx);
+
+        InstanceSnapshot const & GetInstance(std::uint32_t const modelIdx) const { return _instances[modelIdx]; }
+        std::size_t              GetInstanceCount() const { return _instances.size(); }
+        MeshSnapshot const &     GetMesh(std::uint32_t const meshIdx) const { return _meshes[meshIdx]; }
+        std::size_t              GetMeshCount() const { return _meshes.size(); }
+
+    private:
+        void AddMesh(Engine::SurfaceMesh const & mesh);
+
+        std::vector<MaterialSnapshot>       _materials;
+        std::vector<MeshSnapshot>           _meshes;
+        std::vector<InstanceSnapshot>       _instances;
+        std::vector<std::vector<glm::vec3>> _computedNormals; // 与 _meshes 一一对应, 原网格缺失法线时计算得到的法线, 否则为空
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,74 @@
+// ShadingTexture.cpp
+#include "Labs/final_hw/ShadingTexture.h"
+#include <array>
+
+namespace VCX::Labs::Rendering {
+
+    void ShadingTexture::Build(Engine::Texture2D<Engine::Formats::RGBA8> const & texture, bool const srgb) {
+        std::size_t const width  = texture.GetSizeX();
+        std::size_t const height = texture.GetSizeY();
+        _constant                = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        _minAlpha                = 1.0f;
+        _levels.clear();
+        _texels.clear();
+
+        // 8 位通道到线性值的查找表, 每个纹素只做查表
+        std::array<float, 256> toLinear;
+        for (int i = 0; i < 256; ++i)
+            toLinear[i] = srgb ? glm::pow(i / 255.0f, 2.2f) : i / 255.0f;
+
+        auto const        raw   = reinterpret_cast<glm::u8vec4 const *>(texture.GetBytes().data());
+        std::size_t const count = width * height;
+        if (count == 0) return;
+
+        bool uniform = true;
+        for (std::size_t i = 0; i < count; ++i) {
+            uniform   = uniform && raw[i] == raw[0];
+            _minAlpha = glm::min(_minAlpha, raw[i].a / 255.0f);
+        }
+        // 只有一行或一列的纹理也只取第一个纹素, 沿用最初逐次采样纹理时的行为
+        if (uniform || width == 1 || height == 1) {
+            glm::vec4 const texel = texture.At(0, 0);
+            _constant = srgb ? glm::vec4(glm::pow(glm::vec3(texel), glm::vec3(2.2f)), texel.a) : texel;
+            return;
+        }
+
+        // 各层的尺寸向上取整减半直到 1x1, 所有层依次存放在 _texels 中
+        std::size_t total = 0;
+        for (std::size_t w = width, h = height;; w = (w + 1) / 2, h = (h + 1) / 2) {
+            Level level;
+            level.Width  = w;
+            level.Height = h;
+            level.TilesX = (w + c_TileSize - 1) >> c_TileShift;
+            level.Offset = total;
+            total += level.TilesX * ((h + c_TileSize - 1) >> c_TileShift) << (2 * c_TileShift);
+            _levels.push_back(level);
+            if (w == 1 && h == 1) break;
+        }
+        _texels.assign(total, glm::u16vec4(0));
+        _levelScale = glm::sqrt(float(width) * float(height));
+
+        // 在浮点线性值上逐层做 2x2 盒式下采样, 奇数边上越界的纹素取边缘值
+        std::vector<glm::vec4> current(count), next;
+        for (std::size_t i = 0; i < count; ++i)
+            current[i] = glm::vec4(toLinear[raw[i].r], toLinear[raw[i].g], toLinear[raw[i].b], raw[i].a / 255.0f);
+        for (std::size_t l = 0; l < _levels.size(); ++l) {
+            auto const & level = _levels[l];
+            for (std::size_t y = 0; y < level.Height; ++y)
+                for (std::size_t x = 0; x < level.Width; ++x)
+                    _texels[GetIndex(level, x, y)] = glm::u16vec4(glm::round(current[y * level.Width + x] * 65535.0f));
+            if (l + 1 == _levels.size()) break;
+
+            auto const & child = _levels[l + 1];
+            next.assign(child.Width * child.Height, glm::vec4(0.0f));
+            for (std::size_t y = 0; y < child.Height; ++y)
+                for (std::size_t x = 0; x < child.Width; ++x) {
+                    std::size_t const x0 = 2 * x, x1 = glm::min(2 * x + 1, level.Width - 1);
+                    std::size_t const y0 = 2 * y, y1 = glm::min(2 * y + 1, level.Height - 1);
+                    next[y * child.Width + x] = .25f * (current[y0 * level.Width + x0] + current[y0 * level.Width + x1] + current[y1 * level.Width + x0] + current[y1 * level.Width + x1]);
+                }
+            current.swap(next);
+        }
+    }
+
+} // namespace VCX::Labs::Rendering
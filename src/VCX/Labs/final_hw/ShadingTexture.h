@@ -0,0 +1,83 @@
+// ShadingTexture.h
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Engine/TextureND.hpp"
+
+namespace VCX::Labs::Rendering {
+
+    // CPU 着色用的纹理: 纹素预先转换到线性空间并存为 16 位定点数, 按 4x4 图块排列,
+    // 双线性过滤的四个纹素通常落在同一图块 (两条缓存行) 内.
+    // 构建时生成完整的 mip 金字塔, 按光线锥在纹理空间的足迹在相邻两层间三线性插值.
+    // 所有纹素相同时 (包括 1x1 的纯色材质) 退化为常量, 采样时不访问纹素.
+    class ShadingTexture {
+    public:
+        static constexpr std::size_t c_TileShift = 2;
+        static constexpr std::size_t c_TileSize  = std::size_t(1) << c_TileShift;
+
+        // srgb 为真时 rgb 通道按 2.2 次幂转换到线性空间, alpha 通道保持不变
+        void Build(Engine::Texture2D<Engine::Formats::RGBA8> const & texture, bool srgb);
+
+        bool        IsConstant() const { return _texels.empty(); }
+        glm::vec4   GetConstant() const { return _constant; }
+        float       GetMinAlpha() const { return _minAlpha; }
+        std::size_t GetLevelCount() const { return _levels.size(); }
+        std::size_t GetMemorySize() const { return _texels.size() * sizeof(glm::u16vec4); } // 字节
+
+        // 纹理坐标按重复方式环绕. footprint 为采样足迹在纹理坐标 (uv) 下的宽度,
+        // 不大于零时只在第 0 层做双线性过滤
+        glm::vec4 Sample(glm::vec2 const & uvCoord, float const footprint = 0.0f) const {
+            if (IsConstant()) return _constant;
+            if (! (footprint > 0.0f)) return SampleLevel(_levels[0], uvCoord);
+            float const level = glm::clamp(glm::log2(footprint * _levelScale), 0.0f, float(_levels.size() - 1));
+            auto const  lower = std::size_t(level);
+            float const frac  = level - float(lower);
+            if (frac == 0.0f || lower + 1 == _levels.size()) return SampleLevel(_levels[lower], uvCoord);
+            return glm::mix(SampleLevel(_levels[lower], uvCoord), SampleLevel(_levels[lower + 1], uvCoord), frac);
+        }
+
+    private:
+        struct Level {
+            std::size_t Width  = 0;
+            std::size_t Height = 0;
+            std::size_t TilesX = 0;
+            std::size_t Offset = 0; // 第一个纹素在 _texels 中的下标
+        };
+
+        // 单层的双线性过滤
+        glm::vec4 SampleLevel(Level const & level, glm::vec2 const & uvCoord) const {
+            glm::vec2 const uv   = glm::fract(uvCoord) * glm::vec2(level.Width, level.Height) - .5f;
+            glm::vec2 const base = glm::floor(uv);
+            glm::vec2 const frac = uv - base;
+            // base 只可能落在 [-1, size - 1], 用比较代替取模完成环绕 (NaN 也落到最后一个纹素上)
+            std::size_t const xmin = base.x >= 0.0f ? std::size_t(base.x) : level.Width - 1;
+            std::size_t const ymin = base.y >= 0.0f ? std::size_t(base.y) : level.Height - 1;
+            std::size_t const xmax = xmin + 1 == level.Width ? 0 : xmin + 1;
+            std::size_t const ymax = ymin + 1 == level.Height ? 0 : ymin + 1;
+            return glm::mix(
+                glm::mix(Fetch(level, xmin, ymin), Fetch(level, xmin, ymax), frac.y),
+                glm::mix(Fetch(level, xmax, ymin), Fetch(level, xmax, ymax), frac.y),
+                frac.x);
+        }
+
+        static std::size_t GetIndex(Level const & level, std::size_t const x, std::size_t const y) {
+            std::size_t const tile = (y >> c_TileShift) * level.TilesX + (x >> c_TileShift);
+            return level.Offset + ((tile << (2 * c_TileShift)) | ((y & (c_TileSize - 1)) << c_TileShift) | (x & (c_TileSize - 1)));
+        }
+
+        glm::vec4 Fetch(Level const & level, std::size_t const x, std::size_t const y) const {
+            return glm::vec4(_texels[GetIndex(level, x, y)]) * (1.0f / 65535.0f);
+        }
+
+        std::vector<Level>        _levels;
+        std::vector<glm::u16vec4> _texels;
+        float                     _levelScale = 1.0f; // 第 0 层的平均边长, 足迹乘以它即为覆盖的纹素数
+        glm::vec4                 _constant { 0.0f, 0.0f, 0.0f, 1.0f };
+        float                     _minAlpha = 1.0f;
+    };
+
+} // namespace VCX::Labs::Rendering
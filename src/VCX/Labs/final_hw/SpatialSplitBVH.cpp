@@ -0,0 +1,283 @@
+// SpatialSplitBVH.cpp
+#include "Labs/final_hw/SpatialSplitBVH.h"
+#include <algorithm>
+#include <array>
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        constexpr float c_MinOverlapRatio = 1e-5f; // 物体划分的两个孩子的重叠面积与根的表面积之比超过它时才尝试空间划分 (论文中的 alpha)
+
+        // 三角形的一个引用, 包围盒是三角形被裁剪到某个空间范围内的部分, 总在三角形的包围盒之内
+        struct Reference {
+            AABB          Bounds;
+            std::uint32_t Index;
+        };
+
+        // 划分方案; Bin 为右侧第一个桶的序号, 空间划分的平面即在这个桶的左边界上
+        struct Split {
+            float         Cost = std::numeric_limits<float>::max();
+            int           Axis = -1;
+            int           Bin  = -1;
+            AABB          Left, Right;
+            std::uint32_t LeftCount = 0, RightCount = 0;
+        };
+
+        float OverlapArea(AABB const & a, AABB const & b) {
+            AABB overlap;
+            overlap.Min = glm::max(a.Min, b.Min);
+            overlap.Max = glm::min(a.Max, b.Max);
+            if (overlap.Min.x > overlap.Max.x || overlap.Min.y > overlap.Max.y || overlap.Min.z > overlap.Max.z) return 0.0f;
+            return overlap.SurfaceArea();
+        }
+
+        AABB Merge(AABB a, AABB const & b) {
+            a.Extend(b);
+            return a;
+        }
+
+        class SpatialSplitBuilder {
+        public:
+            SpatialSplitBuilder(
+                Engine::SurfaceMesh const &  mesh,
+                int const                    maxDepth,
+                std::size_t const            budget,
+                float const                  minOverlap,
+                std::vector<BVHNode> &       nodes,
+                std::vector<std::uint32_t> & primitives):
+                _mesh(mesh), _maxDepth(maxDepth), _budget(budget), _minOverlap(minOverlap), _nodes(nodes), _primitives(primitives) {}
+
+            std::uint32_t BuildNode(std::vector<Reference> refs, int const depth) {
+                std::uint32_t const nodeIdx = std::uint32_t(_nodes.size());
+                _nodes.emplace_back();
+
+                AABB bounds, centroidBounds;
+                for (auto const & ref : refs) {
+                    bounds.Extend(ref.Bounds);
+                    centroidBounds.Extend(ref.Bounds.Centroid());
+                }
+                _nodes[nodeIdx].Bounds = bounds;
+
+                std::uint32_t const count    = std::uint32_t(refs.size());
+                auto const          MakeLeaf = [&]() {
+                    _nodes[nodeIdx].Offset = std::uint32_t(_primitives.size());
+                    _nodes[nodeIdx].Count  = count;
+                    for (auto const & ref : refs) _primitives.push_back(ref.Index);
+                    return nodeIdx;
+                };
+                if (count == 1 || depth >= _maxDepth) return MakeLeaf();
+
+                // 物体划分的两个孩子重叠明显时才值得尝试代价高得多的空间划分
+                float const parentArea = glm::max(bounds.SurfaceArea(), std::numeric_limits<float>::min());
+                Split const object     = FindObjectSplit(refs, centroidBounds, parentArea);
+                Split       spatial;
+                if (_budget > 0 && (object.Axis < 0 || OverlapArea(object.Left, object.Right) > _minOverlap))
+                    spatial = FindSpatialSplit(refs, bounds, parentArea);
+
+                float const bestCost = std::min(object.Cost, spatial.Cost);
+                if (object.Axis < 0 && spatial.Axis < 0) return MakeLeaf();
+                if (bestCost >= BVH::c_IntersectCost * count && count <= BVH::c_MaxLeafSize) return MakeLeaf();
+
+                std::vector<Reference> left, right;
+                if (spatial.Cost < object.Cost) PartitionSpatial(refs, spatial, GetPlane(bounds, spatial.Axis, spatial.Bin), left, right);
+                else PartitionObject(refs, object, centroidBounds, left, right);
+                if (left.empty() || right.empty()) {
+                    // 浮点误差导致划分失败时退化为中位数划分; 此时没有引用被复制
+                    refs = left.empty() ? std::move(right) : std::move(left);
+                    glm::vec3 const extent = centroidBounds.Max - centroidBounds.Min;
+                    int const       axis   = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+                    auto const      mid    = refs.begin() + count / 2;
+                    std::nth_element(refs.begin(), mid, refs.end(), [axis](Reference const & a, Reference const & b) {
+                        return a.Bounds.Centroid()[axis] < b.Bounds.Centroid()[axis];
+                    });
+                    left.assign(refs.begin(), mid);
+                    right.assign(mid, refs.end());
+                }
+                refs.clear();
+                refs.shrink_to_fit();
+
+                BuildNode(std::move(left), depth + 1);
+                std::uint32_t const rightIdx = BuildNode(std::move(right), depth + 1);
+                _nodes[nodeIdx].Offset       = rightIdx;
+                _nodes[nodeIdx].Count        = 0;
+                return nodeIdx;
+            }
+
+        private:
+            // 与 BVH::BuildRecursive 相同的分桶 SAH
+            Split FindObjectSplit(std::vector<Reference> const & refs, AABB const & centroidBounds, float const parentArea) const {
+                struct Bin {
+                    AABB          Bounds;
+                    std::uint32_t Count = 0;
+                };
+                Split           best;
+                glm::vec3 const extent = centroidBounds.Max - centroidBounds.Min;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (extent[axis] <= 0.0f) continue;
+                    std::array<Bin, BVH::c_NumBins> bins;
+                    float const                     scale = BVH::c_NumBins / extent[axis];
+                    for (auto const & ref : refs) {
+                        int const b = glm::min(int((ref.Bounds.Centroid()[axis] - centroidBounds.Min[axis]) * scale), BVH::c_NumBins - 1);
+                        bins[b].Count++;
+                        bins[b].Bounds.Extend(ref.Bounds);
+                    }
+                    Sweep(bins, axis, parentArea, best, [](Bin const & bin) { return bin.Count; }, [](Bin const & bin) { return bin.Count; });
+                }
+                return best;
+            }
+
+            // 空间划分: 在节点包围盒上均分桶, 每个引用被裁剪到它跨越的每个桶中; 左侧计入引用起始的桶, 右侧计入引用结束的桶
+            Split FindSpatialSplit(std::vector<Reference> const & refs, AABB const & bounds, float const parentArea) const {
+                struct Bin {
+                    AABB          Bounds;
+                    std::uint32_t Entries = 0, Exits = 0;
+                };
+                Split           best;
+                glm::vec3 const extent = bounds.Max - bounds.Min;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (extent[axis] <= 0.0f) continue;
+                    std::array<Bin, BVH::c_NumBins> bins;
+                    float const                     scale = BVH::c_NumBins / extent[axis];
+                    for (auto const & ref : refs) {
+                        int const first = glm::clamp(int((ref.Bounds.Min[axis] - bounds.Min[axis]) * scale), 0, BVH::c_NumBins - 1);
+                        int const last  = glm::clamp(int((ref.Bounds.Max[axis] - bounds.Min[axis]) * scale), first, BVH::c_NumBins - 1);
+                        Reference rest  = ref;
+                        for (int b = first; b < last; ++b) {
+                            AABB left;
+                            SplitReference(rest, axis, GetPlane(bounds, axis, b + 1), left, rest.Bounds);
+                            bins[b].Bounds.Extend(left);
+                        }
+                        bins[last].Bounds.Extend(rest.Bounds);
+                        bins[first].Entries++;
+                        bins[last].Exits++;
+                    }
+                    Sweep(bins, axis, parentArea, best, [](Bin const & bin) { return bin.Entries; }, [](Bin const & bin) { return bin.Exits; });
+                }
+                return best;
+            }
+
+            // 从两端扫描各个桶, 求左右两侧的包围盒与图元数, 更新代价最小的划分
+            template<typename Bins, typename LeftCount, typename RightCount>
+            static void Sweep(Bins const & bins, int const axis, float const parentArea, Split & best, LeftCount const & leftCount, RightCount const & rightCount) {
+                constexpr int                                 n = BVH::c_NumBins;
+                std::array<AABB, n - 1>                       leftBox;
+                std::array<std::uint32_t, n - 1>              leftN;
+                AABB                                          box;
+                std::uint32_t                                 count = 0;
+                for (int i = 0; i < n - 1; ++i) {
+                    box.Extend(bins[i].Bounds);
+                    count += leftCount(bins[i]);
+                    leftBox[i] = box;
+                    leftN[i]   = count;
+                }
+
+                AABB          rightBox;
+                std::uint32_t rightN = 0;
+                for (int i = n - 1; i > 0; --i) {
+                    rightBox.Extend(bins[i].Bounds);
+                    rightN += rightCount(bins[i]);
+                    if (leftN[i - 1] == 0 || rightN == 0) continue;
+                    float const cost = BVH::c_TraversalCost + BVH::c_IntersectCost * (leftBox[i - 1].SurfaceArea() * leftN[i - 1] + rightBox.SurfaceArea() * rightN) / parentArea;
+                    if (cost < best.Cost) best = { cost, axis, i, leftBox[i - 1], rightBox, leftN[i - 1], rightN };
+                }
+            }
+
+            void PartitionObject(std::vector<Reference> const & refs, Split const & split, AABB const & centroidBounds, std::vector<Reference> & left, std::vector<Reference> & right) const {
+                float const scale = BVH::c_NumBins / (centroidBounds.Max[split.Axis] - centroidBounds.Min[split.Axis]);
+                for (auto const & ref : refs) {
+                    int const b = glm::min(int((ref.Bounds.Centroid()[split.Axis] - centroidBounds.Min[split.Axis]) * scale), BVH::c_NumBins - 1);
+                    (b < split.Bin ? left : right).push_back(ref);
+                }
+            }
+
+            // 跨越平面的引用默认裁剪为两半; 若整个放入一侧的 SAH 代价更低则不裁剪 (reference unsplitting), 预算用完时按质心放入一侧
+            void PartitionSpatial(std::vector<Reference> const & refs, Split const & split, float const plane, std::vector<Reference> & left, std::vector<Reference> & right) {
+                float const areaL = split.Left.SurfaceArea();
+                float const areaR = split.Right.SurfaceArea();
+                for (auto const & ref : refs) {
+                    if (ref.Bounds.Max[split.Axis] <= plane) {
+                        left.push_back(ref);
+                    } else if (ref.Bounds.Min[split.Axis] >= plane) {
+                        right.push_back(ref);
+                    } else {
+                        float const costSplit = areaL * split.LeftCount + areaR * split.RightCount;
+                        float const costLeft  = Merge(split.Left, ref.Bounds).SurfaceArea() * split.LeftCount + areaR * (split.RightCount - 1);
+                        float const costRight = areaL * (split.LeftCount - 1) + Merge(split.Right, ref.Bounds).SurfaceArea() * split.RightCount;
+                        if (_budget == 0 || std::min(costLeft, costRight) <= costSplit) {
+                            bool const toLeft = _budget == 0 ? ref.Bounds.Centroid()[split.Axis] < plane : costLeft <= costRight;
+                            (toLeft ? left : right).push_back(ref);
+                            continue;
+                        }
+                        Reference l { {}, ref.Index }, r { {}, ref.Index };
+                        SplitReference(ref, split.Axis, plane, l.Bounds, r.Bounds);
+                        left.push_back(l);
+                        right.push_back(r);
+                        --_budget;
+                    }
+                }
+            }
+
+            // 求三角形在引用的范围内被 axis = pos 平面分开的两部分的包围盒
+            void SplitReference(Reference const & ref, int const axis, float const pos, AABB & left, AABB & right) const {
+                AABB const               bounds = ref.Bounds; // left 或 right 可能就是 ref.Bounds
+                std::array<glm::vec3, 3> v;
+                for (int k = 0; k < 3; ++k) v[k] = _mesh.Positions[_mesh.Indices[3 * ref.Index + k]];
+
+                AABB l, r;
+                for (int k = 0; k < 3; ++k) {
+                    glm::vec3 const & a = v[k];
+                    glm::vec3 const & b = v[(k + 1) % 3];
+                    if (a[axis] <= pos) l.Extend(a);
+                    if (a[axis] >= pos) r.Extend(a);
+                    if ((a[axis] < pos && b[axis] > pos) || (a[axis] > pos && b[axis] < pos)) {
+                        glm::vec3 p = glm::mix(a, b, (pos - a[axis]) / (b[axis] - a[axis]));
+                        p[axis]     = pos;
+                        l.Extend(p);
+                        r.Extend(p);
+                    }
+                }
+                left.Min  = glm::max(l.Min, bounds.Min);
+                left.Max  = glm::min(l.Max, bounds.Max);
+                right.Min = glm::max(r.Min, bounds.Min);
+                right.Max = glm::min(r.Max, bounds.Max);
+            }
+
+            static float GetPlane(AABB const & bounds, int const axis, int const bin) {
+                return bounds.Min[axis] + (bounds.Max[axis] - bounds.Min[axis]) * bin / BVH::c_NumBins;
+            }
+
+            Engine::SurfaceMesh const &  _mesh;
+            int                          _maxDepth;
+            std::size_t                  _budget; // 剩余可新增的引用数
+            float                        _minOverlap;
+            std::vector<BVHNode> &       _nodes;
+            std::vector<std::uint32_t> & _primitives;
+        };
+    } // namespace
+
+    void BuildSpatialSplitBVH(
+        Engine::SurfaceMesh const &  mesh,
+        std::span<AABB const> const  boxes,
+        float const                  maxDuplication,
+        int const                    maxDepth,
+        std::vector<BVHNode> &       nodes,
+        std::vector<std::uint32_t> & primitives) {
+        nodes.clear();
+        primitives.clear();
+        if (boxes.empty()) return;
+
+        std::vector<Reference> refs(boxes.size());
+        AABB                   root;
+        for (std::uint32_t i = 0; i < boxes.size(); ++i) {
+            refs[i] = { boxes[i], i };
+            root.Extend(boxes[i]);
+        }
+        std::size_t const budget = std::size_t(maxDuplication * boxes.size());
+        nodes.reserve(2 * (boxes.size() + budget));
+        primitives.reserve(boxes.size() + budget);
+        SpatialSplitBuilder(mesh, maxDepth, budget, c_MinOverlapRatio * root.SurfaceArea(), nodes, primitives).BuildNode(std::move(refs), 0);
+        nodes.shrink_to_fit();
+        primitives.shrink_to_fit();
+    }
+
+} // namespace VCX::Labs::Rendering
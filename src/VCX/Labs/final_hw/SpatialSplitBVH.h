@@ -0,0 +1,25 @@
+// SpatialSplitBVH.h
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Engine/SurfaceMesh.h"
+#include "Labs/final_hw/BVH.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 空间划分 BVH (SBVH, Stich et al. 2009): 在分桶 SAH 的物体划分之外, 对孩子重叠较大的节点再尝试按空间位置划分,
+    // 跨越划分平面的三角形引用被裁剪为两半分别放入两个孩子. 细长三角形多的场景中节点的重叠因此大幅减少.
+    // 因裁剪而新增的引用至多为三角形数的 maxDuplication 倍, 用完后只做物体划分.
+    // boxes 为各三角形的包围盒; 输出与 BVH 内部的布局相同, primitives 为三角形的序号, 同一三角形可能出现在多个叶节点中
+    void BuildSpatialSplitBVH(
+        Engine::SurfaceMesh const &  mesh,
+        std::span<AABB const>        boxes,
+        float                        maxDuplication,
+        int                          maxDepth,
+        std::vector<BVHNode> &       nodes,
+        std::vector<std::uint32_t> & primitives);
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,103 @@
+// TileRenderer.cpp
+#include "Labs/final_hw/TileRenderer.h"
+#include <algorithm>
+
+namespace VCX::Labs::Rendering {
+
+    void TileRenderer::Reset(std::size_t const width, std::size_t const height) {
+        Join();
+        _width  = width;
+        _height = height;
+        _tilesX = (width + c_TileSize - 1) / c_TileSize;
+        _tilesY = (height + c_TileSize - 1) / c_TileSize;
+        _tileDone.assign(_tilesX * _tilesY, 0);
+    }
+
+    void TileRenderer::Start(
+        std::function<void()> && prepare,
+        PixelFunc &&             renderPixel,
+        std::atomic_bool const & stopFlag,
+        std::atomic_size_t &     progress,
+        unsigned const           numThreads) {
+        Start(
+            std::move(prepare),
+            [renderPixel = std::move(renderPixel), &stopFlag](std::size_t const x0, std::size_t const y0, std::size_t const x1, std::size_t const y1) {
+                for (std::size_t y = y0; y < y1; ++y)
+                    for (std::size_t x = x0; x < x1 && ! stopFlag; ++x) renderPixel(x, y);
+            },
+            stopFlag,
+            progress,
+            numThreads);
+    }
+
+    void TileRenderer::Start(
+        std::function<void()> && prepare,
+        BlockFunc &&             renderBlock,
+        std::atomic_bool const & stopFlag,
+        std::atomic_size_t &     progress,
+        unsigned const           numThreads,
+        std::size_t const        blockSize) {
+        Join();
+        _numThreads = numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency());
+        _master     = std::thread([this, prepare = std::move(prepare), renderBlock = std::move(renderBlock), blockSize, &stopFlag, &progress]() {
+            if (prepare) prepare();
+
+            // 未完成的图块按行优先顺序连续地分给各线程, 保持每个线程内的访存局部性
+            std::vector<std::uint32_t> pending;
+            for (std::uint32_t i = 0; i < _tileDone.size(); ++i)
+                if (! _tileDone[i]) pending.push_back(i);
+            _queues.clear();
+            for (unsigned w = 0; w < _numThreads; ++w) _queues.push_back(std::make_unique<WorkQueue>());
+            for (std::size_t i = 0; i < pending.size(); ++i)
+                _queues[i * _numThreads / pending.size()]->Tiles.push_back(pending[i]);
+
+            auto const work = [&](std::size_t const worker) {
+                std::uint32_t tile;
+                while (! stopFlag && PopTile(worker, tile)) {
+                    std::size_t const x0 = tile % _tilesX * c_TileSize;
+                    std::size_t const y0 = tile / _tilesX * c_TileSize;
+                    std::size_t const x1 = std::min(x0 + c_TileSize, _width);
+                    std::size_t const y1 = std::min(y0 + c_TileSize, _height);
+                    std::size_t const n  = (x1 - x0) * (y1 - y0);
+
+                    for (std::size_t by = y0; by < y1 && ! stopFlag; by += blockSize)
+                        for (std::size_t bx = x0; bx < x1 && ! stopFlag; bx += blockSize)
+                            renderBlock(bx, by, std::min(bx + blockSize, x1), std::min(by + blockSize, y1));
+                    if (stopFlag) return;
+
+                    _tileDone[tile] = 1;
+                    progress += n;
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (unsigned w = 1; w < _numThreads; ++w) workers.emplace_back(work, w);
+            work(0);
+            for (auto & worker : workers) worker.join();
+        });
+    }
+
+    bool TileRenderer::PopTile(std::size_t const worker, std::uint32_t & tile) {
+        {
+            auto &                      queue = *_queues[worker];
+            std::lock_guard<std::mutex> lock(queue.Mutex);
+            if (! queue.Tiles.empty()) {
+                tile = queue.Tiles.front();
+                queue.Tiles.pop_front();
+                return true;
+            }
+        }
+        // 本地队列为空, 从其他线程的队尾窃取
+        for (std::size_t i = 1; i < _queues.size(); ++i) {
+            auto &                      queue = *_queues[(worker + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock(queue.Mutex);
+            if (! queue.Tiles.empty()) {
+                tile = queue.Tiles.back();
+                queue.Tiles.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,75 @@
+// TileRenderer.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VCX::Labs::Rendering {
+
+    // 基于图块的多线程渲染调度器
+    // 每个线程拥有一个图块队列, 自己的队列取空后从其他线程的队尾窃取图块
+    class TileRenderer {
+    public:
+        static constexpr std::size_t c_TileSize  = 16;
+        static constexpr std::size_t c_BlockSize = 4; // 图块默认再按 4x4 像素块交给 BlockFunc, 便于成包追踪相机光线
+
+        using PixelFunc = std::function<void(std::size_t, std::size_t)>;
+        using BlockFunc = std::function<void(std::size_t x0, std::size_t y0, std::size_t x1, std::size_t y1)>; // 像素范围 [x0, x1) x [y0, y1)
+
+        TileRenderer() = default;
+        ~TileRenderer() { Join(); }
+
+        // 设置图像尺寸并清空已完成图块的记录
+        void Reset(std::size_t width, std::size_t height);
+
+        // 在后台调度线程上先执行 prepare, 再用 numThreads 个线程 (0 表示全部核心) 渲染所有未完成的图块.
+        // 每完成一个图块, progress 增加该图块的像素数; stopFlag 置位后各线程在当前像素结束后退出,
+        // 被打断的图块保留到下一次 Start 重新渲染.
+        void Start(
+            std::function<void()> && prepare,
+            PixelFunc &&             renderPixel,
+            std::atomic_bool const & stopFlag,
+            std::atomic_size_t &     progress,
+            unsigned                 numThreads = 0);
+
+        // 同上, 但每次渲染一个 blockSize x blockSize 的像素块 (取 c_TileSize 则为整个图块); stopFlag 在像素块之间检查
+        void Start(
+            std::function<void()> && prepare,
+            BlockFunc &&             renderBlock,
+            std::atomic_bool const & stopFlag,
+            std::atomic_size_t &     progress,
+            unsigned                 numThreads = 0,
+            std::size_t              blockSize  = c_BlockSize);
+
+        void Join() {
+            if (_master.joinable()) _master.join();
+        }
+
+        bool     IsRunning() const { return _master.joinable(); }
+        unsigned GetThreadCount() const { return _numThreads; }
+
+    private:
+        struct WorkQueue {
+            std::mutex                Mutex;
+            std::deque<std::uint32_t> Tiles;
+        };
+
+        bool PopTile(std::size_t worker, std::uint32_t & tile);
+
+        std::size_t                             _width  = 0;
+        std::size_t                             _height = 0;
+        std::size_t                             _tilesX = 0;
+        std::size_t                             _tilesY = 0;
+        std::vector<std::uint8_t>               _tileDone;
+        std::vector<std::unique_ptr<WorkQueue>> _queues;
+        std::thread                             _master;
+        unsigned                                _numThreads = 0;
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,31 @@
+// TriangleSoA.cpp
+#include "Labs/final_hw/TriangleSoA.h"
+
+namespace VCX::Labs::Rendering {
+
+    void TriangleSoA::Build(Engine::SurfaceMesh const & mesh, std::vector<std::uint32_t> const & primitives) {
+        _size = primitives.size();
+        for (auto & column : _columns) column.assign(_size + c_Lanes - 1, 0.0f);
+
+        for (std::size_t i = 0; i < _size; ++i) {
+            std::uint32_t const * face = mesh.Indices.data() + primitives[i];
+            for (int k = 0; k < 3; ++k)
+                for (int a = 0; a < 3; ++a) _columns[V0X + 3 * k + a][i] = mesh.Positions[face[k]][a];
+        }
+    }
+
+    void TriangleSoA::Serialize(ByteWriter & writer) const {
+        writer.Write(std::uint64_t(_size));
+        for (auto const & column : _columns) writer.Write(column);
+    }
+
+    bool TriangleSoA::Deserialize(ByteReader & reader) {
+        std::uint64_t size;
+        if (! reader.Read(size)) return false;
+        _size = size;
+        for (auto & column : _columns)
+            if (! reader.Read(column) || (_size > 0 && column.size() != _size + c_Lanes - 1)) return false;
+        return true;
+    }
+
+} // namespace VCX::Labs::Rendering
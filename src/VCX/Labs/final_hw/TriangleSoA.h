@@ -0,0 +1,231 @@
+// TriangleSoA.h
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Engine/SurfaceMesh.h"
+#include "Labs/final_hw/ByteStream.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+    #define VCX_RENDERING_SSE 1
+    #include <immintrin.h>
+#else
+    #define VCX_RENDERING_SSE 0
+#endif
+
+namespace VCX::Labs::Rendering {
+
+    // 按 BVH 图元顺序排列的三角形顶点, 每个分量单独成一列, 叶节点内的连续三角形可以 4 个一组地用 SIMD 求交;
+    // 存顶点而不存边, 相邻三角形的公共边在求交时完全相同, 不会在边上漏掉光线
+    class TriangleSoA {
+    public:
+        static constexpr int c_Lanes = 4;
+
+        enum Column { V0X, V0Y, V0Z, V1X, V1Y, V1Z, V2X, V2Y, V2Z, NumColumns };
+
+        // primitives 为三角形在 mesh.Indices 中的偏移
+        void Build(Engine::SurfaceMesh const & mesh, std::vector<std::uint32_t> const & primitives);
+
+        std::size_t  Size() const { return _size; }
+        float const * operator[](int const c) const { return _columns[c].data(); }
+        std::size_t  GetMemoryUsage() const { return NumColumns * _columns[0].size() * sizeof(float); }
+
+        // 写入/读回缓存文件
+        void Serialize(ByteWriter & writer) const;
+        bool Deserialize(ByteReader & reader);
+
+    private:
+        std::vector<float> _columns[NumColumns]; // 末尾补齐 c_Lanes - 1 个元素, 最后一组可以整组读取
+        std::size_t        _size = 0;
+    };
+
+    // 浮点运算 n 次的相对误差上界 (Higham)
+    constexpr float Gamma(int const n) {
+        constexpr float eps = std::numeric_limits<float>::epsilon() * 0.5f;
+        return n * eps / (1 - n * eps);
+    }
+
+    // 每条光线只需准备一次的水密求交参数: 方向绝对值最大的轴作为 z 轴, 剪切变换使光线沿 +z 方向,
+    // 三角形投影到 xy 平面后用边函数判断光线是否穿过 (Woop et al. 2013)
+    struct TriangleRay {
+        int   Axis[3];   // 重排后的 x, y, z 轴
+        float Origin[3]; // 按 Axis 重排的起点
+        float Shear[3];  // dir.x / dir.z, dir.y / dir.z, 1 / dir.z
+#if VCX_RENDERING_SSE
+        __m128 Origin4[3];
+        __m128 Shear4[3];
+#endif
+
+        TriangleRay(glm::vec3 const & origin, glm::vec3 const & dir) {
+            glm::vec3 const a = glm::abs(dir);
+            int const       z = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+            Axis[0]           = (z + 1) % 3;
+            Axis[1]           = (z + 2) % 3;
+            Axis[2]           = z;
+            Shear[0]          = dir[Axis[0]] / dir[z];
+            Shear[1]          = dir[Axis[1]] / dir[z];
+            Shear[2]          = 1.0f / dir[z];
+            for (int k = 0; k < 3; ++k) {
+                Origin[k] = origin[Axis[k]];
+#if VCX_RENDERING_SSE
+                Origin4[k] = _mm_set1_ps(Origin[k]);
+                Shear4[k]  = _mm_set1_ps(Shear[k]);
+#endif
+            }
+        }
+    };
+
+    // 单个三角形的水密求交: 公共边上的光线恰好被其中一个三角形接受, 边函数为 0 时以 double 重算;
+    // 只接受 t 大于其浮点误差上界的交点, 起点落在三角形上 (误差范围内) 时不会与其自交.
+    // 返回 t 是否落在 [tMin, tMax] 内, u, v 为 p1, p2 的重心坐标
+    inline bool IntersectTriangleWatertight(
+        TriangleRay const & ray,
+        glm::vec3 const &   p0,
+        glm::vec3 const &   p1,
+        glm::vec3 const &   p2,
+        float const         tMin,
+        float const         tMax,
+        float &             t,
+        float &             u,
+        float &             v) {
+        // 平移到光线起点, 重排并剪切
+        glm::vec3 q[3];
+        glm::vec3 const * p[3] = { &p0, &p1, &p2 };
+        for (int i = 0; i < 3; ++i) {
+            float const z = (*p[i])[ray.Axis[2]] - ray.Origin[2];
+            q[i]          = { (*p[i])[ray.Axis[0]] - ray.Origin[0] - ray.Shear[0] * z, (*p[i])[ray.Axis[1]] - ray.Origin[1] - ray.Shear[1] * z, ray.Shear[2] * z };
+        }
+
+        // 边函数, e[i] 对应顶点 i 的重心坐标
+        float e[3] = {
+            q[1].x * q[2].y - q[1].y * q[2].x,
+            q[2].x * q[0].y - q[2].y * q[0].x,
+            q[0].x * q[1].y - q[0].y * q[1].x,
+        };
+        if (e[0] == 0.0f || e[1] == 0.0f || e[2] == 0.0f) {
+            e[0] = float(double(q[1].x) * q[2].y - double(q[1].y) * q[2].x);
+            e[1] = float(double(q[2].x) * q[0].y - double(q[2].y) * q[0].x);
+            e[2] = float(double(q[0].x) * q[1].y - double(q[0].y) * q[1].x);
+        }
+        if ((e[0] < 0.0f || e[1] < 0.0f || e[2] < 0.0f) && (e[0] > 0.0f || e[1] > 0.0f || e[2] > 0.0f)) return false;
+        float const det = e[0] + e[1] + e[2];
+        if (det == 0.0f) return false;
+
+        float const inv = 1.0f / det;
+        t               = (e[0] * q[0].z + e[1] * q[1].z + e[2] * q[2].z) * inv;
+        u               = e[1] * inv;
+        v               = e[2] * inv;
+
+        // t 的保守误差上界 (Pharr et al., Physically Based Rendering 3.9)
+        float const maxX   = std::max({ std::abs(q[0].x), std::abs(q[1].x), std::abs(q[2].x) });
+        float const maxY   = std::max({ std::abs(q[0].y), std::abs(q[1].y), std::abs(q[2].y) });
+        float const maxZ   = std::max({ std::abs(q[0].z), std::abs(q[1].z), std::abs(q[2].z) });
+        float const maxE   = std::max({ std::abs(e[0]), std::abs(e[1]), std::abs(e[2]) });
+        float const deltaX = Gamma(5) * (maxX + maxZ);
+        float const deltaY = Gamma(5) * (maxY + maxZ);
+        float const deltaZ = Gamma(3) * maxZ;
+        float const deltaE = 2.0f * (Gamma(2) * maxX * maxY + deltaY * maxX + deltaX * maxY);
+        float const deltaT = 3.0f * (Gamma(3) * maxE * maxZ + deltaE * maxZ + deltaZ * maxE) * std::abs(inv);
+        return t > deltaT && t >= tMin && t <= tMax;
+    }
+
+    // 测试从 first 开始的 count (<= 4) 个三角形, 返回 t 落在 [tMin, tMax] 内的位掩码, 结果与逐个调用 IntersectTriangleWatertight 相同
+    inline int IntersectTriangles(
+        TriangleSoA const & tris,
+        std::uint32_t const first,
+        std::uint32_t const count,
+        TriangleRay const & ray,
+        float const         tMin,
+        float const         tMax,
+        float (&t)[TriangleSoA::c_Lanes],
+        float (&u)[TriangleSoA::c_Lanes],
+        float (&v)[TriangleSoA::c_Lanes]) {
+#if VCX_RENDERING_SSE
+        int const    valid = (1 << count) - 1;
+        __m128 const sign  = _mm_set1_ps(-0.0f);
+        __m128 const zero  = _mm_setzero_ps();
+        auto const   Abs   = [&](__m128 x) { return _mm_andnot_ps(sign, x); };
+        auto const   Max3  = [](__m128 a, __m128 b, __m128 c) { return _mm_max_ps(_mm_max_ps(a, b), c); };
+
+        // 平移到光线起点, 重排并剪切
+        __m128 x[3], y[3], z[3];
+        for (int i = 0; i < 3; ++i) {
+            int const    column = TriangleSoA::V0X + 3 * i;
+            __m128 const dz     = _mm_sub_ps(_mm_loadu_ps(tris[column + ray.Axis[2]] + first), ray.Origin4[2]);
+            x[i]                = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(tris[column + ray.Axis[0]] + first), ray.Origin4[0]), _mm_mul_ps(ray.Shear4[0], dz));
+            y[i]                = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(tris[column + ray.Axis[1]] + first), ray.Origin4[1]), _mm_mul_ps(ray.Shear4[1], dz));
+            z[i]                = _mm_mul_ps(ray.Shear4[2], dz);
+        }
+
+        __m128 e[3] = {
+            _mm_sub_ps(_mm_mul_ps(x[1], y[2]), _mm_mul_ps(y[1], x[2])),
+            _mm_sub_ps(_mm_mul_ps(x[2], y[0]), _mm_mul_ps(y[2], x[0])),
+            _mm_sub_ps(_mm_mul_ps(x[0], y[1]), _mm_mul_ps(y[0], x[1])),
+        };
+
+        // 边函数为 0 的三角形 (光线擦过边或顶点) 很少, 逐个以 double 重算
+        int const degenerate = _mm_movemask_ps(_mm_or_ps(_mm_or_ps(_mm_cmpeq_ps(e[0], zero), _mm_cmpeq_ps(e[1], zero)), _mm_cmpeq_ps(e[2], zero))) & valid;
+        if (degenerate) {
+            alignas(16) float xs[3][TriangleSoA::c_Lanes], ys[3][TriangleSoA::c_Lanes], es[3][TriangleSoA::c_Lanes];
+            for (int i = 0; i < 3; ++i) {
+                _mm_store_ps(xs[i], x[i]);
+                _mm_store_ps(ys[i], y[i]);
+                _mm_store_ps(es[i], e[i]);
+            }
+            for (int mask = degenerate; mask; mask &= mask - 1) {
+                int const k = std::countr_zero(unsigned(mask));
+                for (int i = 0; i < 3; ++i) {
+                    int const a = (i + 1) % 3, b = (i + 2) % 3;
+                    es[i][k]    = float(double(xs[a][k]) * ys[b][k] - double(ys[a][k]) * xs[b][k]);
+                }
+            }
+            for (int i = 0; i < 3; ++i) e[i] = _mm_load_ps(es[i]);
+        }
+
+        __m128 const anyNeg = _mm_or_ps(_mm_or_ps(_mm_cmplt_ps(e[0], zero), _mm_cmplt_ps(e[1], zero)), _mm_cmplt_ps(e[2], zero));
+        __m128 const anyPos = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(e[0], zero), _mm_cmpgt_ps(e[1], zero)), _mm_cmpgt_ps(e[2], zero));
+        __m128 const det    = _mm_add_ps(_mm_add_ps(e[0], e[1]), e[2]);
+        __m128       hit    = _mm_andnot_ps(_mm_and_ps(anyNeg, anyPos), _mm_cmpneq_ps(det, zero));
+        if (! (_mm_movemask_ps(hit) & valid)) return 0;
+
+        __m128 const inv = _mm_div_ps(_mm_set1_ps(1.0f), det);
+        __m128 const tt  = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e[0], z[0]), _mm_mul_ps(e[1], z[1])), _mm_mul_ps(e[2], z[2])), inv);
+
+        // t 的保守误差上界, 与 IntersectTriangleWatertight 相同
+        __m128 const maxX   = Max3(Abs(x[0]), Abs(x[1]), Abs(x[2]));
+        __m128 const maxY   = Max3(Abs(y[0]), Abs(y[1]), Abs(y[2]));
+        __m128 const maxZ   = Max3(Abs(z[0]), Abs(z[1]), Abs(z[2]));
+        __m128 const maxE   = Max3(Abs(e[0]), Abs(e[1]), Abs(e[2]));
+        __m128 const deltaX = _mm_mul_ps(_mm_set1_ps(Gamma(5)), _mm_add_ps(maxX, maxZ));
+        __m128 const deltaY = _mm_mul_ps(_mm_set1_ps(Gamma(5)), _mm_add_ps(maxY, maxZ));
+        __m128 const deltaZ = _mm_mul_ps(_mm_set1_ps(Gamma(3)), maxZ);
+        __m128 const deltaE = _mm_mul_ps(_mm_set1_ps(2.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(Gamma(2)), maxX), maxY), _mm_mul_ps(deltaY, maxX)), _mm_mul_ps(deltaX, maxY)));
+        __m128 const deltaT = _mm_mul_ps(
+            _mm_mul_ps(_mm_set1_ps(3.0f), _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(_mm_set1_ps(Gamma(3)), maxE), maxZ), _mm_mul_ps(deltaE, maxZ)), _mm_mul_ps(deltaZ, maxE))),
+            Abs(inv));
+
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(tt, deltaT));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(tt, _mm_set1_ps(tMin)), _mm_cmple_ps(tt, _mm_set1_ps(tMax))));
+        _mm_storeu_ps(t, tt);
+        _mm_storeu_ps(u, _mm_mul_ps(e[1], inv));
+        _mm_storeu_ps(v, _mm_mul_ps(e[2], inv));
+        return _mm_movemask_ps(hit) & valid;
+#else
+        int mask = 0;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            std::uint32_t const k     = first + i;
+            auto const          Point = [&](int const column) { return glm::vec3(tris[column][k], tris[column + 1][k], tris[column + 2][k]); };
+            if (IntersectTriangleWatertight(ray, Point(TriangleSoA::V0X), Point(TriangleSoA::V1X), Point(TriangleSoA::V2X), tMin, tMax, t[i], u[i], v[i])) mask |= 1 << i;
+        }
+        return mask;
+#endif
+    }
+
+} // namespace VCX::Labs::Rendering
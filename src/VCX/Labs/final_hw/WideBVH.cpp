@@ -0,0 +1,721 @@
+// WideBVH.cpp
+#include "Labs/final_hw/WideBVH.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+#include "Labs/final_hw/CacheModel.h"
+
+namespace VCX::Labs::Rendering {
+
+    namespace {
+        constexpr int c_Width        = WideBVHNode::c_Width;
+        constexpr int c_QuantizedMax = 255; // 8 位量化值的上限
+
+        // 每条光线只需准备一次的 slab 测试参数; 按方向符号预先选好近/远平面, 省去逐节点的 min/max
+        struct SlabRay {
+            int Near[3]; // 0: 近平面为 Lo; 1: 近平面为 Hi
+#if VCX_RENDERING_SSE
+            __m128 Origin[3];
+            __m128 InvDir[3];
+#else
+            float Origin[3];
+            float InvDir[3];
+#endif
+
+            explicit SlabRay(glm::vec3 const & origin, glm::vec3 const & invDir) {
+                for (int a = 0; a < 3; ++a) {
+                    Near[a] = invDir[a] < 0.0f;
+#if VCX_RENDERING_SSE
+                    Origin[a] = _mm_set1_ps(origin[a]);
+                    InvDir[a] = _mm_set1_ps(invDir[a]);
+#else
+                    Origin[a] = origin[a];
+                    InvDir[a] = invDir[a];
+#endif
+                }
+            }
+        };
+
+        // 2^e, e 在 [-126, 127] 之内
+        float ExpToScale(int const e) {
+            return std::bit_cast<float>(std::uint32_t(e + 127) << 23);
+        }
+
+        // 解码量化节点; 空槽与不压缩时一样放到无穷远处
+        WideBVHNode Decode(QuantizedBVHNode const & quantized) {
+            WideBVHNode node;
+#if VCX_RENDERING_SSE
+            __m128i const zero    = _mm_setzero_si128();
+            __m128i const word    = _mm_loadu_si128(reinterpret_cast<__m128i const *>(quantized.Child));
+            __m128i const isLeaf  = _mm_cmpgt_epi32(_mm_and_si128(_mm_set1_epi32(quantized.Leaves), _mm_setr_epi32(1, 2, 4, 8)), zero);
+            __m128i const leaf    = _mm_add_epi32(_mm_set1_epi32(int(quantized.PrimitiveBase)), _mm_srli_epi32(word, QuantizedBVHNode::c_CountBits));
+            __m128i const count   = _mm_and_si128(word, _mm_set1_epi32(int(QuantizedBVHNode::c_MaxCount)));
+            __m128 const  isEmpty = _mm_castsi128_ps(_mm_andnot_si128(isLeaf, _mm_cmpeq_epi32(word, zero)));
+            __m128 const  inf     = _mm_set1_ps(std::numeric_limits<float>::infinity());
+            _mm_store_si128(reinterpret_cast<__m128i *>(node.Child), _mm_or_si128(_mm_and_si128(isLeaf, leaf), _mm_andnot_si128(isLeaf, word)));
+            _mm_store_si128(reinterpret_cast<__m128i *>(node.Count), _mm_and_si128(isLeaf, count));
+
+            auto const Widen = [&](std::uint8_t const (&q)[c_Width]) {
+                std::int32_t packed;
+                std::memcpy(&packed, q, sizeof(packed));
+                return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+            };
+            for (int a = 0; a < 3; ++a) {
+                __m128 const origin = _mm_set1_ps(quantized.Origin[a]);
+                __m128 const scale  = _mm_set1_ps(ExpToScale(quantized.Exponent[a]));
+                __m128 const lo     = _mm_add_ps(origin, _mm_mul_ps(Widen(quantized.Lo[a]), scale));
+                __m128 const hi     = _mm_add_ps(origin, _mm_mul_ps(Widen(quantized.Hi[a]), scale));
+                _mm_store_ps(node.Lo[a], _mm_or_ps(_mm_andnot_ps(isEmpty, lo), _mm_and_ps(isEmpty, inf)));
+                _mm_store_ps(node.Hi[a], _mm_or_ps(_mm_andnot_ps(isEmpty, hi), _mm_and_ps(isEmpty, inf)));
+            }
+#else
+            for (int i = 0; i < c_Width; ++i) {
+                bool const isLeaf  = quantized.Leaves >> i & 1;
+                bool const isEmpty = ! isLeaf && quantized.Child[i] == 0;
+                node.Child[i]      = isLeaf ? quantized.PrimitiveBase + (quantized.Child[i] >> QuantizedBVHNode::c_CountBits) : quantized.Child[i];
+                node.Count[i]      = isLeaf ? quantized.Child[i] & QuantizedBVHNode::c_MaxCount : 0;
+                for (int a = 0; a < 3; ++a) {
+                    float const scale = ExpToScale(quantized.Exponent[a]);
+                    node.Lo[a][i]     = isEmpty ? std::numeric_limits<float>::infinity() : quantized.Origin[a] + quantized.Lo[a][i] * scale;
+                    node.Hi[a][i]     = isEmpty ? std::numeric_limits<float>::infinity() : quantized.Origin[a] + quantized.Hi[a][i] * scale;
+                }
+            }
+#endif
+            return node;
+        }
+
+        // 遍历代码通过 nodes[i] 取节点: 不压缩时直接引用, 压缩时返回解码后的临时节点
+        struct FloatNodes {
+            std::vector<WideBVHNode> const & Nodes;
+
+            static constexpr std::size_t c_NodeSize = sizeof(WideBVHNode);
+
+            WideBVHNode const & operator[](std::uint32_t const i) const { return Nodes[i]; }
+            void const *        Data(std::uint32_t const i) const { return &Nodes[i]; }
+        };
+
+        struct QuantizedNodes {
+            std::vector<QuantizedBVHNode> const & Nodes;
+
+            static constexpr std::size_t c_NodeSize = sizeof(QuantizedBVHNode);
+
+            WideBVHNode  operator[](std::uint32_t const i) const { return Decode(Nodes[i]); }
+            void const * Data(std::uint32_t const i) const { return &Nodes[i]; }
+        };
+
+        template<typename Func>
+        auto VisitNodes(std::vector<WideBVHNode> const & nodes, std::vector<QuantizedBVHNode> const & quantized, Func && func) {
+            return quantized.empty() ? func(FloatNodes { nodes }) : func(QuantizedNodes { quantized });
+        }
+
+        // 同时测试节点的全部孩子, 返回被击中孩子的位掩码, 并写出各孩子的进入距离
+        int IntersectChildren(WideBVHNode const & node, SlabRay const & ray, float const tMin, float const tMax, float (&tEntry)[c_Width]) {
+            float const(*const bounds[2])[c_Width] = { node.Lo, node.Hi };
+#if VCX_RENDERING_SSE
+            __m128 enter = _mm_set1_ps(tMin);
+            __m128 exit  = _mm_set1_ps(tMax);
+            for (int a = 0; a < 3; ++a) {
+                __m128 const tNear = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bounds[ray.Near[a]][a]), ray.Origin[a]), ray.InvDir[a]);
+                __m128 const tFar  = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(bounds[1 - ray.Near[a]][a]), ray.Origin[a]), ray.InvDir[a]);
+                enter              = _mm_max_ps(tNear, enter);
+                exit               = _mm_min_ps(tFar, exit);
+            }
+            _mm_storeu_ps(tEntry, enter);
+            return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+            int mask = 0;
+            for (int i = 0; i < c_Width; ++i) {
+                float enter = tMin;
+                float exit  = tMax;
+                for (int a = 0; a < 3; ++a) {
+                    float const tNear = (bounds[ray.Near[a]][a][i] - ray.Origin[a]) * ray.InvDir[a];
+                    float const tFar  = (bounds[1 - ray.Near[a]][a][i] - ray.Origin[a]) * ray.InvDir[a];
+                    enter             = tNear > enter ? tNear : enter;
+                    exit              = tFar < exit ? tFar : exit;
+                }
+                tEntry[i] = enter;
+                mask |= int(enter <= exit) << i;
+            }
+            return mask;
+#endif
+        }
+
+        struct StackEntry {
+            std::uint32_t Child;
+            std::uint32_t Count;
+            float         TEntry;
+        };
+
+        // 每个节点出栈一项、至多入栈 c_Width 项, 栈深不超过 (c_Width - 1) * 深度 + 1
+        constexpr int c_StackSize = (c_Width - 1) * BVH::c_MaxDepth + 1;
+
+        // 遍历计数; 渲染时用不计数的 NoStats, 计数的代码由编译器消去
+        struct NoStats {
+            void VisitNode(void const *, std::size_t) {}
+            void TestTriangles(TriangleSoA const &, std::uint32_t, std::uint32_t) {}
+        };
+
+        struct CountStats {
+            TraversalStats & Stats;
+
+            void VisitNode(void const * const node, std::size_t const bytes) {
+                ++Stats.Nodes;
+                if (Stats.Cache) Stats.Cache->Access(node, bytes);
+            }
+
+            void TestTriangles(TriangleSoA const & tris, std::uint32_t const first, std::uint32_t const count) {
+                Stats.Triangles += count;
+                if (Stats.Cache)
+                    for (int c = 0; c < TriangleSoA::NumColumns; ++c) Stats.Cache->Access(tris[c] + first, count * sizeof(float));
+            }
+        };
+
+        // 单光线求 root 子树内的最近交点
+        template<typename Nodes, typename Stats = NoStats>
+        bool TraverseClosest(
+            Nodes const &       nodes,
+            BVH const &         bvh,
+            StackEntry const &  root,
+            SlabRay const &     slab,
+            TriangleRay const & tri,
+            float const         tMin,
+            float &             tMax,
+            BVHHit &            hit,
+            Stats               stats = {}) {
+            std::array<StackEntry, c_StackSize> stack;
+            int                                 top = 0;
+            stack[top++]                            = root;
+
+            bool found = false;
+            while (top > 0) {
+                auto const entry = stack[--top];
+                if (entry.TEntry > tMax) continue;
+
+                if (entry.Count > 0) {
+                    stats.TestTriangles(bvh.GetTriangles(), entry.Child, entry.Count);
+                    found |= IntersectLeaf(bvh.GetTriangles(), bvh.GetPrimitives(), entry.Child, entry.Count, tri, tMin, tMax, hit);
+                    continue;
+                }
+
+                stats.VisitNode(nodes.Data(entry.Child), nodes.c_NodeSize);
+                WideBVHNode const & node = nodes[entry.Child];
+                float               tEntry[c_Width];
+                int                 mask = IntersectChildren(node, slab, tMin, tMax, tEntry);
+
+                // 被击中的孩子按进入距离由远到近入栈, 最近的孩子最先出栈
+                int const base = top;
+                while (mask) {
+                    int const  i    = std::countr_zero(unsigned(mask));
+                    StackEntry next = { node.Child[i], node.Count[i], tEntry[i] };
+                    mask &= mask - 1;
+                    int j = top++;
+                    for (; j > base && stack[j - 1].TEntry < next.TEntry; --j) stack[j] = stack[j - 1];
+                    stack[j] = next;
+                }
+            }
+            return found;
+        }
+
+        // 单光线判断 root 子树内是否存在被接受的交点, 孩子不必排序
+        template<typename Nodes>
+        bool TraverseAny(
+            Nodes const &                               nodes,
+            BVH const &                                 bvh,
+            StackEntry const &                          root,
+            SlabRay const &                             slab,
+            TriangleRay const &                         tri,
+            float const                                 tMin,
+            float const                                 tMax,
+            std::function<bool(BVHHit const &)> const & accept) {
+            std::array<StackEntry, c_StackSize> stack;
+            int                                 top = 0;
+            stack[top++]                            = root;
+
+            while (top > 0) {
+                auto const entry = stack[--top];
+
+                if (entry.Count > 0) {
+                    if (OccludedLeaf(bvh.GetTriangles(), bvh.GetPrimitives(), entry.Child, entry.Count, tri, tMin, tMax, accept)) return true;
+                    continue;
+                }
+
+                WideBVHNode const & node = nodes[entry.Child];
+                float               tEntry[c_Width];
+                int                 mask = IntersectChildren(node, slab, tMin, tMax, tEntry);
+                while (mask) {
+                    int const i  = std::countr_zero(unsigned(mask));
+                    stack[top++] = { node.Child[i], node.Count[i], tEntry[i] };
+                    mask &= mask - 1;
+                }
+            }
+            return false;
+        }
+
+        constexpr int c_PacketSize         = int(WideBVH::c_MaxPacketSize);
+        constexpr int c_Lanes              = 4;
+        constexpr int c_SingleRayThreshold = 4; // 活跃光线不多于此数时改为单光线遍历, 包遍历的额外开销不再划算
+
+        // 光线包, 各分量按光线连续存放, 每 c_Lanes 条一组用 SIMD 处理; 不足一组的空位复制第一条光线, 不参与求交
+        struct PacketRays {
+            alignas(16) float Origin[3][c_PacketSize];
+            alignas(16) float Dir[3][c_PacketSize];
+            alignas(16) float InvDir[3][c_PacketSize];
+            alignas(16) float TMax[c_PacketSize];
+            int           Groups;
+
+            // 所有光线方向的符号一致且分量均非零时, 可以用区间算术对整个包做保守的包围盒测试
+            bool  Coherent = true;
+            int   Near[3];
+            float OriginMin[3], OriginMax[3], InvMin[3], InvMax[3];
+
+            PacketRays(std::span<Ray const> const rays) {
+                if (rays.size() > std::size_t(c_PacketSize))
+                    spdlog::error("VCX::Labs::Rendering::WideBVH::PacketRays(..): {} rays exceed the packet size {}, the rest are ignored.", rays.size(), c_PacketSize);
+                int const n = int(std::min(rays.size(), std::size_t(c_PacketSize)));
+                Groups      = (n + c_Lanes - 1) / c_Lanes;
+                for (int i = 0; i < Groups * c_Lanes; ++i) {
+                    Ray const &     ray = rays[i < n ? i : 0];
+                    glm::vec3 const dir = glm::normalize(ray.Direction);
+                    for (int a = 0; a < 3; ++a) {
+                        Origin[a][i] = ray.Origin[a];
+                        Dir[a][i]    = dir[a];
+                        InvDir[a][i] = 1.0f / dir[a];
+                    }
+                }
+                for (int a = 0; a < 3; ++a) {
+                    Near[a]      = InvDir[a][0] < 0.0f;
+                    OriginMin[a] = OriginMax[a] = Origin[a][0];
+                    InvMin[a] = InvMax[a] = InvDir[a][0];
+                    for (int i = 0; i < n; ++i) {
+                        OriginMin[a] = std::min(OriginMin[a], Origin[a][i]);
+                        OriginMax[a] = std::max(OriginMax[a], Origin[a][i]);
+                        InvMin[a]    = std::min(InvMin[a], InvDir[a][i]);
+                        InvMax[a]    = std::max(InvMax[a], InvDir[a][i]);
+                    }
+                    Coherent = Coherent && std::isfinite(InvMin[a]) && std::isfinite(InvMax[a]) && (InvMin[a] > 0.0f || InvMax[a] < 0.0f);
+                }
+            }
+
+            SlabRay GetSlabRay(int const i) const {
+                return SlabRay({ Origin[0][i], Origin[1][i], Origin[2][i] }, { InvDir[0][i], InvDir[1][i], InvDir[2][i] });
+            }
+
+            TriangleRay GetTriangleRay(int const i) const {
+                return TriangleRay({ Origin[0][i], Origin[1][i], Origin[2][i] }, { Dir[0][i], Dir[1][i], Dir[2][i] });
+            }
+        };
+
+        // 区间算术: 包内每条光线的进入距离不小于 enter 的下界, 离开距离不大于 exit 的上界,
+        // 下界大于上界的孩子不会被包内任何光线击中; 返回可能被击中的孩子的位掩码
+        int IntersectChildrenInterval(WideBVHNode const & node, PacketRays const & packet, float const tMin, float const tMax) {
+            float const(*const bounds[2])[c_Width] = { node.Lo, node.Hi };
+#if VCX_RENDERING_SSE
+            __m128 enter = _mm_set1_ps(tMin);
+            __m128 exit  = _mm_set1_ps(tMax);
+            for (int a = 0; a < 3; ++a) {
+                __m128 const iMin  = _mm_set1_ps(packet.InvMin[a]);
+                __m128 const iMax  = _mm_set1_ps(packet.InvMax[a]);
+                __m128 const near  = _mm_load_ps(bounds[packet.Near[a]][a]);
+                __m128 const far   = _mm_load_ps(bounds[1 - packet.Near[a]][a]);
+                __m128 const dn0   = _mm_sub_ps(near, _mm_set1_ps(packet.OriginMax[a]));
+                __m128 const dn1   = _mm_sub_ps(near, _mm_set1_ps(packet.OriginMin[a]));
+                __m128 const df0   = _mm_sub_ps(far, _mm_set1_ps(packet.OriginMax[a]));
+                __m128 const df1   = _mm_sub_ps(far, _mm_set1_ps(packet.OriginMin[a]));
+                __m128 const nearLo = _mm_min_ps(_mm_min_ps(_mm_mul_ps(dn0, iMin), _mm_mul_ps(dn0, iMax)), _mm_min_ps(_mm_mul_ps(dn1, iMin), _mm_mul_ps(dn1, iMax)));
+                __m128 const farHi  = _mm_max_ps(_mm_max_ps(_mm_mul_ps(df0, iMin), _mm_mul_ps(df0, iMax)), _mm_max_ps(_mm_mul_ps(df1, iMin), _mm_mul_ps(df1, iMax)));
+                enter              = _mm_max_ps(nearLo, enter);
+                exit               = _mm_min_ps(farHi, exit);
+            }
+            return _mm_movemask_ps(_mm_cmple_ps(enter, exit));
+#else
+            int mask = 0;
+            for (int i = 0; i < c_Width; ++i) {
+                float enter = tMin;
+                float exit  = tMax;
+                for (int a = 0; a < 3; ++a) {
+                    float const dn0 = bounds[packet.Near[a]][a][i] - packet.OriginMax[a];
+                    float const dn1 = bounds[packet.Near[a]][a][i] - packet.OriginMin[a];
+                    float const df0 = bounds[1 - packet.Near[a]][a][i] - packet.OriginMax[a];
+                    float const df1 = bounds[1 - packet.Near[a]][a][i] - packet.OriginMin[a];
+                    enter           = std::max({ enter, std::min({ dn0 * packet.InvMin[a], dn0 * packet.InvMax[a], dn1 * packet.InvMin[a], dn1 * packet.InvMax[a] }) });
+                    exit            = std::min({ exit, std::max({ df0 * packet.InvMin[a], df0 * packet.InvMax[a], df1 * packet.InvMin[a], df1 * packet.InvMax[a] }) });
+                }
+                mask |= int(enter <= exit) << i;
+            }
+            return mask;
+#endif
+        }
+
+        // 第 group 组光线与孩子 child 的包围盒求交, 返回组内击中的光线掩码, 并用击中光线的进入距离更新 minEntry
+        int IntersectChildGroup(WideBVHNode const & node, int const child, PacketRays const & packet, int const group, float const tMin, float & minEntry) {
+            int const base = group * c_Lanes;
+            float     enter[c_Lanes];
+#if VCX_RENDERING_SSE
+            __m128 vEnter = _mm_set1_ps(tMin);
+            __m128 vExit  = _mm_load_ps(packet.TMax + base);
+            for (int a = 0; a < 3; ++a) {
+                __m128 const origin = _mm_load_ps(packet.Origin[a] + base);
+                __m128 const invDir = _mm_load_ps(packet.InvDir[a] + base);
+                __m128 const t0     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Lo[a][child]), origin), invDir);
+                __m128 const t1     = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.Hi[a][child]), origin), invDir);
+                vEnter              = _mm_max_ps(_mm_min_ps(t0, t1), vEnter);
+                vExit               = _mm_min_ps(_mm_max_ps(t0, t1), vExit);
+            }
+            _mm_storeu_ps(enter, vEnter);
+            int const mask = _mm_movemask_ps(_mm_cmple_ps(vEnter, vExit));
+#else
+            int mask = 0;
+            for (int i = 0; i < c_Lanes; ++i) {
+                float exit = packet.TMax[base + i];
+                enter[i]   = tMin;
+                for (int a = 0; a < 3; ++a) {
+                    float const t0 = (node.Lo[a][child] - packet.Origin[a][base + i]) * packet.InvDir[a][base + i];
+                    float const t1 = (node.Hi[a][child] - packet.Origin[a][base + i]) * packet.InvDir[a][base + i];
+                    enter[i]       = std::max(std::min(t0, t1), enter[i]);
+                    exit           = std::min(std::max(t0, t1), exit);
+                }
+                mask |= int(enter[i] <= exit) << i;
+            }
+#endif
+            for (int m = mask; m; m &= m - 1) minEntry = std::min(minEntry, enter[std::countr_zero(unsigned(m))]);
+            return mask;
+        }
+
+        struct PacketEntry {
+            std::uint32_t Child;
+            std::uint32_t Count;
+            float         TEntry; // 包内击中光线的最小进入距离
+            std::uint32_t Rays;   // 击中该孩子的光线
+        };
+
+        // 节点的孩子逐个对包内仍活跃的光线求交, 把被击中的孩子写入 children, 返回个数
+        int IntersectPacketChildren(
+            WideBVHNode const & node,
+            PacketRays const &  packet,
+            std::uint32_t const rays,
+            float const         tMin,
+            PacketEntry (&children)[c_Width]) {
+            float maxT = tMin;
+            for (std::uint32_t m = rays; m; m &= m - 1) maxT = std::max(maxT, packet.TMax[std::countr_zero(m)]);
+            int const candidates = packet.Coherent ? IntersectChildrenInterval(node, packet, tMin, maxT) : (1 << c_Width) - 1;
+
+            int n = 0;
+            for (int c = 0; c < c_Width; ++c) {
+                if (! (candidates >> c & 1) || (node.Child[c] == 0 && node.Count[c] == 0)) continue;
+                std::uint32_t hit      = 0;
+                float         minEntry = std::numeric_limits<float>::infinity();
+                for (int g = 0; g < packet.Groups; ++g) {
+                    std::uint32_t const active = rays >> (g * c_Lanes) & ((1u << c_Lanes) - 1);
+                    if (active) hit |= std::uint32_t(IntersectChildGroup(node, c, packet, g, tMin, minEntry) & active) << (g * c_Lanes);
+                }
+                if (hit) children[n++] = { node.Child[c], node.Count[c], minEntry, hit };
+            }
+            return n;
+        }
+
+        // 光线包求最近交点, 返回命中光线的掩码; 命中光线的 packet.TMax 缩短为交点距离
+        template<typename Nodes>
+        std::uint32_t TraversePacketClosest(
+            Nodes const &           nodes,
+            BVH const &             bvh,
+            PacketRays &            packet,
+            std::uint32_t const     active,
+            float const             tMin,
+            std::span<BVHHit> const hits) {
+            std::array<PacketEntry, c_StackSize> stack;
+            int                                  top = 0;
+            stack[top++]                             = { 0, 0, tMin, active };
+
+            std::uint32_t found = 0;
+            while (top > 0) {
+                auto const entry = stack[--top];
+
+                // 进入距离超过所有光线当前最近交点的子树可以整体跳过
+                std::uint32_t rays = 0;
+                for (std::uint32_t m = entry.Rays; m; m &= m - 1) {
+                    int const i = std::countr_zero(m);
+                    if (entry.TEntry <= packet.TMax[i]) rays |= 1u << i;
+                }
+                if (! rays) continue;
+
+                // 叶节点, 或子树只剩少数光线时, 逐条光线继续遍历
+                if (entry.Count > 0 || std::popcount(rays) <= c_SingleRayThreshold) {
+                    for (; rays; rays &= rays - 1) {
+                        int const i = std::countr_zero(rays);
+                        if (TraverseClosest(nodes, bvh, { entry.Child, entry.Count, entry.TEntry }, packet.GetSlabRay(i), packet.GetTriangleRay(i), tMin, packet.TMax[i], hits[i])) found |= 1u << i;
+                    }
+                    continue;
+                }
+
+                // 被击中的孩子按最小进入距离由远到近入栈
+                PacketEntry children[c_Width];
+                int const   n    = IntersectPacketChildren(nodes[entry.Child], packet, rays, tMin, children);
+                int const   base = top;
+                for (int c = 0; c < n; ++c) {
+                    int j = top++;
+                    for (; j > base && stack[j - 1].TEntry < children[c].TEntry; --j) stack[j] = stack[j - 1];
+                    stack[j] = children[c];
+                }
+            }
+            return found;
+        }
+
+        // 光线包遮挡查询, 返回被遮挡光线的掩码
+        template<typename Nodes>
+        std::uint32_t TraversePacketAny(
+            Nodes const &                               nodes,
+            BVH const &                                 bvh,
+            PacketRays const &                          packet,
+            std::uint32_t const                         active,
+            float const                                 tMin,
+            std::function<bool(BVHHit const &)> const & accept) {
+            std::array<PacketEntry, c_StackSize> stack;
+            int                                  top = 0;
+            stack[top++]                             = { 0, 0, tMin, active };
+
+            // 已确定被遮挡的光线不再参与之后的遍历
+            std::uint32_t occluded = 0;
+            while (top > 0 && occluded != active) {
+                auto const          entry = stack[--top];
+                std::uint32_t const rays  = entry.Rays & ~occluded;
+                if (! rays) continue;
+
+                if (entry.Count > 0 || std::popcount(rays) <= c_SingleRayThreshold) {
+                    for (std::uint32_t m = rays; m; m &= m - 1) {
+                        int const i = std::countr_zero(m);
+                        if (TraverseAny(nodes, bvh, { entry.Child, entry.Count, entry.TEntry }, packet.GetSlabRay(i), packet.GetTriangleRay(i), tMin, packet.TMax[i], accept)) occluded |= 1u << i;
+                    }
+                    continue;
+                }
+
+                PacketEntry children[c_Width];
+                int const   n = IntersectPacketChildren(nodes[entry.Child], packet, rays, tMin, children);
+                for (int c = 0; c < n; ++c) stack[top++] = children[c];
+            }
+            return occluded;
+        }
+    } // namespace
+
+    void WideBVH::Build(BVH const & bvh, bool const quantized) {
+        auto const start = std::chrono::steady_clock::now();
+
+        _bvh = &bvh;
+        _nodes.clear();
+        _quantized.clear();
+
+        auto const & nodes = bvh.GetNodes();
+        if (! nodes.empty()) {
+            _nodes.reserve(nodes.size() / 2 + 1);
+            Collapse(nodes, 0);
+            _nodes.shrink_to_fit();
+            if (quantized && ! Quantize()) spdlog::warn("VCX::Labs::Rendering::WideBVH::Build(..): leaf too large to quantize, keeping full-precision nodes.");
+        }
+
+        _buildTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        spdlog::trace("VCX::Labs::Rendering::WideBVH::Build(..): {} binary nodes collapsed into {} {} nodes, {:.1f} ms.", nodes.size(), GetNodeCount(), IsQuantized() ? "quantized" : "full-precision", _buildTime);
+    }
+
+    void WideBVH::Serialize(ByteWriter & writer) const {
+        writer.Write(_nodes);
+        writer.Write(_quantized);
+    }
+
+    bool WideBVH::Deserialize(ByteReader & reader, BVH const & bvh) {
+        _bvh       = &bvh;
+        _buildTime = 0.0f;
+        return reader.Read(_nodes) && reader.Read(_quantized);
+    }
+
+    bool WideBVH::Quantize() {
+        std::vector<QuantizedBVHNode> quantized(_nodes.size());
+        for (std::size_t n = 0; n < _nodes.size(); ++n) {
+            WideBVHNode const & node = _nodes[n];
+            QuantizedBVHNode &  q    = quantized[n];
+
+            // 叶孩子以本节点最小的图元下标为基准存偏移
+            int           valid = 0;
+            std::uint32_t base  = std::numeric_limits<std::uint32_t>::max();
+            for (int i = 0; i < c_Width; ++i) {
+                valid |= int(node.Count[i] > 0 || node.Child[i] != 0) << i;
+                if (node.Count[i] > 0) {
+                    q.Leaves |= 1 << i;
+                    base = std::min(base, node.Child[i]);
+                }
+            }
+            q.PrimitiveBase = q.Leaves ? base : 0;
+            for (int i = 0; i < c_Width; ++i) {
+                if (! (q.Leaves >> i & 1)) {
+                    q.Child[i] = node.Child[i];
+                    continue;
+                }
+                std::uint32_t const offset = node.Child[i] - base;
+                if (node.Count[i] > QuantizedBVHNode::c_MaxCount || offset > QuantizedBVHNode::c_MaxOffset) return false;
+                q.Child[i] = offset << QuantizedBVHNode::c_CountBits | node.Count[i];
+            }
+
+            for (int a = 0; a < 3; ++a) {
+                float lo = std::numeric_limits<float>::infinity();
+                float hi = -std::numeric_limits<float>::infinity();
+                for (int i = 0; i < c_Width; ++i) {
+                    if (! (valid >> i & 1)) continue;
+                    lo = std::min(lo, node.Lo[a][i]);
+                    hi = std::max(hi, node.Hi[a][i]);
+                }
+                if (! valid) lo = hi = 0.0f;
+
+                // 取最小的 e 使 Origin + c_QuantizedMax * 2^e 不小于父包围盒的最大值, 在与解码相同的浮点运算下验证
+                int e = -126;
+                if (hi > lo) {
+                    std::frexp((hi - lo) / c_QuantizedMax, &e);
+                    e = std::max(e, -126);
+                }
+                while (e < 127 && lo + float(c_QuantizedMax) * ExpToScale(e) < hi) ++e;
+                float const scale = ExpToScale(e);
+                if (lo + float(c_QuantizedMax) * scale < hi) return false;
+
+                q.Origin[a]   = lo;
+                q.Exponent[a] = std::int8_t(e);
+                for (int i = 0; i < c_Width; ++i) {
+                    if (! (valid >> i & 1)) continue;
+                    // 最小值向下, 最大值向上取整, 再修正除法的舍入使解码值一定包住原值
+                    int qLo = std::clamp(int(std::floor((node.Lo[a][i] - lo) / scale)), 0, c_QuantizedMax);
+                    int qHi = std::clamp(int(std::ceil((node.Hi[a][i] - lo) / scale)), 0, c_QuantizedMax);
+                    while (qLo > 0 && lo + float(qLo) * scale > node.Lo[a][i]) --qLo;
+                    while (qHi < c_QuantizedMax && lo + float(qHi) * scale < node.Hi[a][i]) ++qHi;
+                    q.Lo[a][i] = std::uint8_t(qLo);
+                    q.Hi[a][i] = std::uint8_t(qHi);
+                }
+            }
+        }
+        _quantized = std::move(quantized);
+        _nodes.clear();
+        _nodes.shrink_to_fit();
+        return true;
+    }
+
+    std::uint32_t WideBVH::Collapse(std::vector<BVHNode> const & nodes, std::uint32_t const root) {
+        std::uint32_t const nodeIdx = std::uint32_t(_nodes.size());
+        _nodes.emplace_back();
+
+        // 反复展开表面积最大的内部孩子, 直到凑满 c_Width 个孩子或只剩叶节点
+        std::array<std::uint32_t, c_Width> slots;
+        int                                n = 0;
+        if (nodes[root].IsLeaf()) {
+            slots[n++] = root;
+        } else {
+            slots[n++] = root + 1;
+            slots[n++] = nodes[root].Offset;
+        }
+        while (n < c_Width) {
+            int   best     = -1;
+            float bestArea = -1.0f;
+            for (int i = 0; i < n; ++i) {
+                if (nodes[slots[i]].IsLeaf()) continue;
+                float const area = nodes[slots[i]].Bounds.SurfaceArea();
+                if (area > bestArea) {
+                    bestArea = area;
+                    best     = i;
+                }
+            }
+            if (best < 0) break;
+            std::uint32_t const expanded = slots[best];
+            slots[best]                  = expanded + 1;
+            slots[n++]                   = nodes[expanded].Offset;
+        }
+
+        // 递归会使 _nodes 重新分配, 因此先算出孩子再写回
+        std::array<std::uint32_t, c_Width> child {};
+        std::array<std::uint32_t, c_Width> count {};
+        for (int i = 0; i < n; ++i) {
+            BVHNode const & node = nodes[slots[i]];
+            if (node.IsLeaf()) {
+                child[i] = node.Offset;
+                count[i] = node.Count;
+            } else {
+                child[i] = Collapse(nodes, slots[i]);
+            }
+        }
+
+        WideBVHNode & wide = _nodes[nodeIdx];
+        for (int i = 0; i < c_Width; ++i) {
+            for (int a = 0; a < 3; ++a) {
+                wide.Lo[a][i] = i < n ? nodes[slots[i]].Bounds.Min[a] : std::numeric_limits<float>::infinity();
+                wide.Hi[a][i] = i < n ? nodes[slots[i]].Bounds.Max[a] : std::numeric_limits<float>::infinity();
+            }
+            wide.Child[i] = child[i];
+            wide.Count[i] = count[i];
+        }
+        return nodeIdx;
+    }
+
+    bool WideBVH::Intersect(BVHHit & hit, Ray const & ray, float const tMin, float tMax) const {
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir = glm::normalize(ray.Direction);
+        return VisitNodes(_nodes, _quantized, [&](auto const & nodes) {
+            return TraverseClosest(nodes, *_bvh, { 0, 0, tMin }, SlabRay(ray.Origin, 1.0f / dir), TriangleRay(ray.Origin, dir), tMin, tMax, hit);
+        });
+    }
+
+    bool WideBVH::Intersect(BVHHit & hit, Ray const & ray, float const tMin, float tMax, TraversalStats & stats) const {
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir = glm::normalize(ray.Direction);
+        return VisitNodes(_nodes, _quantized, [&](auto const & nodes) {
+            return TraverseClosest(nodes, *_bvh, { 0, 0, tMin }, SlabRay(ray.Origin, 1.0f / dir), TriangleRay(ray.Origin, dir), tMin, tMax, hit, CountStats { stats });
+        });
+    }
+
+    bool WideBVH::Occluded(Ray const & ray, float const tMin, float const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        if (IsEmpty()) return false;
+
+        glm::vec3 const dir = glm::normalize(ray.Direction);
+        return VisitNodes(_nodes, _quantized, [&](auto const & nodes) {
+            return TraverseAny(nodes, *_bvh, { 0, 0, tMin }, SlabRay(ray.Origin, 1.0f / dir), TriangleRay(ray.Origin, dir), tMin, tMax, accept);
+        });
+    }
+
+    std::uint32_t WideBVH::IntersectPacket(std::span<Ray const> const rays, float const tMin, std::span<float> const tMax, std::span<BVHHit> const hits) const {
+        if (IsEmpty() || rays.empty()) return 0;
+
+        PacketRays    packet(rays);
+        std::uint32_t active = 0;
+        for (int i = 0; i < c_PacketSize; ++i) {
+            packet.TMax[i] = i < int(rays.size()) ? tMax[i] : tMin;
+            if (packet.TMax[i] > tMin) active |= 1u << i;
+        }
+        if (! active) return 0;
+
+        std::uint32_t const found = VisitNodes(_nodes, _quantized, [&](auto const & nodes) {
+            return TraversePacketClosest(nodes, *_bvh, packet, active, tMin, hits);
+        });
+        for (std::uint32_t m = found; m; m &= m - 1) {
+            int const i = std::countr_zero(m);
+            tMax[i]     = packet.TMax[i];
+        }
+        return found;
+    }
+
+    std::uint32_t WideBVH::OccludedPacket(std::span<Ray const> const rays, float const tMin, std::span<float const> const tMax, std::function<bool(BVHHit const &)> const & accept) const {
+        if (IsEmpty() || rays.empty()) return 0;
+
+        PacketRays    packet(rays);
+        std::uint32_t active = 0;
+        for (int i = 0; i < c_PacketSize; ++i) {
+            packet.TMax[i] = i < int(rays.size()) ? tMax[i] : tMin;
+            if (packet.TMax[i] > tMin) active |= 1u << i;
+        }
+        if (! active) return 0;
+
+        return VisitNodes(_nodes, _quantized, [&](auto const & nodes) {
+            return TraversePacketAny(nodes, *_bvh, packet, active, tMin, accept);
+        });
+    }
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,87 @@
+// WideBVH.h
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "Labs/final_hw/BVH.h"
+#include "Labs/final_hw/Ray.h"
+
+namespace VCX::Labs::Rendering {
+
+    // 4 叉 BVH 节点 (128 字节, 两条缓存行), 四个孩子的包围盒按 SoA 存放, 一次 SIMD 测试全部孩子
+    struct alignas(64) WideBVHNode {
+        static constexpr int c_Width = 4;
+
+        float         Lo[3][c_Width]; // 各孩子包围盒的最小值, 按轴分组
+        float         Hi[3][c_Width]; // 各孩子包围盒的最大值; 空槽的包围盒位于无穷远处, 永远不会被击中
+        std::uint32_t Child[c_Width]; // 内部孩子: 节点下标; 叶孩子: 第一个图元的下标
+        std::uint32_t Count[c_Width]; // 叶孩子的图元数, 0 表示内部孩子或空槽
+    };
+
+    // 压缩的 4 叉 BVH 节点 (64 字节, 一条缓存行): 孩子的包围盒相对父节点包围盒量化为 8 位整数,
+    // 第 a 轴上的值为 Origin[a] + q * 2^Exponent[a]. 比例取 2 的幂使 q * 2^e 没有舍入, 解码只在加法处舍入一次,
+    // 构建时按同样的运算向外取整并逐个验证, 解码后的包围盒总是包含原包围盒, 求交结果与不压缩时完全相同
+    struct alignas(64) QuantizedBVHNode {
+        static constexpr int           c_Width     = WideBVHNode::c_Width;
+        static constexpr int           c_CountBits = 8;
+        static constexpr std::uint32_t c_MaxCount  = (1u << c_CountBits) - 1;
+        static constexpr std::uint32_t c_MaxOffset = (1u << (32 - c_CountBits)) - 1;
+
+        float         Origin[3];
+        std::int8_t   Exponent[3];
+        std::uint8_t  Leaves;         // 叶孩子的位掩码
+        std::uint8_t  Lo[3][c_Width]; // 各孩子包围盒最小值的量化值, 向下取整
+        std::uint8_t  Hi[3][c_Width]; // 各孩子包围盒最大值的量化值, 向上取整
+        std::uint32_t PrimitiveBase;  // 本节点叶孩子中第一个图元的最小下标
+        std::uint32_t Child[c_Width]; // 内部孩子: 节点下标, 0 表示空槽; 叶孩子: 相对 PrimitiveBase 的偏移 << c_CountBits | 图元数
+    };
+
+    // 由二叉 BVH 塌缩得到的 4 叉 BVH, 叶节点直接引用二叉树的图元与三角形数据, 二叉树需比它存活得更久.
+    // quantized 时节点以 QuantizedBVHNode 存放, 大小减半, 遍历时逐个解码; 节点数据超出 L2/L3 的大场景中更快
+    class WideBVH {
+    public:
+        static constexpr std::size_t c_MaxPacketSize = 16;
+
+        // quantized 时若某个叶节点的图元数或偏移超出 QuantizedBVHNode 的位宽, 退回不压缩的节点
+        void Build(BVH const & bvh, bool quantized = false);
+
+        // 与 BVH::Intersect 语义相同
+        bool Intersect(BVHHit & hit, Ray const & ray, float tMin, float tMax) const;
+
+        // 与 Intersect 相同, 同时把访问的节点数与求交的三角形数累加到 stats, 用于统计而非渲染
+        bool Intersect(BVHHit & hit, Ray const & ray, float tMin, float tMax, TraversalStats & stats) const;
+
+        // 与 BVH::Occluded 语义相同
+        bool Occluded(Ray const & ray, float tMin, float tMax, std::function<bool(BVHHit const &)> const & accept = nullptr) const;
+
+        // 光线包版本: 至多 c_MaxPacketSize 条相干光线共享一次遍历, 返回命中光线的位掩码, hits[i] 与单独调用 Intersect 的结果相同;
+        // 命中的光线的 tMax[i] 缩短为交点距离, tMax[i] <= tMin 的光线不参与求交
+        std::uint32_t IntersectPacket(std::span<Ray const> rays, float tMin, std::span<float> tMax, std::span<BVHHit> hits) const;
+
+        // 光线包版本: 返回在 [tMin, tMax[i]] 内被遮挡的光线的位掩码; tMax[i] <= tMin 的光线不参与求交
+        std::uint32_t OccludedPacket(std::span<Ray const> rays, float tMin, std::span<float const> tMax, std::function<bool(BVHHit const &)> const & accept = nullptr) const;
+
+        bool        IsEmpty() const { return _nodes.empty() && _quantized.empty(); }
+        bool        IsQuantized() const { return ! _quantized.empty(); }
+        std::size_t GetNodeCount() const { return _nodes.size() + _quantized.size(); }
+        float       GetBuildTime() const { return _buildTime; } // 毫秒
+        std::size_t GetMemoryUsage() const { return _nodes.size() * sizeof(WideBVHNode) + _quantized.size() * sizeof(QuantizedBVHNode); } // 叶节点的数据属于二叉树
+
+        // 写入/读回缓存文件; 读回时与 Build 一样引用 bvh
+        void Serialize(ByteWriter & writer) const;
+        bool Deserialize(ByteReader & reader, BVH const & bvh);
+
+    private:
+        std::uint32_t Collapse(std::vector<BVHNode> const & nodes, std::uint32_t root);
+        bool          Quantize();
+
+        BVH const *                   _bvh = nullptr;
+        std::vector<WideBVHNode>      _nodes;     // 不压缩时的节点
+        std::vector<QuantizedBVHNode> _quantized; // 压缩时的节点, 两者只有一个非空
+        float                         _buildTime = 0.0f;
+    };
+
+} // namespace VCX::Labs::Rendering
@@ -0,0 +1,1086 @@
+// bench/main.cpp
+// 求交微基准: 在给定模型上比较各加速结构的最近交点与遮挡查询吞吐, 并核对结果是否一致
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+#include "Engine/loader.h"
+#include "Labs/final_hw/BVH.h"
+#include "Labs/final_hw/CacheModel.h"
+#include "Labs/final_hw/InstanceBVH.h"
+#include "Labs/final_hw/Parallel.h"
+#include "Labs/final_hw/PathTracing.h"
+#include "Labs/final_hw/Random.h"
+#include "Labs/final_hw/WideBVH.h"
+#include "Labs/final_hw/tasks.h"
+
+using namespace VCX;
+using namespace VCX::Labs::Rendering;
+
+namespace {
+    struct Options {
+        std::vector<std::filesystem::path> Models;
+        std::size_t                        NumRays { 1 << 20 };
+        int                                Repeats { 3 };
+    };
+
+    void PrintUsage(char const * program) {
+        std::printf(
+            "Usage: %s [model.obj ...] [options]\n"
+            "  models default to assets/models/{arma,dinosaur,fandisk}.obj\n"
+            "  -n, --rays <n>          rays per query type [1048576]\n"
+            "  -r, --repeats <n>       timed passes, the fastest one is reported [3]\n",
+            program);
+    }
+
+    bool ParseOptions(int argc, char ** argv, Options & options) try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view const arg = argv[i];
+            if ((arg == "-n" || arg == "--rays") && i + 1 < argc) options.NumRays = std::stoul(argv[++i]);
+            else if ((arg == "-r" || arg == "--repeats") && i + 1 < argc) options.Repeats = std::stoi(argv[++i]);
+            else if (! arg.empty() && arg[0] != '-') options.Models.emplace_back(arg);
+            else {
+                spdlog::error("VCX::Labs::Rendering::ParseOptions(..): unknown option {}.", arg);
+                return false;
+            }
+        }
+        if (options.Models.empty()) {
+            for (auto const name : { "arma", "dinosaur", "fandisk" })
+                options.Models.emplace_back(std::filesystem::path("assets/models") / (std::string(name) + ".obj"));
+        }
+        return options.NumRays > 0 && options.Repeats > 0;
+    } catch (std::exception const & e) {
+        spdlog::error("VCX::Labs::Rendering::ParseOptions(..): invalid number ({}).", e.what());
+        return false;
+    }
+
+    // 一种被测的加速结构
+    struct Variant {
+        std::string_view                                         Name;
+        std::function<bool(BVHHit &, Ray const &, float, float)> Intersect;
+        std::function<bool(Ray const &, float, float)>           Occluded;
+    };
+
+    // 取多次运行中最快的一次, 返回每秒光线数
+    template<typename Func>
+    double MeasureThroughput(std::size_t const numRays, int const repeats, Func && func) {
+        double best = 0.0;
+        for (int r = 0; r < repeats; ++r) {
+            auto const start = std::chrono::steady_clock::now();
+            func();
+            double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best                 = std::max(best, numRays / seconds);
+        }
+        return best;
+    }
+
+    // 在模型中加入 count 个贯穿单位立方体的细长三角形, 宽度只有长度的 1%. 斜放的三角形包围盒很大,
+    // 和模型本身的小三角形大量重叠, 用来代替仓库中没有的 Sibenik / Sponza 等建筑场景衡量空间划分的效果
+    Engine::SurfaceMesh AddSlivers(Engine::SurfaceMesh mesh, std::size_t const count) {
+        PCG32 rng;
+        rng.Seed(22, 1);
+        auto const NextPoint = [&]() { return glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f; };
+
+        for (std::size_t i = 0; i < count; ++i) {
+            glm::vec3 const a    = NextPoint();
+            glm::vec3 const b    = NextPoint();
+            glm::vec3 const side = 0.01f * glm::length(b - a) * glm::normalize(glm::cross(b - a, NextPoint()));
+            auto const      base = std::uint32_t(mesh.Positions.size());
+            mesh.Positions.insert(mesh.Positions.end(), { a, b, 0.5f * (a + b) + side });
+            mesh.Indices.insert(mesh.Indices.end(), { base, base + 1, base + 2 });
+        }
+        return mesh;
+    }
+    // 当前线程的末级缓存读缺失计数; 没有权限或虚拟机不提供硬件计数器时不可用, Stop 返回 0
+    class CacheMissCounter {
+    public:
+        CacheMissCounter() {
+#if defined(__linux__)
+            perf_event_attr attr {};
+            attr.type           = PERF_TYPE_HW_CACHE;
+            attr.size           = sizeof(attr);
+            attr.config         = PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            _fd                 = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+
+        ~CacheMissCounter() {
+#if defined(__linux__)
+            if (_fd >= 0) close(_fd);
+#endif
+        }
+
+        CacheMissCounter(CacheMissCounter const &)             = delete;
+        CacheMissCounter & operator=(CacheMissCounter const &) = delete;
+
+        bool IsAvailable() const { return _fd >= 0; }
+
+        void Start() {
+#if defined(__linux__)
+            if (_fd < 0) return;
+            ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+
+        std::uint64_t Stop() {
+            std::uint64_t count = 0;
+#if defined(__linux__)
+            if (_fd < 0) return 0;
+            ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(_fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+            return count;
+        }
+
+    private:
+        int _fd = -1;
+    };
+} // namespace
+
+int main(int argc, char ** argv) {
+    Options options;
+    if (! ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    spdlog::set_level(spdlog::level::warn);
+
+    std::printf("%-14s %9s %-8s %12s %12s %10s %10s\n", "model", "triangles", "variant", "closest/s", "occluded/s", "speedup", "mismatch");
+    for (auto const & path : options.Models) {
+        // 模型归一化到单位立方体, 光线从半径为 2 的球面射向立方体内的随机点, 命中与未命中都有
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        if (mesh.Indices.empty()) {
+            spdlog::error("VCX::Labs::Rendering::main(..): failed to load {}.", path.string());
+            return 1;
+        }
+        mesh.NormalizePositions();
+
+        BVH bvh;
+        bvh.Build(mesh);
+        WideBVH wide;
+        wide.Build(bvh);
+        WideBVH quantized;
+        quantized.Build(bvh, true);
+
+        PCG32 rng;
+        rng.Seed(1, 1);
+        std::vector<Ray>   rays;
+        std::vector<float> lengths;
+        rays.reserve(options.NumRays);
+        lengths.reserve(options.NumRays);
+        for (std::size_t i = 0; i < options.NumRays; ++i) {
+            float const     z      = 2.0f * rng.NextFloat() - 1.0f;
+            float const     phi    = 2.0f * glm::pi<float>() * rng.NextFloat();
+            float const     r      = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+            glm::vec3 const origin = 2.0f * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            glm::vec3 const target = glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f;
+            rays.emplace_back(origin, glm::normalize(target - origin));
+            lengths.push_back(glm::length(target - origin));
+        }
+
+        std::vector<Variant> const variants = {
+            { "binary",
+              [&](BVHHit & hit, Ray const & ray, float tMin, float tMax) { return bvh.Intersect(hit, ray, tMin, tMax); },
+              [&](Ray const & ray, float tMin, float tMax) { return bvh.Occluded(ray, tMin, tMax); } },
+            { "bvh4",
+              [&](BVHHit & hit, Ray const & ray, float tMin, float tMax) { return wide.Intersect(hit, ray, tMin, tMax); },
+              [&](Ray const & ray, float tMin, float tMax) { return wide.Occluded(ray, tMin, tMax); } },
+            { "bvh4-q",
+              [&](BVHHit & hit, Ray const & ray, float tMin, float tMax) { return quantized.Intersect(hit, ray, tMin, tMax); },
+              [&](Ray const & ray, float tMin, float tMax) { return quantized.Occluded(ray, tMin, tMax); } },
+        };
+
+        // 第一个变体作为基准, 其余变体的结果逐条与之比较
+        std::vector<BVHHit> reference(rays.size());
+        std::vector<char>   referenceFound(rays.size()), referenceOccluded(rays.size());
+        double              baseline = 0.0;
+        for (std::size_t v = 0; v < variants.size(); ++v) {
+            auto const &        variant = variants[v];
+            std::vector<BVHHit> hits(rays.size());
+            std::vector<char>   found(rays.size()), occluded(rays.size());
+
+            double const closest = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) found[i] = variant.Intersect(hits[i], rays[i], 0.0f, 1e7f);
+            });
+            double const shadow = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) occluded[i] = variant.Occluded(rays[i], 0.0f, lengths[i]);
+            });
+
+            std::size_t mismatches = 0;
+            if (v == 0) {
+                reference         = hits;
+                referenceFound    = found;
+                referenceOccluded = occluded;
+                baseline          = closest;
+            } else {
+                for (std::size_t i = 0; i < rays.size(); ++i) {
+                    bool const same = found[i] == referenceFound[i] && occluded[i] == referenceOccluded[i]
+                        && (! found[i] || glm::abs(hits[i].T - reference[i].T) <= 1e-5f * reference[i].T);
+                    mismatches += ! same;
+                }
+            }
+            std::printf(
+                "%-14s %9zu %-8s %11.2fM %11.2fM %9.2fx %10zu\n",
+                path.stem().string().c_str(),
+                bvh.GetInputCount(),
+                std::string(variant.Name).c_str(),
+                closest * 1e-6,
+                shadow * 1e-6,
+                closest / baseline,
+                mismatches);
+        }
+    }
+
+    // 三角形求交核心: 每条光线与图元顺序中连续的 c_Span 个三角形求交 (相当于遍历到的若干叶节点),
+    // 比较逐个收集顶点的 IntersectTriangle 与预计算的 SoA 数据
+    constexpr std::uint32_t c_Span = 64;
+    std::printf("\n%-14s %16s %16s %10s %10s\n", "model", "gather tris/s", "soa tris/s", "speedup", "mismatch");
+    for (auto const & path : options.Models) {
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        mesh.NormalizePositions();
+        BVH bvh;
+        bvh.Build(mesh);
+        auto const & prims = bvh.GetPrimitives();
+        auto const & tris  = bvh.GetTriangles();
+        if (prims.size() < c_Span) continue;
+
+        std::size_t const numRays = std::max<std::size_t>(1, options.NumRays / c_Span);
+        PCG32             rng;
+        rng.Seed(2, 1);
+        std::vector<Ray>           rays;
+        std::vector<std::uint32_t> firsts;
+        for (std::size_t i = 0; i < numRays; ++i) {
+            firsts.push_back(rng.NextUInt() % std::uint32_t(prims.size() - c_Span + 1));
+            glm::vec3 const target = mesh.Positions[mesh.Indices[prims[firsts.back() + c_Span / 2]]];
+            glm::vec3 const origin = target + 2.0f * (glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f);
+            rays.emplace_back(origin, target - origin);
+        }
+
+        std::size_t  gatherHits = 0, soaHits = 0;
+        double const gather     = MeasureThroughput(numRays * c_Span, options.Repeats, [&]() {
+            gatherHits = 0;
+            Intersection its;
+            for (std::size_t r = 0; r < numRays; ++r) {
+                for (std::uint32_t i = firsts[r]; i < firsts[r] + c_Span; ++i) {
+                    std::uint32_t const * face = mesh.Indices.data() + prims[i];
+                    gatherHits += IntersectTriangle(its, rays[r], mesh.Positions[face[0]], mesh.Positions[face[1]], mesh.Positions[face[2]]) && its.t >= 0.0f;
+                }
+            }
+        });
+        double const soa = MeasureThroughput(numRays * c_Span, options.Repeats, [&]() {
+            soaHits = 0;
+            float t[TriangleSoA::c_Lanes], u[TriangleSoA::c_Lanes], v[TriangleSoA::c_Lanes];
+            for (std::size_t r = 0; r < numRays; ++r) {
+                TriangleRay const ray(rays[r].Origin, glm::normalize(rays[r].Direction));
+                for (std::uint32_t i = firsts[r]; i < firsts[r] + c_Span; i += TriangleSoA::c_Lanes)
+                    soaHits += std::popcount(unsigned(IntersectTriangles(tris, i, TriangleSoA::c_Lanes, ray, 0.0f, 1e7f, t, u, v)));
+            }
+        });
+        std::printf(
+            "%-14s %15.1fM %15.1fM %9.2fx %10zu\n",
+            path.stem().string().c_str(),
+            gather * 1e-6,
+            soa * 1e-6,
+            soa / gather,
+            gatherHits > soaHits ? gatherHits - soaHits : soaHits - gatherHits);
+    }
+
+    // 光线包: 256x256 的相机光线按 4x4 像素块成包, 阴影光线从命中点射向同一点光源
+    constexpr std::size_t c_Resolution = 256, c_Block = 4;
+    std::printf("\n%-14s %16s %16s %16s %16s %10s\n", "model", "single closest/s", "packet closest/s", "single shadow/s", "packet shadow/s", "mismatch");
+    for (auto const & path : options.Models) {
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        mesh.NormalizePositions();
+        BVH bvh;
+        bvh.Build(mesh);
+        WideBVH wide;
+        wide.Build(bvh);
+
+        glm::vec3 const eye(0.3f, 0.4f, 1.6f), light(-1.0f, 2.0f, 1.0f);
+        glm::vec3 const look  = glm::normalize(-eye);
+        glm::vec3 const right = glm::normalize(glm::cross(look, glm::vec3(0, 1, 0)));
+        glm::vec3 const up    = glm::cross(right, look);
+        std::vector<Ray> rays;
+        for (std::size_t by = 0; by < c_Resolution; by += c_Block)
+            for (std::size_t bx = 0; bx < c_Resolution; bx += c_Block)
+                for (std::size_t k = 0; k < c_Block * c_Block; ++k) {
+                    float const x = (bx + k % c_Block + 0.5f) / c_Resolution * 2.0f - 1.0f;
+                    float const y = (by + k / c_Block + 0.5f) / c_Resolution * 2.0f - 1.0f;
+                    rays.emplace_back(eye, glm::normalize(look + 0.5f * (x * right + y * up)));
+                }
+
+        std::size_t const   packet = c_Block * c_Block;
+        std::vector<BVHHit> single(rays.size()), packed(rays.size());
+        std::vector<char>   singleFound(rays.size()), packedFound(rays.size());
+        double const        closestSingle = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); ++i) singleFound[i] = wide.Intersect(single[i], rays[i], 0.0f, 1e7f);
+        });
+        double const        closestPacket = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); i += packet) {
+                float tMax[c_Block * c_Block];
+                std::fill(std::begin(tMax), std::end(tMax), 1e7f);
+                std::uint32_t const found = wide.IntersectPacket(std::span(rays).subspan(i, packet), 0.0f, tMax, std::span(packed).subspan(i, packet));
+                for (std::size_t k = 0; k < packet; ++k) packedFound[i + k] = found >> k & 1;
+            }
+        });
+
+        std::vector<Ray>   shadowRays(rays.size());
+        std::vector<float> shadowDistances(rays.size(), 0.0f);
+        for (std::size_t i = 0; i < rays.size(); ++i) {
+            if (! singleFound[i]) continue;
+            glm::vec3 const p = rays[i].Origin + single[i].T * rays[i].Direction;
+            shadowRays[i]     = Ray(p, light - p);
+            shadowDistances[i] = glm::length(light - p) - 1e-3f;
+        }
+        std::vector<char> singleOccluded(rays.size()), packedOccluded(rays.size());
+        double const      shadowSingle = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); ++i) singleOccluded[i] = shadowDistances[i] > 1e-3f && wide.Occluded(shadowRays[i], 1e-3f, shadowDistances[i]);
+        });
+        double const      shadowPacket = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); i += packet) {
+                std::uint32_t const occluded = wide.OccludedPacket(std::span(shadowRays).subspan(i, packet), 1e-3f, std::span(shadowDistances).subspan(i, packet));
+                for (std::size_t k = 0; k < packet; ++k) packedOccluded[i + k] = occluded >> k & 1;
+            }
+        });
+
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < rays.size(); ++i)
+            mismatches += singleFound[i] != packedFound[i] || singleOccluded[i] != packedOccluded[i] || (singleFound[i] && single[i].T != packed[i].T);
+        std::printf(
+            "%-14s %15.2fM %15.2fM %15.2fM %15.2fM %10zu\n",
+            path.stem().string().c_str(),
+            closestSingle * 1e-6,
+            closestPacket * 1e-6,
+            shadowSingle * 1e-6,
+            shadowPacket * 1e-6,
+            mismatches);
+    }
+
+    // 实例化: 同一模型的 c_Grid x c_Grid 个副本 (随机绕 y 轴旋转并缩放), 比较把副本烘焙进一个网格的单层 BVH
+    // 与共享一棵底层 BVH 的两层结构; "update" 为移动一个副本后重建所需的时间
+    constexpr int c_Grid = 8;
+    std::printf("\n%-14s %7s %-9s %10s %10s %12s %10s %10s\n", "model", "copies", "variant", "build ms", "memory MB", "closest/s", "update ms", "mismatch");
+    for (auto const & path : options.Models) {
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        mesh.NormalizePositions();
+
+        Engine::Scene scene;
+        scene.Materials.emplace_back().Blend = Engine::BlendMode::Opaque;
+        scene.Meshes.push_back(mesh);
+        PCG32 rng;
+        rng.Seed(4, 1);
+        for (int i = 0; i < c_Grid * c_Grid; ++i) {
+            float const     angle = 2.0f * glm::pi<float>() * rng.NextFloat();
+            float const     scale = 0.6f + 0.4f * rng.NextFloat();
+            Engine::Model & model = scene.Models.emplace_back();
+            model.MeshIndex       = 0;
+            model.Transform       = glm::mat4(
+                scale * std::cos(angle), 0.0f, -scale * std::sin(angle), 0.0f,
+                0.0f, scale, 0.0f, 0.0f,
+                scale * std::sin(angle), 0.0f, scale * std::cos(angle), 0.0f,
+                1.5f * (i % c_Grid), 0.0f, 1.5f * (i / c_Grid), 1.0f);
+        }
+
+        // 单层: 所有副本烘焙到世界空间后合并为一个网格
+        auto const BakeAll = [&]() {
+            Engine::SurfaceMesh baked;
+            for (auto const & model : scene.Models) {
+                auto const base = std::uint32_t(baked.Positions.size());
+                for (auto const & p : mesh.Positions) baked.Positions.push_back(glm::vec3(model.Transform * glm::vec4(p, 1.0f)));
+                for (auto const idx : mesh.Indices) baked.Indices.push_back(base + idx);
+            }
+            return baked;
+        };
+        Engine::SurfaceMesh flatMesh;
+        BVH                 flat;
+        WideBVH             flatWide;
+        auto const          BuildFlat = [&]() {
+            auto const start = std::chrono::steady_clock::now();
+            flatMesh         = BakeAll();
+            flat.Build(flatMesh);
+            flatWide.Build(flat);
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+        double const flatBuild = BuildFlat();
+
+        SceneSnapshot snapshot;
+        snapshot.Build(scene);
+        InstanceBVH  instanced;
+        auto const   start          = std::chrono::steady_clock::now();
+        instanced.Build(snapshot);
+        double const instancedBuild = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // 光线从场景上方的随机点射向副本所在平面上的随机点
+        glm::vec3 const  extent(1.5f * c_Grid, 1.0f, 1.5f * c_Grid);
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < options.NumRays; ++i) {
+            glm::vec3 const origin = glm::vec3(rng.NextFloat(), 2.0f, rng.NextFloat()) * extent;
+            glm::vec3 const target = glm::vec3(rng.NextFloat(), 0.0f, rng.NextFloat()) * extent - glm::vec3(0.75f, 0.0f, 0.75f);
+            rays.emplace_back(origin, glm::normalize(target - origin));
+        }
+        std::vector<BVHHit> flatHits(rays.size()), instancedHits(rays.size());
+        std::vector<char>   flatFound(rays.size()), instancedFound(rays.size());
+        double const        flatRate      = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); ++i) flatFound[i] = flatWide.Intersect(flatHits[i], rays[i], 0.0f, 1e7f);
+        });
+        double const        instancedRate = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+            for (std::size_t i = 0; i < rays.size(); ++i) instancedFound[i] = instanced.Intersect(instancedHits[i], rays[i], 0.0f, 1e7f);
+        });
+        // 烘焙后的顶点与物体空间中的顶点舍入不同, 交点距离允许有微小差异
+        std::size_t mismatches = 0;
+        for (std::size_t i = 0; i < rays.size(); ++i)
+            mismatches += flatFound[i] != instancedFound[i] || (flatFound[i] && glm::abs(flatHits[i].T - instancedHits[i].T) > 1e-4f * flatHits[i].T);
+
+        // 移动一个副本: 单层结构需要重新烘焙并整体重建, 两层结构只重建顶层
+        scene.Models[0].Transform[3] += glm::vec4(0.0f, 0.5f, 0.0f, 0.0f);
+        double const flatUpdate      = BuildFlat();
+        auto const   updateStart     = std::chrono::steady_clock::now();
+        snapshot.UpdateTransforms(scene);
+        instanced.BuildTopLevel();
+        double const instancedUpdate = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - updateStart).count();
+
+        auto const name = path.stem().string();
+        std::printf("%-14s %7d %-9s %10.1f %10.1f %11.2fM %10.2f %10s\n", name.c_str(), c_Grid * c_Grid, "flat", flatBuild, (flat.GetMemoryUsage() + flatWide.GetMemoryUsage()) / 1048576.0, flatRate * 1e-6, flatUpdate, "");
+        std::printf("%-14s %7d %-9s %10.1f %10.1f %11.2fM %10.2f %10zu\n", name.c_str(), c_Grid * c_Grid, "instanced", instancedBuild, instanced.GetMemoryUsage() / 1048576.0, instancedRate * 1e-6, instancedUpdate, mismatches);
+    }
+
+    // 形变: 模型绕 y 轴扭转, 转角与高度成正比, 拓扑不变. 同一棵在静止姿态构建的树逐级 Refit,
+    // 与对形变后的网格完全重建比较; "SAH ratio" 为 Refit 后与重建后的 SAH 代价之比, "degraded" 为 IsDegraded 的判断
+    std::printf("\n%-14s %6s %10s %10s %10s %12s %12s %9s %10s\n", "model", "twist", "refit ms", "build ms", "SAH ratio", "refit ray/s", "build ray/s", "degraded", "mismatch");
+    for (auto const & path : options.Models) {
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        mesh.NormalizePositions();
+        Engine::SurfaceMesh deformed = mesh;
+
+        BVH refit;
+        refit.Build(mesh);
+        WideBVH refitWide;
+
+        PCG32 rng;
+        rng.Seed(5, 1);
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < options.NumRays; ++i) {
+            float const     z      = 2.0f * rng.NextFloat() - 1.0f;
+            float const     phi    = 2.0f * glm::pi<float>() * rng.NextFloat();
+            float const     r      = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+            glm::vec3 const origin = 2.0f * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            glm::vec3 const target = glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f;
+            rays.emplace_back(origin, glm::normalize(target - origin));
+        }
+
+        for (float const twist : { 0.25f, 0.5f, 1.0f, 2.0f, 4.0f }) { // 单位高度上的转角 (弧度)
+            for (std::size_t i = 0; i < mesh.Positions.size(); ++i) {
+                glm::vec3 const p = mesh.Positions[i];
+                float const     c = std::cos(twist * p.y), s = std::sin(twist * p.y);
+                deformed.Positions[i] = glm::vec3(c * p.x - s * p.z, p.y, s * p.x + c * p.z);
+            }
+            refit.Refit(deformed);
+            refitWide.Build(refit);
+            BVH rebuilt;
+            rebuilt.Build(deformed);
+            WideBVH rebuiltWide;
+            rebuiltWide.Build(rebuilt);
+
+            std::vector<BVHHit> refitHits(rays.size()), rebuiltHits(rays.size());
+            std::vector<char>   refitFound(rays.size()), rebuiltFound(rays.size());
+            double const        refitRate   = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) refitFound[i] = refitWide.Intersect(refitHits[i], rays[i], 0.0f, 1e7f);
+            });
+            double const        rebuiltRate = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) rebuiltFound[i] = rebuiltWide.Intersect(rebuiltHits[i], rays[i], 0.0f, 1e7f);
+            });
+            std::size_t mismatches = 0;
+            for (std::size_t i = 0; i < rays.size(); ++i)
+                mismatches += refitFound[i] != rebuiltFound[i] || (refitFound[i] && glm::abs(refitHits[i].T - rebuiltHits[i].T) > 1e-5f * rebuiltHits[i].T);
+
+            auto const name = path.stem().string();
+            std::printf(
+                "%-14s %6.2f %10.2f %10.2f %10.2f %11.2fM %11.2fM %9s %10zu\n",
+                name.c_str(),
+                twist,
+                refit.GetRefitTime() + refitWide.GetBuildTime(),
+                rebuilt.GetBuildTime() + rebuiltWide.GetBuildTime(),
+                refit.GetSAHCost() / rebuilt.GetSAHCost(),
+                refitRate * 1e-6,
+                rebuiltRate * 1e-6,
+                refit.IsDegraded() ? "yes" : "no",
+                mismatches);
+        }
+    }
+
+    // 构建算法: 同一模型分别以 SAH, SBVH, LBVH 与 LBVH + treelet 重排构建, "build ms" 为二叉树多次构建中最快的一次,
+    // "refs" 为叶节点中的三角形引用数与三角形数之比; 光线在收缩后的 4 叉树上求最近交点, 结果与 SAH 逐条比较,
+    // "nodes" 与 "tris" 为每条光线访问的 4 叉节点数与求交的三角形数. 最后在第一个模型中加入 1% 的细长三角形再测一次
+    std::vector<std::pair<std::string, Engine::SurfaceMesh>> meshes;
+    for (auto const & path : options.Models) {
+        Engine::SurfaceMesh mesh = Engine::LoadSurfaceMesh(path);
+        mesh.NormalizePositions();
+        meshes.emplace_back(path.stem().string(), std::move(mesh));
+    }
+    meshes.emplace_back(meshes.front().first + "+slivers", AddSlivers(meshes.front().second, meshes.front().second.Indices.size() / 300));
+
+    std::printf(
+        "\n%-18s %-22s %10s %10s %6s %12s %8s %8s %10s\n", "model", "builder", "build ms", "SAH cost", "refs", "closest/s", "nodes", "tris", "mismatch");
+    for (auto const & [name, mesh] : meshes) {
+        PCG32 rng;
+        rng.Seed(6, 1);
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < options.NumRays; ++i) {
+            float const     z      = 2.0f * rng.NextFloat() - 1.0f;
+            float const     phi    = 2.0f * glm::pi<float>() * rng.NextFloat();
+            float const     r      = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+            glm::vec3 const origin = 2.0f * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            glm::vec3 const target = glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f;
+            rays.emplace_back(origin, glm::normalize(target - origin));
+        }
+
+        std::vector<BVHHit> reference(rays.size());
+        std::vector<char>   referenceFound(rays.size());
+        for (auto const mode : { BVHBuildMode::SAH, BVHBuildMode::SBVH, BVHBuildMode::LBVH, BVHBuildMode::LBVHTreelet }) {
+            BVH   bvh;
+            float buildTime = std::numeric_limits<float>::max();
+            for (int r = 0; r < options.Repeats; ++r) {
+                bvh.Build(mesh, mode);
+                buildTime = std::min(buildTime, bvh.GetBuildTime());
+            }
+            WideBVH wide;
+            wide.Build(bvh);
+
+            std::vector<BVHHit> hits(rays.size());
+            std::vector<char>   found(rays.size());
+            double const        rate = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) found[i] = wide.Intersect(hits[i], rays[i], 0.0f, 1e7f);
+            });
+            TraversalStats stats;
+            for (auto const & ray : rays) {
+                BVHHit hit;
+                wide.Intersect(hit, ray, 0.0f, 1e7f, stats);
+            }
+            std::size_t mismatches = 0;
+            if (mode == BVHBuildMode::SAH) {
+                reference      = hits;
+                referenceFound = found;
+            } else {
+                for (std::size_t i = 0; i < rays.size(); ++i)
+                    mismatches += found[i] != referenceFound[i] || (found[i] && glm::abs(hits[i].T - reference[i].T) > 1e-5f * reference[i].T);
+            }
+
+            std::printf(
+                "%-18s %-22s %10.2f %10.2f %6.2f %11.2fM %8.2f %8.2f %10zu\n",
+                name.c_str(),
+                GetBVHBuildModeName(mode),
+                buildTime,
+                bvh.GetSAHCost(),
+                double(bvh.GetPrimitives().size()) / bvh.GetInputCount(),
+                rate * 1e-6,
+                double(stats.Nodes) / rays.size(),
+                double(stats.Triangles) / rays.size(),
+                mismatches);
+        }
+    }
+
+    // 并行构建: 同一模型分别用 1 个线程与 max(4, 硬件线程数) 个线程构建, 节点与图元数组须逐字节相同;
+    // "serial ms" 与 "parallel ms" 为多次构建中最快的一次. 线程数多于核数时只能验证结果, 加速比没有意义
+    {
+        std::size_t const numThreads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+        std::printf(
+            "\n%-18s %-22s %8s %10s %12s %8s %10s\n", "model", "builder", "threads", "serial ms", "parallel ms", "speedup", "identical");
+        for (auto const & [name, mesh] : meshes) {
+            for (auto const mode : { BVHBuildMode::SAH, BVHBuildMode::LBVH, BVHBuildMode::LBVHTreelet }) {
+                BVH   serial, parallel;
+                float serialTime = std::numeric_limits<float>::max(), parallelTime = std::numeric_limits<float>::max();
+                for (int r = 0; r < options.Repeats; ++r) {
+                    SetThreadCount(1);
+                    serial.Build(mesh, mode);
+                    serialTime = std::min(serialTime, serial.GetBuildTime());
+                    SetThreadCount(numThreads);
+                    parallel.Build(mesh, mode);
+                    parallelTime = std::min(parallelTime, parallel.GetBuildTime());
+                }
+                SetThreadCount(0);
+
+                auto const SameBytes = [](auto const & a, auto const & b) {
+                    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(a[0])) == 0;
+                };
+                bool const identical = SameBytes(serial.GetNodes(), parallel.GetNodes()) && SameBytes(serial.GetPrimitives(), parallel.GetPrimitives());
+                std::printf(
+                    "%-18s %-22s %8zu %10.2f %12.2f %7.2fx %10s\n",
+                    name.c_str(),
+                    GetBVHBuildModeName(mode),
+                    numThreads,
+                    serialTime,
+                    parallelTime,
+                    serialTime / parallelTime,
+                    identical ? "yes" : "no");
+            }
+        }
+    }
+
+    // 并行 Refit: 场景中只有一个模型, 顶点按形变一节的方式扭转后经 BVHRayIntersector::UpdateGeometry 更新底层与顶层,
+    // 分别用 1 个线程与 max(4, 硬件线程数) 个线程; 每次计时前重新 InitScene, 使两边都从静止姿态构建的树开始 Refit.
+    // "serial ms" 与 "parallel ms" 为多次更新中最快的一次, "identical" 为更新后两边对同一组光线的最近交点是否逐位相同
+    {
+        std::size_t const numThreads = std::max<std::size_t>(4, std::thread::hardware_concurrency());
+        std::printf(
+            "\n%-18s %6s %8s %10s %12s %8s %10s\n", "model", "twist", "threads", "serial ms", "parallel ms", "speedup", "identical");
+        for (auto const & [name, mesh] : meshes) {
+            Engine::Scene scene;
+            scene.Materials.emplace_back();
+            scene.Meshes.push_back(mesh);
+            scene.Models.emplace_back().MeshIndex = 0;
+
+            PCG32 rng;
+            rng.Seed(6, 1);
+            std::vector<Ray> rays;
+            for (std::size_t i = 0; i < options.NumRays; ++i) {
+                float const     z      = 2.0f * rng.NextFloat() - 1.0f;
+                float const     phi    = 2.0f * glm::pi<float>() * rng.NextFloat();
+                float const     r      = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+                glm::vec3 const origin = 2.0f * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+                glm::vec3 const target = glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f;
+                rays.emplace_back(origin, glm::normalize(target - origin));
+            }
+
+            for (float const twist : { 0.25f, 1.0f }) {
+                RayIntersector serial, parallel;
+                double         serialTime = std::numeric_limits<double>::max(), parallelTime = std::numeric_limits<double>::max();
+                for (int r = 0; r < options.Repeats; ++r) {
+                    for (auto * const intersector : { &serial, &parallel }) {
+                        scene.Meshes[0].Positions = mesh.Positions;
+                        intersector->InitScene(&scene);
+                        for (std::size_t i = 0; i < mesh.Positions.size(); ++i) {
+                            glm::vec3 const p = mesh.Positions[i];
+                            float const     c = std::cos(twist * p.y), s = std::sin(twist * p.y);
+                            scene.Meshes[0].Positions[i] = glm::vec3(c * p.x - s * p.z, p.y, s * p.x + c * p.z);
+                        }
+                        bool const isSerial = intersector == &serial;
+                        SetThreadCount(isSerial ? 1 : numThreads);
+                        auto const start = std::chrono::steady_clock::now();
+                        intersector->UpdateGeometry(0);
+                        double const time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                        double &     best = isSerial ? serialTime : parallelTime;
+                        best              = std::min(best, time);
+                    }
+                }
+                SetThreadCount(0);
+
+                bool identical = true;
+                for (auto const & ray : rays) {
+                    BVHHit     serialHit {}, parallelHit {};
+                    bool const serialFound   = serial.InternalBVH.Intersect(serialHit, ray, 0.0f, 1e7f);
+                    bool const parallelFound = parallel.InternalBVH.Intersect(parallelHit, ray, 0.0f, 1e7f);
+                    identical                = identical && serialFound == parallelFound && std::memcmp(&serialHit, &parallelHit, sizeof(BVHHit)) == 0;
+                }
+                std::printf(
+                    "%-18s %6.2f %8zu %10.2f %12.2f %7.2fx %10s\n",
+                    name.c_str(),
+                    twist,
+                    numThreads,
+                    serialTime,
+                    parallelTime,
+                    serialTime / parallelTime,
+                    identical ? "yes" : "no");
+            }
+        }
+    }
+
+    // 节点布局: 同一棵二叉树收缩为不压缩与量化的 4 叉树, 比较节点占用的内存, 每条光线访问的节点数与最近交点吞吐.
+    // 最后把第一个模型平铺 2x2x2 份合成一个大网格, 节点数据远超 L2/L3, 遍历受内存带宽限制
+    meshes.resize(options.Models.size());
+    {
+        Engine::SurfaceMesh tiled;
+        auto const &        source = meshes.front().second;
+        for (int k = 0; k < 8; ++k) {
+            glm::vec3 const     offset = glm::vec3(k & 1, k >> 1 & 1, k >> 2) - 0.5f;
+            std::uint32_t const base   = std::uint32_t(tiled.Positions.size());
+            for (auto const & p : source.Positions) tiled.Positions.push_back(0.5f * (p + offset));
+            for (auto const i : source.Indices) tiled.Indices.push_back(base + i);
+        }
+        meshes.emplace_back(meshes.front().first + " x8", std::move(tiled));
+    }
+    std::printf("\n%-14s %-8s %10s %12s %8s %12s %10s\n", "model", "layout", "nodes MB", "build ms", "nodes", "closest/s", "mismatch");
+    for (auto const & [name, mesh] : meshes) {
+        PCG32 rng;
+        rng.Seed(7, 1);
+        std::vector<Ray> rays;
+        for (std::size_t i = 0; i < options.NumRays; ++i) {
+            float const     z      = 2.0f * rng.NextFloat() - 1.0f;
+            float const     phi    = 2.0f * glm::pi<float>() * rng.NextFloat();
+            float const     r      = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+            glm::vec3 const origin = 2.0f * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            glm::vec3 const target = glm::vec3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) - 0.5f;
+            rays.emplace_back(origin, glm::normalize(target - origin));
+        }
+
+        BVH bvh;
+        bvh.Build(mesh);
+        std::vector<BVHHit> reference(rays.size());
+        std::vector<char>   referenceFound(rays.size());
+        for (bool const quantize : { false, true }) {
+            WideBVH wide;
+            float   buildTime = std::numeric_limits<float>::max();
+            for (int r = 0; r < options.Repeats; ++r) {
+                wide.Build(bvh, quantize);
+                buildTime = std::min(buildTime, wide.GetBuildTime());
+            }
+
+            std::vector<BVHHit> hits(rays.size());
+            std::vector<char>   found(rays.size());
+            double const        rate = MeasureThroughput(rays.size(), options.Repeats, [&]() {
+                for (std::size_t i = 0; i < rays.size(); ++i) found[i] = wide.Intersect(hits[i], rays[i], 0.0f, 1e7f);
+            });
+            TraversalStats stats;
+            for (auto const & ray : rays) {
+                BVHHit hit;
+                wide.Intersect(hit, ray, 0.0f, 1e7f, stats);
+            }
+            std::size_t mismatches = 0;
+            if (! quantize) {
+                reference      = hits;
+                referenceFound = found;
+            } else {
+                // 量化只放大包围盒, 交点应与不压缩时逐位相同
+                for (std::size_t i = 0; i < rays.size(); ++i)
+                    mismatches += found[i] != referenceFound[i] || (found[i] && (hits[i].T != reference[i].T || hits[i].FaceIndex != reference[i].FaceIndex));
+            }
+
+            std::printf(
+                "%-14s %-8s %10.2f %12.2f %8.2f %11.2fM %10zu\n",
+                name.c_str(),
+                wide.IsQuantized() ? "quant8" : "float",
+                wide.GetMemoryUsage() / 1048576.0,
+                buildTime,
+                double(stats.Nodes) / rays.size(),
+                rate * 1e-6,
+                mismatches);
+        }
+    }
+
+    // 稳健性: 模型缩放到毫米级, 单位大小与 800 单位 (平移同样的距离) 的场景. 光线穿过随机一条边的中点, 边两侧的三角形
+    // 朝向光线的同一侧, 光线必然穿过表面, 没有命中任何三角形即为从公共边的裂缝漏过 ("leaks"); 擦过轮廓边的光线不计.
+    // 再从命中点沿随机方向发出次级光线, 起点按误差上界偏移, "self hits" 为又命中出发三角形的次数,
+    // "near hits" 为交点距离小于 0.01 的比例, 即固定的 0.01 偏移会错过的遮挡
+    std::printf("\n%-14s %8s %10s %8s %10s %10s %10s\n", "model", "scale", "edge rays", "leaks", "spawned", "self hits", "near hits");
+    for (std::size_t m = 0; m < options.Models.size(); ++m) {
+        auto const & [name, mesh] = meshes[m];
+
+        // 每条边两侧的三角形
+        std::unordered_map<std::uint64_t, std::pair<std::uint32_t, std::uint32_t>> edgeFaces;
+        auto const EdgeKey = [&](std::uint32_t const face, std::uint32_t const edge) {
+            std::uint32_t const a = mesh.Indices[face + edge], b = mesh.Indices[face + (edge + 1) % 3];
+            return std::uint64_t(std::min(a, b)) << 32 | std::max(a, b);
+        };
+        for (std::uint32_t face = 0; face < mesh.Indices.size(); face += 3) {
+            for (std::uint32_t edge = 0; edge < 3; ++edge) {
+                auto [it, inserted] = edgeFaces.try_emplace(EdgeKey(face, edge), face, ~0u);
+                if (! inserted) it->second.second = face;
+            }
+        }
+
+        for (float const scale : { 1e-3f, 1.0f, 800.0f }) {
+            Engine::Scene scene;
+            scene.Materials.emplace_back().Blend = Engine::BlendMode::Opaque;
+            scene.Meshes.push_back(mesh);
+            Engine::Model & model = scene.Models.emplace_back();
+            model.MeshIndex       = 0;
+            model.Transform       = glm::mat4(
+                scale, 0.0f, 0.0f, 0.0f,
+                0.0f, scale, 0.0f, 0.0f,
+                0.0f, 0.0f, scale, 0.0f,
+                scale, scale, scale, 1.0f);
+            SceneSnapshot snapshot;
+            snapshot.Build(scene);
+            InstanceBVH instanced;
+            instanced.Build(snapshot);
+
+            PCG32 rng;
+            rng.Seed(8, 1);
+            auto const NextDirection = [&]() {
+                float const z   = 2.0f * rng.NextFloat() - 1.0f;
+                float const phi = 2.0f * glm::pi<float>() * rng.NextFloat();
+                float const r   = std::sqrt(glm::max(0.0f, 1.0f - z * z));
+                return glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+            };
+            auto const ToWorld    = [&](std::uint32_t const idx) { return glm::vec3(model.Transform * glm::vec4(mesh.Positions[idx], 1.0f)); };
+            auto const FaceNormal = [&](std::uint32_t const face) {
+                glm::vec3 const p0 = ToWorld(mesh.Indices[face]);
+                return glm::cross(ToWorld(mesh.Indices[face + 1]) - p0, ToWorld(mesh.Indices[face + 2]) - p0);
+            };
+
+            std::size_t edgeRays = 0, leaks = 0, spawned = 0, selfHits = 0, nearHits = 0;
+            for (std::size_t i = 0; i < options.NumRays / 4; ++i) {
+                std::uint32_t const face   = 3 * (rng.NextUInt() % std::uint32_t(mesh.Indices.size() / 3));
+                std::uint32_t const edge   = rng.NextUInt() % 3;
+                auto const [first, second] = edgeFaces[EdgeKey(face, edge)];
+                glm::vec3 const dir        = NextDirection();
+                if (second == ~0u || (glm::dot(dir, FaceNormal(first)) > 0.0f) != (glm::dot(dir, FaceNormal(second)) > 0.0f)) continue;
+
+                glm::vec3 const target = 0.5f * (ToWorld(mesh.Indices[face + edge]) + ToWorld(mesh.Indices[face + (edge + 1) % 3]));
+                Ray const       ray(target - 2.0f * scale * dir, dir);
+                BVHHit          hit;
+                ++edgeRays;
+                if (! instanced.Intersect(hit, ray, 0.0f, 1e7f)) {
+                    ++leaks;
+                    continue;
+                }
+
+                RayHit const    rayHit = ShadeRayHit(snapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V, ray, hit.T);
+                glm::vec3 const next   = NextDirection();
+                BVHHit          nextHit;
+                ++spawned;
+                if (! instanced.Intersect(nextHit, Ray(SpawnRayOrigin(rayHit, next), next), 0.0f, 1e7f)) continue;
+                selfHits += nextHit.FaceIndex == hit.FaceIndex;
+                nearHits += nextHit.T < 0.01f;
+            }
+            std::printf("%-14s %8g %10zu %8zu %10zu %10zu %9.2f%%\n", name.c_str(), scale, edgeRays, leaks, spawned, selfHits, 100.0 * nearHits / std::max<std::size_t>(spawned, 1));
+        }
+    }
+    // 波前: 封闭房间里摆放各模型与 "x8" 大网格, 材质全部为反照率 0.8 的漫反射, 点光源照明, 光线反弹后方向杂乱.
+    // 逐像素逐样本深度优先地调用 PathTrace, 与按 16x16 图块一起推进的 PathTraceWavefront 比较, "wavefront-u" 不排序光线.
+    // "rays/s" 与每条光线的统计只计最近交点光线 (不含阴影光线); "L1/L2 sim" 为按追踪顺序把节点与三角形数据的缓存行
+    // 送入 32 KiB 与 2 MiB 的 LRU 缓存模型得到的缺失数, "LLC miss/ray" 为硬件计数的末级缓存读缺失数, 计数器不可用时为 n/a
+    {
+        constexpr std::size_t c_Image = 128, c_Tile = 16;
+        constexpr int         c_Spp = 16, c_Bounces = 5;
+
+        Engine::Scene scene;
+        auto &        material = scene.Materials.emplace_back();
+        material.Blend         = Engine::BlendMode::Opaque;
+        material.Albedo.Fill(glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
+        material.MetaSpec.Fill(glm::vec4(0.0f));
+
+        // 房间的六个面各用独立的顶点, 法线不在棱上被平均
+        Engine::SurfaceMesh room;
+        glm::vec3 const     roomMin(-3.5f, 0.0f, -3.5f), roomMax(3.5f, 4.0f, 3.5f);
+        for (int axis = 0; axis < 3; ++axis) {
+            for (int side = 0; side < 2; ++side) {
+                glm::vec3 corners[4];
+                for (int k = 0; k < 4; ++k) {
+                    glm::vec3 p;
+                    p[axis]           = side ? roomMax[axis] : roomMin[axis];
+                    p[(axis + 1) % 3] = (k & 1) ? roomMax[(axis + 1) % 3] : roomMin[(axis + 1) % 3];
+                    p[(axis + 2) % 3] = (k >> 1) ? roomMax[(axis + 2) % 3] : roomMin[(axis + 2) % 3];
+                    corners[k]        = p;
+                }
+                std::uint32_t const base = std::uint32_t(room.Positions.size());
+                room.Positions.insert(room.Positions.end(), std::begin(corners), std::end(corners));
+                room.Indices.insert(room.Indices.end(), { base, base + 1, base + 3, base, base + 3, base + 2 });
+            }
+        }
+        scene.Meshes.push_back(std::move(room));
+        scene.Models.emplace_back().MeshIndex = 0;
+        for (std::size_t m = 0; m < meshes.size(); ++m) {
+            scene.Meshes.push_back(meshes[m].second);
+            Engine::Model & model = scene.Models.emplace_back();
+            model.MeshIndex       = std::uint32_t(m + 1);
+            model.Transform       = glm::mat4(
+                1.0f, 0.0f, 0.0f, 0.0f,
+                0.0f, 1.0f, 0.0f, 0.0f,
+                0.0f, 0.0f, 1.0f, 0.0f,
+                1.5f * (float(m) - 0.5f * float(meshes.size() - 1)), 0.5f, 0.0f, 1.0f);
+        }
+        auto & light    = scene.Lights.emplace_back();
+        light.Type      = Engine::LightType::Point;
+        light.Position  = glm::vec3(0.0f, 3.5f, 1.0f);
+        light.Intensity = glm::vec3(8.0f);
+
+        RayIntersector intersector;
+        intersector.InitScene(&scene);
+
+        glm::vec3 const eye(0.0f, 2.0f, 3.2f);
+        glm::vec3 const look      = glm::normalize(glm::vec3(0.0f, 0.6f, 0.0f) - eye);
+        glm::vec3 const right     = glm::normalize(glm::cross(look, glm::vec3(0, 1, 0)));
+        glm::vec3 const up        = glm::cross(right, look);
+        auto const      CameraRay = [&](std::size_t const i, std::size_t const j, Sampler const & sampler) {
+            glm::vec2 const jitter = sampler.Get2D(SampleDim::Camera);
+            float const     x      = (i + jitter.x) / c_Image * 2.0f - 1.0f;
+            float const     y      = (j + jitter.y) / c_Image * 2.0f - 1.0f;
+            return Ray(eye, glm::normalize(look + 0.8f * (x * right + y * up)), 0.0f, 1.6f / c_Image);
+        };
+
+        auto const             sampler = CreateSampler(SamplerType::Sobol, c_Spp);
+        CacheMissCounter       counter;
+        std::vector<glm::vec3> reference(c_Image * c_Image), image(c_Image * c_Image);
+
+        // 深度优先的结果写入 reference, 波前的结果写入 image
+        auto const RenderDepthFirst = [&]() {
+            for (std::size_t ty = 0; ty < c_Image; ty += c_Tile)
+                for (std::size_t tx = 0; tx < c_Image; tx += c_Tile)
+                    for (std::size_t j = ty; j < ty + c_Tile; ++j)
+                        for (std::size_t i = tx; i < tx + c_Tile; ++i) {
+                            glm::vec3 sum(0.0f);
+                            for (int sample = 0; sample < c_Spp; ++sample) {
+                                sampler->StartPixelSample(j * c_Image + i, sample);
+                                sum += PathTrace(intersector, *sampler, CameraRay(i, j, *sampler), c_Bounces, true, true, true, 0.8f, glm::vec3(1.0f));
+                            }
+                            reference[j * c_Image + i] = sum;
+                        }
+        };
+        auto const RenderWavefront = [&](bool const sortRays) {
+            std::vector<PixelSample> samples;
+            std::vector<glm::vec3>   colors;
+            for (std::size_t ty = 0; ty < c_Image; ty += c_Tile)
+                for (std::size_t tx = 0; tx < c_Image; tx += c_Tile) {
+                    samples.clear();
+                    for (int sample = 0; sample < c_Spp; ++sample)
+                        for (std::size_t j = ty; j < ty + c_Tile; ++j)
+                            for (std::size_t i = tx; i < tx + c_Tile; ++i) {
+                                sampler->StartPixelSample(j * c_Image + i, sample);
+                                samples.push_back({ CameraRay(i, j, *sampler), j * c_Image + i, std::uint32_t(sample) });
+                            }
+                    colors.resize(samples.size());
+                    PathTraceWavefront(intersector, *sampler, samples, c_Bounces, true, true, true, 0.8f, glm::vec3(1.0f), colors, sortRays);
+                    for (std::size_t j = ty; j < ty + c_Tile; ++j)
+                        for (std::size_t i = tx; i < tx + c_Tile; ++i) image[j * c_Image + i] = glm::vec3(0.0f);
+                    for (std::size_t s = 0; s < samples.size(); ++s) image[samples[s].Pixel] += colors[s];
+                }
+        };
+
+        // 按渲染时的顺序重放最近交点光线: 逐条调用 InternalBVH.Intersect 计入 stats, 再用同样的 ShadePathVertex 推进路径,
+        // 得到与渲染相同的光线; 阴影光线不计入
+        auto const TraceCounted = [&](Ray const & ray, TraversalStats & stats) {
+            BVHHit hit;
+            RayHit result;
+            if (! intersector.InternalBVH.Intersect(hit, ray, 0.0f, 1e7f, stats)) {
+                result.IntersectState = false;
+                return result;
+            }
+            return ShadeRayHit(intersector.InternalSnapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V, ray, hit.T);
+        };
+        auto const ReplayDepthFirst = [&](TraversalStats & stats) {
+            for (std::size_t ty = 0; ty < c_Image; ty += c_Tile)
+                for (std::size_t tx = 0; tx < c_Image; tx += c_Tile)
+                    for (std::size_t j = ty; j < ty + c_Tile; ++j)
+                        for (std::size_t i = tx; i < tx + c_Tile; ++i)
+                            for (int sample = 0; sample < c_Spp; ++sample) {
+                                sampler->StartPixelSample(j * c_Image + i, sample);
+                                Ray       ray = CameraRay(i, j, *sampler);
+                                glm::vec3 throughput(1.0f), radiance(0.0f);
+                                for (int bounce = 0; bounce <= c_Bounces; ++bounce)
+                                    if (! ShadePathVertex(intersector, *sampler, TraceCounted(ray, stats), bounce, true, true, true, 0.8f, glm::vec3(1.0f), nullptr, ray, throughput, radiance)) break;
+                            }
+        };
+        auto const ReplayWavefront = [&](bool const sortRays, TraversalStats & stats) {
+            std::vector<PixelSample>   samples;
+            std::vector<Ray>           rays;
+            std::vector<glm::vec3>     throughput, radiance;
+            std::vector<std::uint32_t> active;
+            std::vector<std::uint64_t> keys;
+            for (std::size_t ty = 0; ty < c_Image; ty += c_Tile)
+                for (std::size_t tx = 0; tx < c_Image; tx += c_Tile) {
+                    samples.clear();
+                    for (int sample = 0; sample < c_Spp; ++sample)
+                        for (std::size_t j = ty; j < ty + c_Tile; ++j)
+                            for (std::size_t i = tx; i < tx + c_Tile; ++i) {
+                                sampler->StartPixelSample(j * c_Image + i, sample);
+                                samples.push_back({ CameraRay(i, j, *sampler), j * c_Image + i, std::uint32_t(sample) });
+                            }
+                    rays.resize(samples.size());
+                    active.resize(samples.size());
+                    throughput.assign(samples.size(), glm::vec3(1.0f));
+                    radiance.assign(samples.size(), glm::vec3(0.0f));
+                    for (std::size_t k = 0; k < samples.size(); ++k) rays[k] = samples[k].CameraRay, active[k] = std::uint32_t(k);
+                    for (int bounce = 0; bounce <= c_Bounces && ! active.empty(); ++bounce) {
+                        if (sortRays) SortRays(rays, active, keys);
+                        std::size_t alive = 0;
+                        for (std::uint32_t const k : active) {
+                            sampler->StartPixelSample(samples[k].Pixel, samples[k].SampleIndex);
+                            if (ShadePathVertex(intersector, *sampler, TraceCounted(rays[k], stats), bounce, true, true, true, 0.8f, glm::vec3(1.0f), nullptr, rays[k], throughput[k], radiance[k])) active[alive++] = k;
+                        }
+                        active.resize(alive);
+                    }
+                }
+        };
+
+        struct Mode {
+            char const *                          Name;
+            std::function<void()>                 Render;
+            std::function<void(TraversalStats &)> Replay;
+            double                                Seconds            = std::numeric_limits<double>::max();
+            std::uint64_t                         Misses             = 0;  // 最快一次的硬件缓存缺失数
+            TraversalStats                        Stats              = {}; // 重放得到的遍历统计
+            std::uint64_t                         SimulatedMisses[2] = {}; // 模拟的 L1 与 L2 的缺失数
+            std::size_t                           Mismatches         = 0;
+        };
+        Mode modes[] = {
+            { "depth-first", RenderDepthFirst, ReplayDepthFirst },
+            { "wavefront-u", [&]() { RenderWavefront(false); }, [&](TraversalStats & stats) { ReplayWavefront(false, stats); } },
+            { "wavefront", [&]() { RenderWavefront(true); }, [&](TraversalStats & stats) { ReplayWavefront(true, stats); } },
+        };
+
+        // 各模式交替运行, 取最快一次的秒数与该次的缓存缺失数
+        for (int r = 0; r < options.Repeats; ++r) {
+            for (auto & mode : modes) {
+                counter.Start();
+                auto const start = std::chrono::steady_clock::now();
+                mode.Render();
+                double const        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::uint64_t const misses  = counter.Stop();
+                if (seconds < mode.Seconds) mode.Seconds = seconds, mode.Misses = misses;
+            }
+        }
+        for (auto & mode : modes) {
+            if (&mode == &modes[0]) continue;
+            mode.Render();
+            for (std::size_t p = 0; p < image.size(); ++p) mode.Mismatches += image[p] != reference[p];
+        }
+
+        // 再重放一遍, 把每条最近交点光线读取的节点与三角形数据按追踪顺序送入模拟的 32 KiB L1 与 2 MiB L2
+        for (auto & mode : modes) {
+            std::pair<std::size_t, std::size_t> const caches[] = { { 32 << 10, 8 }, { 2 << 20, 16 } };
+            for (int level = 0; level < 2; ++level) {
+                CacheModel     cache(caches[level].first, caches[level].second);
+                TraversalStats stats;
+                stats.Cache = &cache;
+                mode.Replay(stats);
+                mode.Stats                  = stats;
+                mode.SimulatedMisses[level] = cache.GetMisses();
+            }
+        }
+
+        std::size_t const paths = c_Image * c_Image * c_Spp;
+        std::printf("\n%-14s %10s %10s %10s %13s %13s %14s %10s\n", "mode", "paths/s", "rays/s", "nodes/ray", "L1 sim/ray", "L2 sim/ray", "LLC miss/ray", "mismatch");
+        for (auto const & mode : modes) {
+            double const      rays   = double(mode.Stats.Rays);
+            std::string const misses = counter.IsAvailable() ? fmt::format("{:.3f}", mode.Misses / rays) : "n/a";
+            std::printf(
+                "%-14s %9.2fM %9.2fM %10.2f %13.2f %13.3f %14s %10zu\n",
+                mode.Name,
+                paths / mode.Seconds * 1e-6,
+                rays / mode.Seconds * 1e-6,
+                mode.Stats.Nodes / rays,
+                mode.SimulatedMisses[0] / rays,
+                mode.SimulatedMisses[1] / rays,
+                misses.c_str(),
+                mode.Mismatches);
+        }
+    }
+    return 0;
+}
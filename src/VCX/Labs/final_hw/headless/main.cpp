@@ -0,0 +1,301 @@
+// headless/main.cpp
+// 无窗口的批量渲染程序: 读取场景 YAML, 用全部核心运行 PathTrace 并把结果写入图片, 不创建 GL 上下文
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <stb_image_write.h>
+
+#include "Engine/loader.h"
+#include "Labs/Common/ImageRGB.h"
+#include "Labs/final_hw/Parallel.h"
+#include "Labs/final_hw/PathTracing.h"
+#include "Labs/final_hw/Sampler.h"
+#include "Labs/final_hw/TileRenderer.h"
+
+using namespace VCX;
+using namespace VCX::Labs::Rendering;
+
+namespace {
+    struct Options {
+        std::filesystem::path Scene;
+        std::filesystem::path Output { "render.png" };
+        std::size_t           Width { 800 };
+        std::size_t           Height { 600 };
+        int                   SamplesPerPixel { 64 };
+        int                   MaxBounces { 5 };
+        unsigned              Threads { 0 };
+        std::size_t           Camera { 0 };
+        SamplerType           Sampler { SamplerType::Sobol };
+        BVHBuildMode          BuildMode { BVHBuildMode::SAH };
+        bool                  QuantizedNodes { false };
+        bool                  Wavefront { false };
+        bool                  EnableNEE { true };
+        bool                  EnableRussianRoulette { true };
+        float                 SkyLightIntensity { 0.8f };
+        glm::vec3             SkyLightColor { 0.7f, 0.8f, 1.0f };
+    };
+
+    void PrintUsage(char const * program) {
+        std::printf(
+            "Usage: %s <scene.yaml> [options]\n"
+            "  -o, --output <file>     output image, .png (gamma corrected) or .hdr (linear) [render.png]\n"
+            "  -w, --width <n>         image width [800]\n"
+            "  -h, --height <n>        image height [600]\n"
+            "  -s, --spp <n>           samples per pixel [64]\n"
+            "  -b, --bounces <n>       maximum number of bounces [5]\n"
+            "  -t, --threads <n>       worker threads for BVH build and rendering, 0 for all cores [0]\n"
+            "  -c, --camera <n>        index into the scene cameras [0]\n"
+            "      --sampler <name>    independent | stratified | sobol [sobol]\n"
+            "      --bvh <name>        BVH builder: sah | sbvh | lbvh | treelet [sah]\n"
+            "      --quantized         store BVH4 nodes with 8-bit quantized child boxes\n"
+            "      --wavefront         trace each bounce of a whole tile together, sorted by direction and origin\n"
+            "      --sky <intensity>   sky light intensity [0.8]\n"
+            "      --no-nee            disable next event estimation\n"
+            "      --no-rr             disable russian roulette\n",
+            program);
+    }
+
+    bool ParseOptions(int argc, char ** argv, Options & options) try {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view const arg = argv[i];
+            auto const             Next = [&]() -> char const * {
+                if (i + 1 >= argc) {
+                    spdlog::error("VCX::Labs::Rendering::ParseOptions(..): missing value for {}.", arg);
+                    return nullptr;
+                }
+                return argv[++i];
+            };
+            char const * value = nullptr;
+            if (arg == "--no-nee") options.EnableNEE = false;
+            else if (arg == "--no-rr") options.EnableRussianRoulette = false;
+            else if (arg == "--quantized") options.QuantizedNodes = true;
+            else if (arg == "--wavefront") options.Wavefront = true;
+            else if (arg == "-o" || arg == "--output") {
+                if (! (value = Next())) return false;
+                options.Output = value;
+            } else if (arg == "-w" || arg == "--width") {
+                if (! (value = Next())) return false;
+                options.Width = std::stoul(value);
+            } else if (arg == "-h" || arg == "--height") {
+                if (! (value = Next())) return false;
+                options.Height = std::stoul(value);
+            } else if (arg == "-s" || arg == "--spp") {
+                if (! (value = Next())) return false;
+                options.SamplesPerPixel = std::stoi(value);
+            } else if (arg == "-b" || arg == "--bounces") {
+                if (! (value = Next())) return false;
+                options.MaxBounces = std::stoi(value);
+            } else if (arg == "-t" || arg == "--threads") {
+                if (! (value = Next())) return false;
+                options.Threads = unsigned(std::stoul(value));
+            } else if (arg == "-c" || arg == "--camera") {
+                if (! (value = Next())) return false;
+                options.Camera = std::stoul(value);
+            } else if (arg == "--sky") {
+                if (! (value = Next())) return false;
+                options.SkyLightIntensity = std::stof(value);
+            } else if (arg == "--sampler") {
+                if (! (value = Next())) return false;
+                std::string_view const name = value;
+                if (name == "independent") options.Sampler = SamplerType::Independent;
+                else if (name == "stratified") options.Sampler = SamplerType::Stratified;
+                else if (name == "sobol") options.Sampler = SamplerType::Sobol;
+                else {
+                    spdlog::error("VCX::Labs::Rendering::ParseOptions(..): unknown sampler {}.", name);
+                    return false;
+                }
+            } else if (arg == "--bvh") {
+                if (! (value = Next())) return false;
+                std::string_view const name = value;
+                if (name == "sah") options.BuildMode = BVHBuildMode::SAH;
+                else if (name == "sbvh") options.BuildMode = BVHBuildMode::SBVH;
+                else if (name == "lbvh") options.BuildMode = BVHBuildMode::LBVH;
+                else if (name == "treelet") options.BuildMode = BVHBuildMode::LBVHTreelet;
+                else {
+                    spdlog::error("VCX::Labs::Rendering::ParseOptions(..): unknown BVH builder {}.", name);
+                    return false;
+                }
+            } else if (! arg.empty() && arg[0] != '-' && options.Scene.empty()) {
+                options.Scene = arg;
+            } else {
+                spdlog::error("VCX::Labs::Rendering::ParseOptions(..): unknown option {}.", arg);
+                return false;
+            }
+        }
+        if (options.Scene.empty() || options.Width == 0 || options.Height == 0 || options.SamplesPerPixel <= 0 || options.MaxBounces < 0) return false;
+        return true;
+    } catch (std::exception const & e) {
+        spdlog::error("VCX::Labs::Rendering::ParseOptions(..): invalid number ({}).", e.what());
+        return false;
+    }
+
+    // 按文件扩展名写出图片, 像素按 GL 约定自下而上存储
+    bool WriteImage(std::filesystem::path const & path, Engine::Texture2D<Engine::Formats::RGB32F> const & image) {
+        int const width  = int(image.GetSizeX());
+        int const height = int(image.GetSizeY());
+        stbi_flip_vertically_on_write(1);
+        if (path.extension() == ".hdr") {
+            return stbi_write_hdr(path.string().c_str(), width, height, 3, reinterpret_cast<float const *>(image.GetBytes().data()));
+        }
+        Labs::Common::ImageRGB ldr(width, height);
+        for (int j = 0; j < height; ++j)
+            for (int i = 0; i < width; ++i)
+                ldr.At(i, j) = glm::pow(glm::vec3(image.At(i, j)), glm::vec3(1.0f / 2.2f));
+        return stbi_write_png(path.string().c_str(), width, height, 3, ldr.GetBytes().data(), 3 * width);
+    }
+} // namespace
+
+int main(int argc, char ** argv) {
+    Options options;
+    if (! ParseOptions(argc, argv, options)) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    Engine::Scene const scene = Engine::LoadScene(options.Scene);
+    if (scene.Models.empty()) {
+        spdlog::error("VCX::Labs::Rendering::main(..): scene {} has no models.", options.Scene.string());
+        return 1;
+    }
+    if (options.Camera >= scene.Cameras.size()) {
+        spdlog::error("VCX::Labs::Rendering::main(..): camera {} out of range, the scene has {} cameras.", options.Camera, scene.Cameras.size());
+        return 1;
+    }
+
+    SetThreadCount(options.Threads); // BVH 构建与渲染使用相同的线程数
+    RayIntersector intersector;
+    intersector.InitScene(&scene, InstanceBVH::GetCachePath(options.Scene, options.BuildMode, options.QuantizedNodes), options.BuildMode, options.QuantizedNodes);
+
+    std::size_t const                          width  = options.Width;
+    std::size_t const                          height = options.Height;
+    Engine::Texture2D<Engine::Formats::RGB32F> image(width, height);
+
+    // 相机基向量与 CasePathTracing 一致
+    auto const &    camera    = scene.Cameras[options.Camera];
+    glm::vec3 const lookDir   = glm::normalize(camera.Target - camera.Eye);
+    glm::vec3 const rightDir  = glm::normalize(glm::cross(lookDir, camera.Up));
+    glm::vec3 const upDir     = glm::normalize(glm::cross(rightDir, lookDir));
+    float const     aspect    = width * 1.f / height;
+    float const     fovFactor = std::tan(glm::radians(camera.Fovy) / 2);
+
+    TileRenderer       renderer;
+    std::atomic_bool   stopFlag { false };
+    std::atomic_size_t progress { 0 };
+    renderer.Reset(width, height);
+
+    // 像素 (i, j) 的相机光线, sampler 需已为该像素样本调用过 StartPixelSample
+    auto const CameraRay = [&](std::size_t const i, std::size_t const j, Sampler const & sampler) {
+        glm::vec2 const jitter = sampler.Get2D(SampleDim::Camera);
+
+        glm::vec3 pixelLookDir = lookDir;
+        pixelLookDir += fovFactor * (2.0f * (j + jitter.y) / height - 1.0f) * upDir;
+        pixelLookDir += fovFactor * aspect * (2.0f * (i + jitter.x) / width - 1.0f) * rightDir;
+        return Ray(camera.Eye, glm::normalize(pixelLookDir), 0.0f, 2.0f * fovFactor / height);
+    };
+
+    TileRenderer::BlockFunc renderBlock;
+    if (options.Wavefront) {
+        // 整个图块的样本分批成波, 每波按样本序号从小到大包含若干轮全部像素, 累加顺序与光线包模式相同
+        renderBlock = [&](std::size_t const x0, std::size_t const y0, std::size_t const x1, std::size_t const y1) {
+            std::size_t const n       = (x1 - x0) * (y1 - y0);
+            int const         waveSpp = int(std::max<std::size_t>(1, c_WavefrontSize / n));
+            auto const        sampler = CreateSampler(options.Sampler, options.SamplesPerPixel);
+
+            std::vector<PixelSample> samples;
+            std::vector<glm::vec3>   sampleColors;
+            std::vector<glm::vec3>   accumulatedColors(n, glm::vec3(0.0f));
+            for (int first = 0; first < options.SamplesPerPixel; first += waveSpp) {
+                int const last = std::min(options.SamplesPerPixel, first + waveSpp);
+                samples.clear();
+                for (int sample = first; sample < last; ++sample) {
+                    for (std::size_t k = 0; k < n; ++k) {
+                        std::size_t const i = x0 + k % (x1 - x0), j = y0 + k / (x1 - x0);
+                        sampler->StartPixelSample(j * width + i, sample);
+                        samples.push_back({ CameraRay(i, j, *sampler), j * width + i, std::uint32_t(sample) });
+                    }
+                }
+                sampleColors.resize(samples.size());
+                PathTraceWavefront(
+                    intersector,
+                    *sampler,
+                    samples,
+                    options.MaxBounces,
+                    true,
+                    options.EnableRussianRoulette,
+                    options.EnableNEE,
+                    options.SkyLightIntensity,
+                    options.SkyLightColor,
+                    sampleColors);
+                for (std::size_t s = 0; s < samples.size(); ++s) accumulatedColors[s % n] += sampleColors[s];
+            }
+            for (std::size_t k = 0; k < n; ++k)
+                image.At(x0 + k % (x1 - x0), y0 + k / (x1 - x0)) = accumulatedColors[k] / float(options.SamplesPerPixel);
+        };
+    } else {
+        // 像素块内序号相同的样本组成一个相机光线包
+        renderBlock = [&](std::size_t const x0, std::size_t const y0, std::size_t const x1, std::size_t const y1) {
+            constexpr std::size_t c_BlockPixels = TileRenderer::c_BlockSize * TileRenderer::c_BlockSize;
+            std::size_t const     n             = (x1 - x0) * (y1 - y0);
+
+            auto const                             sampler = CreateSampler(options.Sampler, options.SamplesPerPixel);
+            std::array<PixelSample, c_BlockPixels> samples;
+            std::array<glm::vec3, c_BlockPixels>   sampleColors;
+            std::array<glm::vec3, c_BlockPixels>   accumulatedColors {};
+            for (int sample = 0; sample < options.SamplesPerPixel; ++sample) {
+                for (std::size_t k = 0; k < n; ++k) {
+                    std::size_t const i = x0 + k % (x1 - x0), j = y0 + k / (x1 - x0);
+                    sampler->StartPixelSample(j * width + i, sample);
+                    samples[k] = { CameraRay(i, j, *sampler), j * width + i, std::uint32_t(sample) };
+                }
+                PathTracePacket(
+                    intersector,
+                    *sampler,
+                    std::span(samples.data(), n),
+                    options.MaxBounces,
+                    true,
+                    options.EnableRussianRoulette,
+                    options.EnableNEE,
+                    options.SkyLightIntensity,
+                    options.SkyLightColor,
+                    std::span(sampleColors.data(), n));
+                for (std::size_t k = 0; k < n; ++k) accumulatedColors[k] += sampleColors[k];
+            }
+            for (std::size_t k = 0; k < n; ++k)
+                image.At(x0 + k % (x1 - x0), y0 + k / (x1 - x0)) = accumulatedColors[k] / float(options.SamplesPerPixel);
+        };
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    renderer.Start(nullptr, std::move(renderBlock), stopFlag, progress, options.Threads, options.Wavefront ? TileRenderer::c_TileSize : TileRenderer::c_BlockSize);
+
+    spdlog::info("VCX::Labs::Rendering::main(..): rendering {}x{} at {} spp on {} threads.", width, height, options.SamplesPerPixel, renderer.GetThreadCount());
+    std::size_t const total      = width * height;
+    auto              lastReport = start;
+    while (progress < total) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (std::chrono::steady_clock::now() - lastReport < std::chrono::seconds(1)) continue;
+        lastReport = std::chrono::steady_clock::now();
+        spdlog::info("VCX::Labs::Rendering::main(..): {:.1f}%", 100.0 * progress / total);
+    }
+    renderer.Join();
+    float const seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    spdlog::info("VCX::Labs::Rendering::main(..): finished in {:.2f} s ({:.2f} Msamples/s).", seconds, total * options.SamplesPerPixel / seconds * 1e-6f);
+
+    if (! WriteImage(options.Output, image)) {
+        spdlog::error("VCX::Labs::Rendering::main(..): failed to write {}.", options.Output.string());
+        return 1;
+    }
+    spdlog::info("VCX::Labs::Rendering::main(..): saved {}.", options.Output.string());
+    return 0;
+}
@@ -2,72 +2,106 @@
 #include<cmath>
 namespace VCX::Labs::Rendering {
 
-    glm::vec4 GetTexture(Engine::Texture2D<Engine::Formats::RGBA8> const & texture, glm::vec2 const & uvCoord) {
-        if (texture.GetSizeX() == 1 || texture.GetSizeY() == 1) return texture.At(0, 0);
-        glm::vec2 uv      = glm::fract(uvCoord);
-        uv.x              = uv.x * texture.GetSizeX() - .5f;
-        uv.y              = uv.y * texture.GetSizeY() - .5f;
-        std::size_t xmin  = std::size_t(glm::floor(uv.x) + texture.GetSizeX()) % texture.GetSizeX();
-        std::size_t ymin  = std::size_t(glm::floor(uv.y) + texture.GetSizeY()) % texture.GetSizeY();
-        std::size_t xmax  = (xmin + 1) % texture.GetSizeX();
-        std::size_t ymax  = (ymin + 1) % texture.GetSizeY();
-        float       xfrac = glm::fract(uv.x), yfrac = glm::fract(uv.y);
-        return glm::mix(glm::mix(texture.At(xmin, ymin), texture.At(xmin, ymax), yfrac), glm::mix(texture.At(xmax, ymin), texture.At(xmax, ymax), yfrac), xfrac);
+    RayHit ShadeRayHit(SceneSnapshot const & snapshot, std::uint32_t const modelIdx, std::uint32_t const faceIdx, float const u, float const v, Ray const & ray, float const t) {
+        auto const &          instance = snapshot.GetInstance(modelIdx);
+        auto const &          mesh     = snapshot.GetMesh(instance.Mesh);
+        auto const &          material = *instance.Material;
+        std::uint32_t const * face     = mesh.Indices + faceIdx;
+        float const           w        = 1.0f - u - v;
+        // constant materials need no texture coordinates at all
+        bool const            textured = (! material.Albedo.IsConstant() || ! material.MetaSpec.IsConstant()) && mesh.TexCoords;
+        glm::vec2 const       uvCoord  = textured
+            ? w * mesh.TexCoords[face[0]] + u * mesh.TexCoords[face[1]] + v * mesh.TexCoords[face[2]]
+            : glm::vec2(.5f, .5f);
+
+        // the shared mesh is in object space; instances placed by a transform move their vertices to world space
+        auto const ToWorld = [&](glm::vec3 const & p) { return instance.Identity ? p : glm::vec3(instance.ObjectToWorld * glm::vec4(p, 1.0f)); };
+        glm::vec3 const p1 = ToWorld(mesh.Positions[face[0]]);
+        glm::vec3 const p2 = ToWorld(mesh.Positions[face[1]]);
+        glm::vec3 const p3 = ToWorld(mesh.Positions[face[2]]);
+
+        // bound on the rounding error of the position (PBRT 3.9): the barycentric interpolation, and for transformed instances
+        // the transform of the vertices to world space plus that of the spawned rays back to object space
+        glm::vec3 const position = w * p1 + u * p2 + v * p3;
+        glm::vec3       error    = Gamma(7) * (glm::abs(w * p1) + glm::abs(u * p2) + glm::abs(v * p3));
+        if (! instance.Identity) {
+            auto const Abs = [](glm::mat3 m) {
+                for (int c = 0; c < 3; ++c) m[c] = glm::abs(m[c]);
+                return m;
+            };
+            glm::mat3 const toWorld  = Abs(glm::mat3(instance.ObjectToWorld));
+            glm::mat3 const toObject = Abs(glm::mat3(instance.WorldToObject));
+            glm::vec3 const object   = w * glm::abs(mesh.Positions[face[0]]) + u * glm::abs(mesh.Positions[face[1]]) + v * glm::abs(mesh.Positions[face[2]]);
+            error += Gamma(3) * (toWorld * object + glm::abs(glm::vec3(instance.ObjectToWorld[3])));
+            error += Gamma(3) * (toWorld * (toObject * glm::abs(position) + glm::abs(glm::vec3(instance.WorldToObject[3]))));
+        }
+
+        // ray cone footprint mapped to uv space: world width at the hit, widened by the incidence angle and
+        // scaled by the triangle's uv-to-world area ratio
+        float footprint = 0.0f;
+        if (textured && (ray.ConeWidth > 0.0f || ray.ConeSpread > 0.0f)) {
+            glm::vec3 const cross     = glm::cross(p2 - p1, p3 - p1);
+            glm::vec2 const duv1      = mesh.TexCoords[face[1]] - mesh.TexCoords[face[0]];
+            glm::vec2 const duv2      = mesh.TexCoords[face[2]] - mesh.TexCoords[face[0]];
+            float const     worldArea = glm::length(cross);
+            float const     uvArea    = glm::abs(duv1.x * duv2.y - duv1.y * duv2.x);
+            float const     cosTheta  = glm::abs(glm::dot(cross, glm::normalize(ray.Direction))) / glm::max(worldArea, 1e-20f);
+            if (worldArea > 0.0f)
+                footprint = (ray.ConeWidth + ray.ConeSpread * t) * glm::sqrt(uvArea / worldArea) / glm::max(cosTheta, 1e-3f);
+        }
+
+        glm::vec3 const normal = w * mesh.Normals[face[0]] + u * mesh.Normals[face[1]] + v * mesh.Normals[face[2]];
+
+        RayHit result;
+        result.IntersectState           = true;
+        result.IntersectMode            = material.Blend;
+        result.IntersectPosition        = position;
+        result.IntersectNormal          = instance.Identity ? normal : instance.NormalToWorld * normal;
+        result.IntersectGeometricNormal = glm::normalize(glm::cross(p2 - p1, p3 - p1));
+        result.IntersectError           = error;
+        result.IntersectAlbedo          = material.Albedo.Sample(uvCoord, footprint);
+        result.IntersectMetaSpec        = material.MetaSpec.Sample(uvCoord, footprint);
+        return result;
+    }
+
+    glm::vec3 SpawnRayOrigin(RayHit const & hit, glm::vec3 const & dir) {
+        glm::vec3 const n      = hit.IntersectGeometricNormal;
+        float const     d      = glm::dot(glm::abs(n), hit.IntersectError);
+        glm::vec3 const offset = (glm::dot(n, dir) < 0.0f ? -d : d) * n;
+        glm::vec3       origin = hit.IntersectPosition + offset;
+        // the rounding of the sum must not pull the origin back into the error bound
+        for (int a = 0; a < 3; ++a) {
+            if (offset[a] > 0.0f) origin[a] = std::nextafter(origin[a], std::numeric_limits<float>::infinity());
+            else if (offset[a] < 0.0f) origin[a] = std::nextafter(origin[a], -std::numeric_limits<float>::infinity());
+        }
+        return origin;
     }
 
-    glm::vec4 GetAlbedo(Engine::Material const & material, glm::vec2 const & uvCoord) {
-        glm::vec4 albedo       = GetTexture(material.Albedo, uvCoord);
-        glm::vec3 diffuseColor = albedo;
-        return glm::vec4(glm::pow(diffuseColor, glm::vec3(2.2)), albedo.w);
+    bool IsOccluder(SceneSnapshot const & snapshot, std::uint32_t const modelIdx, std::uint32_t const faceIdx, float const u, float const v) {
+        auto const & instance = snapshot.GetInstance(modelIdx);
+        if (instance.MinAlpha >= ALPHA_OCCLUDE) return true;
+        auto const &          mesh    = snapshot.GetMesh(instance.Mesh);
+        std::uint32_t const * face    = mesh.Indices + faceIdx;
+        glm::vec2 const       uvCoord = mesh.TexCoords
+            ? (1.0f - u - v) * mesh.TexCoords[face[0]] + u * mesh.TexCoords[face[1]] + v * mesh.TexCoords[face[2]]
+            : glm::vec2(.5f, .5f);
+        return instance.Material->Albedo.Sample(uvCoord).w >= ALPHA_OCCLUDE;
     }
 
     /******************* 1. Ray-triangle intersection *****************/
     bool IntersectTriangle(Intersection & output, Ray const & ray, glm::vec3 const & p1, glm::vec3 const & p2, glm::vec3 const & p3) {
         // your code here
 
-        glm::vec3 edge12 = p2 - p1;
-        glm::vec3 edge13 = p3 - p1;
-
-        glm::vec3 normal_dir = normalize(ray.Direction);
-        glm::vec3 origin_point     = ray.Origin;
-
-        glm::vec3 pvec = glm::cross(normal_dir, edge13);
-        double    det  = glm::dot(edge12, pvec);
-
-        if (abs(det) < 0.00005)
-        {
-            return false;
-        }
-        double inv_det = 1.0 / det;
-
-        glm::vec3 tvec = origin_point - p1;
-        double    u_   = glm::dot(tvec, pvec)*inv_det;
-        if (u_<0.0 || u_>1.0)
-        {
-            return false;
-        }
-
-        glm::vec3 qvec = glm::cross(tvec, edge12);
-        double    v_   = glm::dot(normal_dir, qvec)*inv_det;
-        if (v_<0.0 || u_ + v_>1.0)
-        {
-            return false;
-        }
-
-        double t_ = glm::dot(edge13,qvec)*inv_det;
-
-        output.t = t_;
-        output.u = u_;
-        output.v = v_;
-        return true;
+        // the same watertight test as the BVH kernels, so that both intersectors agree on every hit
+        return IntersectTriangleWatertight(TriangleRay(ray.Origin, glm::normalize(ray.Direction)), p1, p2, p3, 0.0f, std::numeric_limits<float>::infinity(), output.t, output.u, output.v);
     }
 
-    glm::vec3 RayTrace(const RayIntersector & intersector, Ray ray, int maxDepth, bool enableShadow) {
+    glm::vec3 RayTrace(const RayIntersector & intersector, Ray ray, int maxDepth, bool enableShadow, RayHit const * primaryHit) {
         glm::vec3 color(0.0f);
         glm::vec3 weight(1.0f);
 
         for (int depth = 0; depth < maxDepth; depth++) {
-            auto rayHit = intersector.IntersectRay(ray);
+            auto rayHit = depth == 0 && primaryHit ? *primaryHit : intersector.IntersectRay(ray);
             if (! rayHit.IntersectState) return color;
             const glm::vec3 pos       = rayHit.IntersectPosition;
             const glm::vec3 n         = rayHit.IntersectNormal;
@@ -87,25 +121,15 @@ namespace VCX::Labs::Rendering {
                 if (light.Type == Engine::LightType::Point) {
                     l           = light.Position - pos;
                     attenuation = 1.0f / glm::dot(l, l);
+                    // only occluders in front of the light cast shadows
                     if (enableShadow) {
-                        auto shadowHit_ = intersector.IntersectRay(Ray(pos, l));
-                        if (shadowHit_.IntersectState==true && shadowHit_.IntersectAlbedo.w >= 0.2f) {
-                            
-                            // consider light&scene ray cross point in the back
-                            glm::vec3 shadow_pos = shadowHit_.IntersectPosition;
-                            glm::vec3 shadow_light_dir = light.Position-shadow_pos;
-                            if (glm::dot(shadow_light_dir,l)>0) continue; 
-                        }
+                        glm::vec3 const origin = SpawnRayOrigin(rayHit, l);
+                        if (intersector.Occluded(Ray(origin, light.Position - origin), glm::distance(origin, light.Position))) continue;
                     }
                 } else if (light.Type == Engine::LightType::Directional) {
                     l           = light.Direction;
                     attenuation = 1.0f;
-                    if (enableShadow) {
-                        auto shadowHit_ = intersector.IntersectRay(Ray(pos, l));
-                        if (shadowHit_.IntersectState==true && shadowHit_.IntersectAlbedo.w >= 0.2f) {
-                            continue; 
-                        }
-                    }
+                    if (enableShadow && intersector.Occluded(Ray(SpawnRayOrigin(rayHit, l), l), 1e7f)) continue;
                 }
 
                 /******************* 2. Whitted-style ray tracing *****************/
@@ -139,8 +163,8 @@ namespace VCX::Labs::Rendering {
                 color += weight * R * result;
                 weight *= glm::vec3(1.0f) - R;
 
-                // generate new ray
-                ray = Ray(pos, ray.Direction);
+                // generate new ray, the cone keeps spreading from its width at the hit
+                ray = Ray(SpawnRayOrigin(rayHit, ray.Direction), ray.Direction, ray.ConeWidth + ray.ConeSpread * glm::distance(ray.Origin, pos), ray.ConeSpread);
             } else {
                 // reflection
                 // accumulate color
@@ -150,7 +174,7 @@ namespace VCX::Labs::Rendering {
 
                 // generate new ray
                 glm::vec3 out_dir = ray.Direction - glm::vec3(2.0f) * n * glm::dot(n, ray.Direction);
-                ray               = Ray(pos, out_dir);
+                ray               = Ray(SpawnRayOrigin(rayHit, out_dir), out_dir, ray.ConeWidth + ray.ConeSpread * glm::distance(ray.Origin, pos), ray.ConeSpread);
             }
         }
 
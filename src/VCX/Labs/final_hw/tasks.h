@@ -1,25 +1,28 @@
 #pragma once
 
+#include <filesystem>
 #include <numeric>
+#include <span>
 #include <spdlog/spdlog.h>
 
 #include "Engine/Scene.h"
+#include "Labs/final_hw/InstanceBVH.h"
 #include "Labs/final_hw/Ray.h"
+#include "Labs/final_hw/SceneSnapshot.h"
 
 namespace VCX::Labs::Rendering {
 
-    constexpr float EPS1 = 1e-2f; // distance to prevent self-intersection
     constexpr float EPS2 = 1e-8f; // angle for parallel judgement
     constexpr float EPS3 = 1e-4f; // relative distance to enlarge kdtree
 
-    glm::vec4 GetTexture(Engine::Texture2D<Engine::Formats::RGBA8> const & texture, glm::vec2 const & uvCoord);
-
-    glm::vec4 GetAlbedo(Engine::Material const & material, glm::vec2 const & uvCoord);
+    constexpr float ALPHA_OCCLUDE = 0.2f; // surfaces with a lower albedo alpha let shadow rays through
 
     struct Intersection {
         float t, u, v; // ray parameter t, barycentric coordinates (u, v)
     };
 
+    // watertight: a ray through a shared edge hits exactly one of the two triangles; only hits in front of the origin
+    // by more than the floating-point error of t are reported, so t > 0 needs no further distance threshold
     bool IntersectTriangle(Intersection & output, Ray const & ray, glm::vec3 const & p1, glm::vec3 const & p2, glm::vec3 const & p3);
 
     struct RayHit {
@@ -27,17 +30,38 @@ namespace VCX::Labs::Rendering {
         Engine::BlendMode IntersectMode;
         glm::vec3         IntersectPosition;
         glm::vec3         IntersectNormal;
+        glm::vec3         IntersectGeometricNormal; // unit face normal in world space
+        glm::vec3         IntersectError;           // per-axis bound on the rounding error of IntersectPosition
         glm::vec4         IntersectAlbedo;   // [Albedo   (vec3), Alpha     (float)]
         glm::vec4         IntersectMetaSpec; // [Specular (vec3), Shininess (float)]
     };
 
+    // shade the hit at barycentric (u, v) of the face starting at Indices[faceIdx], reading only its three vertices.
+    // Textures are filtered over the footprint of the ray cone at distance t.
+    RayHit ShadeRayHit(SceneSnapshot const & snapshot, std::uint32_t modelIdx, std::uint32_t faceIdx, float u, float v, Ray const & ray, float t);
+
+    // origin of a ray leaving the hit towards dir: the hit position pushed along the geometric normal, to the side dir points to,
+    // just past its error bound, so the new ray cannot hit the surface it starts on and needs no scene-dependent epsilon
+    glm::vec3 SpawnRayOrigin(RayHit const & hit, glm::vec3 const & dir);
+
+    // whether the hit blocks shadow rays under the ALPHA_OCCLUDE rule, sampling the albedo only for non-opaque materials
+    bool IsOccluder(SceneSnapshot const & snapshot, std::uint32_t modelIdx, std::uint32_t faceIdx, float u, float v);
+
     struct TrivialRayIntersector {
         Engine::Scene const * InternalScene = nullptr;
+        SceneSnapshot         InternalSnapshot;
 
         TrivialRayIntersector() = default;
 
+        // triangles are tested in world space: vertices of a transformed instance are moved on the fly
+        static glm::vec3 GetWorldPosition(InstanceSnapshot const & instance, MeshSnapshot const & mesh, std::uint32_t const idx) {
+            glm::vec3 const & pos = mesh.Positions[idx];
+            return instance.Identity ? pos : glm::vec3(instance.ObjectToWorld * glm::vec4(pos, 1.0f));
+        }
+
         void InitScene(Engine::Scene const * scene) {
             InternalScene = scene;
+            InternalSnapshot.Build(*scene);
         }
 
         RayHit IntersectRay(Ray const & ray) const {
@@ -50,17 +74,18 @@ namespace VCX::Labs::Rendering {
             int          modelIdx, meshIdx;
             Intersection its;
             float        tmin     = 1e7, umin, vmin;
-            int          maxmodel = InternalScene->Models.size();
+            int          maxmodel = InternalSnapshot.GetInstanceCount();
             for (int i = 0; i < maxmodel; ++i) {
-                auto const & model  = InternalScene->Models[i];
-                int          maxidx = model.Mesh.Indices.size();
+                auto const & instance = InternalSnapshot.GetInstance(i);
+                auto const & mesh     = InternalSnapshot.GetMesh(instance.Mesh);
+                int          maxidx   = mesh.Source->Indices.size();
                 for (int j = 0; j < maxidx; j += 3) {
-                    std::uint32_t const * face = model.Mesh.Indices.data() + j;
-                    glm::vec3 const &     p1   = model.Mesh.Positions[face[0]];
-                    glm::vec3 const &     p2   = model.Mesh.Positions[face[1]];
-                    glm::vec3 const &     p3   = model.Mesh.Positions[face[2]];
+                    std::uint32_t const * face = mesh.Indices + j;
+                    glm::vec3 const       p1   = GetWorldPosition(instance, mesh, face[0]);
+                    glm::vec3 const       p2   = GetWorldPosition(instance, mesh, face[1]);
+                    glm::vec3 const       p3   = GetWorldPosition(instance, mesh, face[2]);
                     if (! IntersectTriangle(its, ray, p1, p2, p3)) continue;
-                    if (its.t < EPS1 || its.t > tmin) continue;
+                    if (its.t > tmin) continue;
                     tmin = its.t, umin = its.u, vmin = its.v, modelIdx = i, meshIdx = j;
                 }
             }
@@ -68,40 +93,82 @@ namespace VCX::Labs::Rendering {
                 result.IntersectState = false;
                 return result;
             }
-            auto const &          model     = InternalScene->Models[modelIdx];
-            auto const &          normals   = model.Mesh.IsNormalAvailable() ? model.Mesh.Normals : model.Mesh.ComputeNormals();
-            auto const &          texcoords = model.Mesh.IsTexCoordAvailable() ? model.Mesh.TexCoords : model.Mesh.GetEmptyTexCoords();
-            std::uint32_t const * face      = model.Mesh.Indices.data() + meshIdx;
-            glm::vec3 const &     p1        = model.Mesh.Positions[face[0]];
-            glm::vec3 const &     p2        = model.Mesh.Positions[face[1]];
-            glm::vec3 const &     p3        = model.Mesh.Positions[face[2]];
-            glm::vec3 const &     n1        = normals[face[0]];
-            glm::vec3 const &     n2        = normals[face[1]];
-            glm::vec3 const &     n3        = normals[face[2]];
-            glm::vec2 const &     uv1       = texcoords[face[0]];
-            glm::vec2 const &     uv2       = texcoords[face[1]];
-            glm::vec2 const &     uv3       = texcoords[face[2]];
-            result.IntersectState           = true;
-            auto const & material           = InternalScene->Materials[model.MaterialIndex];
-            result.IntersectMode            = material.Blend;
-            result.IntersectPosition        = (1.0f - umin - vmin) * p1 + umin * p2 + vmin * p3;
-            result.IntersectNormal          = (1.0f - umin - vmin) * n1 + umin * n2 + vmin * n3;
-            glm::vec2 uvCoord               = (1.0f - umin - vmin) * uv1 + umin * uv2 + vmin * uv3;
-            result.IntersectAlbedo          = GetAlbedo(material, uvCoord);
-            result.IntersectMetaSpec        = GetTexture(material.MetaSpec, uvCoord);
-
-            return result;
+            return ShadeRayHit(InternalSnapshot, modelIdx, meshIdx, umin, vmin, ray, tmin);
+        }
+
+        // any-hit query: whether an occluder lies within (0, tMax] along the normalized ray direction
+        bool Occluded(Ray const & ray, float const tMax) const {
+            if (! InternalScene) {
+                spdlog::warn("VCX::Labs::Rendering::RayIntersector::Occluded(..): uninitialized intersector.");
+                return false;
+            }
+            Intersection its;
+            int          maxmodel = InternalSnapshot.GetInstanceCount();
+            for (int i = 0; i < maxmodel; ++i) {
+                auto const & instance = InternalSnapshot.GetInstance(i);
+                auto const & mesh     = InternalSnapshot.GetMesh(instance.Mesh);
+                int          maxidx   = mesh.Source->Indices.size();
+                for (int j = 0; j < maxidx; j += 3) {
+                    std::uint32_t const * face = mesh.Indices + j;
+                    if (! IntersectTriangle(its, ray, GetWorldPosition(instance, mesh, face[0]), GetWorldPosition(instance, mesh, face[1]), GetWorldPosition(instance, mesh, face[2]))) continue;
+                    if (its.t > tMax) continue;
+                    if (IsOccluder(InternalSnapshot, i, j, its.u, its.v)) return true;
+                }
+            }
+            return false;
+        }
+
+        // packet queries, traced one ray at a time
+        static constexpr std::size_t c_MaxPacketSize = 16;
+
+        void IntersectPacket(std::span<Ray const> const rays, std::span<RayHit> const hits) const {
+            for (std::size_t i = 0; i < rays.size(); ++i) hits[i] = IntersectRay(rays[i]);
+        }
+
+        std::uint32_t OccludedPacket(std::span<Ray const> const rays, std::span<float const> const tMax) const {
+            std::uint32_t occluded = 0;
+            for (std::size_t i = 0; i < rays.size(); ++i)
+                if (tMax[i] > 0.0f && Occluded(rays[i], tMax[i])) occluded |= 1u << i;
+            return occluded;
         }
     };
 
     /* Optional: write your own accelerated intersector here */
-    struct My_TrivialRayIntersector {
+    struct BVHRayIntersector {
         Engine::Scene const * InternalScene = nullptr;
+        SceneSnapshot         InternalSnapshot;
+        InstanceBVH           InternalBVH; // one bottom level per shared mesh, top level over the models
 
-        My_TrivialRayIntersector() = default;
+        BVHRayIntersector() = default;
 
-        void InitScene(Engine::Scene const * scene) {
+        // cachePath, if given, names the on-disk cache of the bottom-level BVHs, reused while the meshes and the build options stay the same;
+        // mode selects the bottom-level builder (binned SAH, spatial-split SBVH, or the faster Morton-code LBVH with optional treelet reordering);
+        // quantized stores the bottom-level BVH4 nodes with 8-bit child boxes, halving their size for scenes whose BVH outgrows the caches
+        void InitScene(Engine::Scene const * scene, std::filesystem::path const & cachePath = {}, BVHBuildMode const mode = BVHBuildMode::SAH, bool const quantized = false) {
             InternalScene = scene;
+            InternalSnapshot.Build(*scene);
+            InternalBVH.Build(InternalSnapshot, cachePath, mode, quantized);
+        }
+
+        // picks up changed Model::Transform values of the scene; only the top level is refit
+        void UpdateTransforms() {
+            InternalSnapshot.UpdateTransforms(*InternalScene);
+            InternalBVH.RefitTopLevel();
+        }
+
+        // places model modelIdx with transform instead of its Model::Transform (for models without a shared mesh, on top of
+        // their world-space vertices); only the top level is refit, the shared bottom levels stay as they are
+        void SetTransform(std::uint32_t const modelIdx, glm::mat4 const & transform) {
+            InternalSnapshot.SetTransform(modelIdx, transform);
+            InternalBVH.RefitTopLevel();
+        }
+
+        // picks up moved vertices of snapshot mesh meshIdx whose topology is unchanged: its bottom level is refit,
+        // or rebuilt once refitting has degraded its SAH cost too far
+        void UpdateGeometry(std::uint32_t const meshIdx) {
+            InternalSnapshot.UpdateMesh(meshIdx);
+            InternalBVH.Refit(meshIdx);
+            InternalBVH.RefitTopLevel();
         }
 
         RayHit IntersectRay(Ray const & ray) const {
@@ -111,57 +178,60 @@ namespace VCX::Labs::Rendering {
                 result.IntersectState = false;
                 return result;
             }
-            int          modelIdx, meshIdx;
-            Intersection its;
-            float        tmin     = 1e7, umin, vmin;
-            int          maxmodel = InternalScene->Models.size();
-            for (int i = 0; i < maxmodel; ++i) {
-                auto const & model  = InternalScene->Models[i];
-                int          maxidx = model.Mesh.Indices.size();
-                for (int j = 0; j < maxidx; j += 3) {
-                    std::uint32_t const * face = model.Mesh.Indices.data() + j;
-                    glm::vec3 const &     p1   = model.Mesh.Positions[face[0]];
-                    glm::vec3 const &     p2   = model.Mesh.Positions[face[1]];
-                    glm::vec3 const &     p3   = model.Mesh.Positions[face[2]];
-                    if (! IntersectTriangle(its, ray, p1, p2, p3)) continue;
-                    if (its.t < EPS1 || its.t > tmin) continue;
-                    tmin = its.t, umin = its.u, vmin = its.v, modelIdx = i, meshIdx = j;
-                }
-            }
-            if (tmin == 1e7) {
+            BVHHit hit;
+            if (! InternalBVH.Intersect(hit, ray, 0.0f, 1e7f)) {
                 result.IntersectState = false;
                 return result;
             }
-            auto const &          model     = InternalScene->Models[modelIdx];
-            auto const &          normals   = model.Mesh.IsNormalAvailable() ? model.Mesh.Normals : model.Mesh.ComputeNormals();
-            auto const &          texcoords = model.Mesh.IsTexCoordAvailable() ? model.Mesh.TexCoords : model.Mesh.GetEmptyTexCoords();
-            std::uint32_t const * face      = model.Mesh.Indices.data() + meshIdx;
-            glm::vec3 const &     p1        = model.Mesh.Positions[face[0]];
-            glm::vec3 const &     p2        = model.Mesh.Positions[face[1]];
-            glm::vec3 const &     p3        = model.Mesh.Positions[face[2]];
-            glm::vec3 const &     n1        = normals[face[0]];
-            glm::vec3 const &     n2        = normals[face[1]];
-            glm::vec3 const &     n3        = normals[face[2]];
-            glm::vec2 const &     uv1       = texcoords[face[0]];
-            glm::vec2 const &     uv2       = texcoords[face[1]];
-            glm::vec2 const &     uv3       = texcoords[face[2]];
-            result.IntersectState           = true;
-            auto const & material           = InternalScene->Materials[model.MaterialIndex];
-            result.IntersectMode            = material.Blend;
-            result.IntersectPosition        = (1.0f - umin - vmin) * p1 + umin * p2 + vmin * p3;
-            result.IntersectNormal          = (1.0f - umin - vmin) * n1 + umin * n2 + vmin * n3;
-            glm::vec2 uvCoord               = (1.0f - umin - vmin) * uv1 + umin * uv2 + vmin * uv3;
-            result.IntersectAlbedo          = GetAlbedo(material, uvCoord);
-            result.IntersectMetaSpec        = GetTexture(material.MetaSpec, uvCoord);
-
-            return result;
+            return ShadeRayHit(InternalSnapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V, ray, hit.T);
+        }
+
+        // any-hit query: whether an occluder lies within (0, tMax] along the normalized ray direction
+        bool Occluded(Ray const & ray, float const tMax) const {
+            if (! InternalScene) {
+                spdlog::warn("VCX::Labs::Rendering::RayIntersector::Occluded(..): uninitialized intersector.");
+                return false;
+            }
+            return InternalBVH.Occluded(ray, 0.0f, tMax, [this](BVHHit const & hit) {
+                return IsOccluder(InternalSnapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V);
+            });
+        }
+
+        // closest hits of coherent rays (e.g. a pixel block) traversed together in packets of up to c_MaxPacketSize;
+        // hits[i] equals IntersectRay(rays[i])
+        static constexpr std::size_t c_MaxPacketSize = InstanceBVH::c_MaxPacketSize;
+
+        void IntersectPacket(std::span<Ray const> const rays, std::span<RayHit> const hits) const {
+            for (std::size_t first = 0; first < rays.size(); first += c_MaxPacketSize) {
+                std::size_t const   count = std::min(c_MaxPacketSize, rays.size() - first);
+                BVHHit              bvhHits[c_MaxPacketSize];
+                std::uint32_t const found = InternalBVH.IntersectPacket(rays.subspan(first, count), 0.0f, 1e7f, bvhHits);
+                for (std::size_t i = 0; i < count; ++i) {
+                    auto const & hit = bvhHits[i];
+                    if (found >> i & 1) hits[first + i] = ShadeRayHit(InternalSnapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V, rays[first + i], hit.T);
+                    else hits[first + i].IntersectState = false;
+                }
+            }
+        }
+
+        // bit i is set when rays[i] is occluded within (0, tMax[i]], as Occluded(rays[i], tMax[i]); at most 32 rays
+        std::uint32_t OccludedPacket(std::span<Ray const> const rays, std::span<float const> const tMax) const {
+            std::uint32_t occluded = 0;
+            for (std::size_t first = 0; first < rays.size(); first += c_MaxPacketSize) {
+                std::size_t const count = std::min(c_MaxPacketSize, rays.size() - first);
+                occluded |= InternalBVH.OccludedPacket(rays.subspan(first, count), 0.0f, tMax.subspan(first, count), [this](BVHHit const & hit) {
+                    return IsOccluder(InternalSnapshot, hit.ModelIndex, hit.FaceIndex, hit.U, hit.V);
+                }) << first;
+            }
+            return occluded;
         }
     };
 
 
-    using RayIntersector = TrivialRayIntersector;
+    using RayIntersector = BVHRayIntersector;
 
 
-    glm::vec3 RayTrace(const RayIntersector & intersector, Ray ray, int maxDepth, bool enableShadow);
+    // primaryHit, when given, is the already computed hit of ray (e.g. from IntersectPacket) and replaces the first query
+    glm::vec3 RayTrace(const RayIntersector & intersector, Ray ray, int maxDepth, bool enableShadow, RayHit const * primaryHit = nullptr);
 
 } // namespace VCX::Labs::Rendering
@@ -94,4 +94,41 @@ target("final")
     end)
     after_install(function (target)
         os.cp("src/VCX/Labs/final_hw/shaders/*", path.join(target:installdir(), "bin", "assets", "shaders"))
-    end)
\ No newline at end of file
+    end)
+
+target("final-headless")
+    set_kind("binary")
+    add_deps("engine")
+    add_deps("assets")
+    add_headerfiles("src/VCX/Labs/final_hw/*.h")
+    add_files      ("src/VCX/Labs/final_hw/headless/*.cpp")
+    add_files      ("src/VCX/Labs/final_hw/BVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/InstanceBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/LinearBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/PathTracing.cpp")
+    add_files      ("src/VCX/Labs/final_hw/Sampler.cpp")
+    add_files      ("src/VCX/Labs/final_hw/SceneSnapshot.cpp")
+    add_files      ("src/VCX/Labs/final_hw/SpatialSplitBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/ShadingTexture.cpp")
+    add_files      ("src/VCX/Labs/final_hw/TileRenderer.cpp")
+    add_files      ("src/VCX/Labs/final_hw/tasks.cpp")
+    add_files      ("src/VCX/Labs/final_hw/TriangleSoA.cpp")
+    add_files      ("src/VCX/Labs/final_hw/WideBVH.cpp")
+
+target("final-bench")
+    set_kind("binary")
+    add_deps("engine")
+    add_deps("assets")
+    add_headerfiles("src/VCX/Labs/final_hw/*.h")
+    add_files      ("src/VCX/Labs/final_hw/bench/*.cpp")
+    add_files      ("src/VCX/Labs/final_hw/BVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/InstanceBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/LinearBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/PathTracing.cpp")
+    add_files      ("src/VCX/Labs/final_hw/Sampler.cpp")
+    add_files      ("src/VCX/Labs/final_hw/SceneSnapshot.cpp")
+    add_files      ("src/VCX/Labs/final_hw/SpatialSplitBVH.cpp")
+    add_files      ("src/VCX/Labs/final_hw/ShadingTexture.cpp")
+    add_files      ("src/VCX/Labs/final_hw/tasks.cpp")
+    add_files      ("src/VCX/Labs/final_hw/TriangleSoA.cpp")
+    add_files      ("src/VCX/Labs/final_hw/WideBVH.cpp")
\ No newline at end of file